@@ -0,0 +1,122 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            activation.c
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Implementation of socket activation support
+//
+// CREATED:         10/18/2026
+//
+// LAST EDITED:     10/18/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <gio/gio.h>
+
+#include <activation.h>
+
+static const int LISTEN_FDS_START = 3;
+static const char* WEB_SOCKET_NAME = "web";
+static const char* CONTROL_SOCKET_NAME = "control";
+
+///////////////////////////////////////////////////////////////////////////////
+// Private API
+////
+
+static GSocket** priv_select_slot(ActivationSockets* sockets, GSocket* socket,
+    const char* name)
+{
+    if (NULL != name && !strcmp(WEB_SOCKET_NAME, name)) {
+        return &sockets->web;
+    } else if (NULL != name && !strcmp(CONTROL_SOCKET_NAME, name)) {
+        return &sockets->control;
+    } else if (G_SOCKET_FAMILY_UNIX == g_socket_get_family(socket)) {
+        return &sockets->control;
+    }
+    return &sockets->web;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Public API
+////
+
+int activation_get_sockets(ActivationSockets* sockets) {
+    sockets->web = NULL;
+    sockets->control = NULL;
+
+    const char* listen_pid = getenv("LISTEN_PID");
+    const char* listen_fds = getenv("LISTEN_FDS");
+    if (NULL == listen_pid || NULL == listen_fds
+        || getpid() != (pid_t)strtol(listen_pid, NULL, 10)) {
+        return 0;
+    }
+
+    const int num_fds = (int)strtol(listen_fds, NULL, 10);
+    const char* listen_fdnames = getenv("LISTEN_FDNAMES");
+    char** names = NULL;
+    if (NULL != listen_fdnames) {
+        names = g_strsplit(listen_fdnames, ":", -1);
+    }
+
+    int adopted = 0;
+    for (int i = 0; i < num_fds; ++i) {
+        const int fd = LISTEN_FDS_START + i;
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+        GError* error = NULL;
+        GSocket* socket = g_socket_new_from_fd(fd, &error);
+        if (NULL == socket) {
+            g_warning("Activation: Ignoring fd %d: %s", fd, error->message);
+            g_error_free(error);
+            continue;
+        }
+
+        const char* name = NULL;
+        if (NULL != names && i < (int)g_strv_length(names)) {
+            name = names[i];
+        }
+
+        GSocket** slot = priv_select_slot(sockets, socket, name);
+        if (NULL != *slot) {
+            g_warning("Activation: Ignoring extra socket on fd %d", fd);
+            g_object_unref(socket);
+            continue;
+        }
+        *slot = socket;
+        ++adopted;
+    }
+
+    g_strfreev(names);
+
+    // Don't pass these on to children
+    unsetenv("LISTEN_PID");
+    unsetenv("LISTEN_FDS");
+    unsetenv("LISTEN_FDNAMES");
+    return adopted;
+}
+
+void activation_sockets_clear(ActivationSockets* sockets) {
+    g_clear_object(&sockets->web);
+    g_clear_object(&sockets->control);
+}
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,47 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            activation.h
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Listening sockets passed in by systemd socket activation
+//
+// CREATED:         10/18/2026
+//
+// LAST EDITED:     10/18/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+#ifndef ACTIVATION_H
+#define ACTIVATION_H
+
+typedef struct _GSocket GSocket;
+
+typedef struct ActivationSockets {
+    GSocket* web;
+    GSocket* control;
+} ActivationSockets;
+
+// Collects sockets passed through LISTEN_FDS (see sd_listen_fds(3)). Sockets
+// named "web" or "control" by FileDescriptorName= are used as such; unnamed
+// sockets are told apart by address family. Members are left NULL if no
+// matching socket was passed. Returns the number of sockets adopted.
+int activation_get_sockets(ActivationSockets* sockets);
+void activation_sockets_clear(ActivationSockets* sockets);
+
+#endif // ACTIVATION_H
+
+///////////////////////////////////////////////////////////////////////////////
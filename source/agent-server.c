@@ -7,7 +7,7 @@
 //
 // CREATED:         11/20/2021
 //
-// LAST EDITED:     12/04/2021
+// LAST EDITED:     10/18/2026
 //
 // Copyright 2021, Ethan D. Twardy
 //
@@ -25,57 +25,234 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 ////
 
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <agent-server.h>
 #include <bluez-agent.h>
+#include <memory-stats.h>
+#include <rate-limiter.h>
 #include <state.h>
 
+typedef struct AgentRequest {
+    AgentServer* server;
+    IotAgentAgent1* interface;
+    GDBusMethodInvocation* invocation;
+    gchar* device;
+    const char* method;
+    void (*approve)(IotAgentAgent1*, GDBusMethodInvocation*);
+    guint timeout_id;
+} AgentRequest;
+
+typedef struct AgentPendingListener {
+    unsigned int id;
+    void (*changed)(void* user_data);
+    void* user_data;
+} AgentPendingListener;
+
+// bluetoothd gives up on agent calls after the default D-Bus timeout
+static const guint AGENT_REQUEST_TIMEOUT_SECONDS = 25;
+static const char* ERROR_REJECTED = "org.bluez.Error.Rejected";
+static const char* ERROR_CANCELED = "org.bluez.Error.Canceled";
+
+// Pairing requests per device: a burst of a few, then one every ten seconds
+static const double DEVICE_REQUEST_RATE = 0.1;
+static const double DEVICE_REQUEST_BURST = 4;
+static const unsigned int MAXIMUM_DEVICES_TRACKED = 64;
+static const unsigned int MAXIMUM_PENDING_REQUESTS = 16;
+
 ///////////////////////////////////////////////////////////////////////////////
 // Private API
 ////
 
-static char* request_pin_code(IotAgentAgent1* interface,
-    GDBusMethodInvocation* invocation, const object_path* device)
-{ return NULL; }
+static void priv_notify_pending_changed(AgentServer* server) {
+    for (guint i = 0; i < server->pending_listeners->len; ++i) {
+        AgentPendingListener* listener = &g_array_index(
+            server->pending_listeners, AgentPendingListener, i);
+        listener->changed(listener->user_data);
+    }
+}
+
+static void priv_request_free(gpointer data) {
+    AgentRequest* request = (AgentRequest*)data;
+    if (0 != request->timeout_id) {
+        g_source_remove(request->timeout_id);
+    }
+    g_object_unref(request->interface);
+    memory_stats_released(MEMORY_DOMAIN_DBUS,
+        sizeof(AgentRequest) + strlen(request->device) + 1);
+    g_free(request->device);
+    g_free(request);
+}
+
+static void priv_reject(AgentRequest* request, const char* error) {
+    g_dbus_method_invocation_return_dbus_error(request->invocation, error,
+        "Agent is not in pairing mode");
+}
+
+// Rejected requests are counted rather than logged individually, and the
+// count is reported when the next request is admitted.
+static bool priv_admit(AgentServer* server, GDBusMethodInvocation* invocation,
+    const object_path* device, const char* method)
+{
+    const char* reason = NULL;
+    if (!rate_limiter_allow(server->device_limiter, device, NULL)) {
+        reason = "Too many requests from this device";
+    } else if (server->pending_requests->len >= MAXIMUM_PENDING_REQUESTS) {
+        reason = "Too many requests are pending";
+    }
+
+    if (NULL != reason) {
+        ++server->rejected;
+        g_debug("AgentServer: %s for %s rejected: %s", method, device,
+            reason);
+        g_dbus_method_invocation_return_dbus_error(invocation, ERROR_REJECTED,
+            reason);
+        return false;
+    }
+
+    if (0 != server->rejected) {
+        g_warning("AgentServer: Rejected %u requests while rate limited",
+            server->rejected);
+        server->rejected = 0;
+    }
+    return true;
+}
 
-static void display_pin_code(IotAgentAgent1* interface,
+static gboolean priv_on_request_timeout(gpointer user_data) {
+    AgentRequest* request = (AgentRequest*)user_data;
+    AgentServer* server = request->server;
+    g_info("AgentServer: %s for %s timed out", request->method,
+        request->device);
+    request->timeout_id = 0;
+    priv_reject(request, ERROR_REJECTED);
+    g_ptr_array_remove(server->pending_requests, request);
+    priv_notify_pending_changed(server);
+    return G_SOURCE_REMOVE;
+}
+
+static void priv_hold_request(AgentServer* server, IotAgentAgent1* interface,
     GDBusMethodInvocation* invocation, const object_path* device,
-    const gchar* pincode)
-{}
+    const char* method,
+    void (*approve)(IotAgentAgent1*, GDBusMethodInvocation*))
+{
+    // Devices the authorizer expects, e.g. from a provisioning manifest, are
+    // answered straight away, so the limits don't apply to them.
+    if (NULL != server->authorize
+        && server->authorize(device, method, server->authorize_data)) {
+        g_info("AgentServer: %s for %s authorized", method, device);
+        approve(interface, invocation);
+        return;
+    }
 
-static uint32_t request_passkey(IotAgentAgent1* interface,
-    GDBusMethodInvocation* invocation, const object_path* device)
-{ return 0; }
+    if (!priv_admit(server, invocation, device, method)) {
+        return;
+    } else if (STATE_PAIRABLE == state_get(server->state_publisher)) {
+        g_info("AgentServer: %s for %s approved", method, device);
+        approve(interface, invocation);
+        return;
+    }
+
+    AgentRequest* request = g_new0(AgentRequest, 1);
+    request->server = server;
+    request->interface = g_object_ref(interface);
+    request->invocation = invocation;
+    request->device = g_strdup(device);
+    memory_stats_allocated(MEMORY_DOMAIN_DBUS,
+        sizeof(AgentRequest) + strlen(device) + 1);
+    request->method = method;
+    request->approve = approve;
+    request->timeout_id = g_timeout_add_seconds(AGENT_REQUEST_TIMEOUT_SECONDS,
+        priv_on_request_timeout, request);
+    g_ptr_array_add(server->pending_requests, request);
+    g_info("AgentServer: %s for %s held until pairable", method, device);
+    priv_notify_pending_changed(server);
+}
+
+static void priv_complete_all(AgentServer* server, bool approve) {
+    if (0 == server->pending_requests->len) {
+        return;
+    }
+
+    for (guint i = 0; i < server->pending_requests->len; ++i) {
+        AgentRequest* request = g_ptr_array_index(server->pending_requests,
+            i);
+        if (approve) {
+            g_info("AgentServer: %s for %s approved", request->method,
+                request->device);
+            request->approve(request->interface, request->invocation);
+        } else {
+            priv_reject(request, ERROR_CANCELED);
+        }
+    }
 
-static void display_passkey(IotAgentAgent1* interface,
+    g_ptr_array_set_size(server->pending_requests, 0);
+    priv_notify_pending_changed(server);
+}
+
+static void priv_on_entry(enum State state, void* user_data)
+{ priv_complete_all((AgentServer*)user_data, true); }
+
+static gboolean request_pin_code(IotAgentAgent1* interface,
+    GDBusMethodInvocation* invocation, const object_path* device,
+    gpointer user_data)
+{ return FALSE; }
+
+static gboolean display_pin_code(IotAgentAgent1* interface,
     GDBusMethodInvocation* invocation, const object_path* device,
-    uint32_t passkey, uint16_t entered)
-{}
+    const gchar* pincode, gpointer user_data)
+{ return FALSE; }
 
-static void request_confirmation(IotAgentAgent1* interface,
+static gboolean request_passkey(IotAgentAgent1* interface,
     GDBusMethodInvocation* invocation, const object_path* device,
-    uint32_t passkey)
-{}
+    gpointer user_data)
+{ return FALSE; }
 
-static void request_authorization(IotAgentAgent1* interface,
-    GDBusMethodInvocation* invocation, const object_path* device)
-{}
+static gboolean display_passkey(IotAgentAgent1* interface,
+    GDBusMethodInvocation* invocation, const object_path* device,
+    uint32_t passkey, uint16_t entered, gpointer user_data)
+{ return FALSE; }
 
-static void authorize_service(IotAgentAgent1* interface,
+static gboolean request_confirmation(IotAgentAgent1* interface,
+    GDBusMethodInvocation* invocation, const object_path* device,
+    uint32_t passkey, gpointer user_data)
+{
+    priv_hold_request((AgentServer*)user_data, interface, invocation, device,
+        "RequestConfirmation", iot_agent_agent1_complete_request_confirmation);
+    return TRUE;
+}
+
+static gboolean request_authorization(IotAgentAgent1* interface,
+    GDBusMethodInvocation* invocation, const object_path* device,
+    gpointer user_data)
+{
+    priv_hold_request((AgentServer*)user_data, interface, invocation, device,
+        "RequestAuthorization",
+        iot_agent_agent1_complete_request_authorization);
+    return TRUE;
+}
+
+static gboolean authorize_service(IotAgentAgent1* interface,
     GDBusMethodInvocation* invocation, const object_path* path,
-    const gchar* uuid)
+    const gchar* uuid, gpointer user_data)
 {
+    // bluetoothd asks once per profile on every connection of a bonded
+    // device, so a reconnect alone can use up the burst. This is answered
+    // immediately and never held, so it isn't rate limited.
     g_info("%s called", __FUNCTION__);
     iot_agent_agent1_complete_authorize_service(interface, invocation);
+    return TRUE;
 }
 
-static void cancel(IotAgentAgent1* interface,
-    GDBusMethodInvocation* invocation)
+static gboolean cancel(IotAgentAgent1* interface,
+    GDBusMethodInvocation* invocation, gpointer user_data)
 {
     g_info("%s called", __FUNCTION__);
+    priv_complete_all((AgentServer*)user_data, false);
     iot_agent_agent1_complete_cancel(interface, invocation);
+    return TRUE;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -97,17 +274,82 @@ AgentServer* agent_server_init(StatePublisher* state_publisher) {
     server->AuthorizeService = authorize_service;
     server->Cancel = cancel;
 
+    server->pending_requests = g_ptr_array_new_with_free_func(
+        priv_request_free);
+    server->pending_listeners = g_array_new(FALSE, FALSE,
+        sizeof(AgentPendingListener));
+    server->next_listener_id = 1;
+    server->device_limiter = rate_limiter_init(MEMORY_DOMAIN_DBUS,
+        DEVICE_REQUEST_RATE, DEVICE_REQUEST_BURST, MAXIMUM_DEVICES_TRACKED);
+    server->rejected = 0;
+    server->authorize = NULL;
+    server->authorize_data = NULL;
+
     state_ref(state_publisher);
     server->state_publisher = state_publisher;
+    server->state_observer = state_add_observer_full(state_publisher, NULL,
+        priv_on_entry, server, STATE_PRIORITY_DEFAULT,
+        STATE_MASK(STATE_PAIRABLE));
     return server;
 }
 
 void agent_server_free(AgentServer** server) {
     if (NULL != *server) {
+        priv_complete_all(*server, false);
+        g_ptr_array_unref((*server)->pending_requests);
+        g_array_unref((*server)->pending_listeners);
+        rate_limiter_free(&(*server)->device_limiter);
+        state_remove_observer((*server)->state_publisher,
+            (*server)->state_observer);
         state_deref(&(*server)->state_publisher);
         free(*server);
         *server = NULL;
     }
 }
 
+unsigned int agent_server_add_pending_listener(AgentServer* server,
+    void (*changed)(void* user_data), void* user_data)
+{
+    AgentPendingListener listener = {
+        .id = server->next_listener_id++,
+        .changed = changed,
+        .user_data = user_data,
+    };
+    g_array_append_val(server->pending_listeners, listener);
+    return listener.id;
+}
+
+void agent_server_remove_pending_listener(AgentServer* server,
+    unsigned int id)
+{
+    for (guint i = 0; i < server->pending_listeners->len; ++i) {
+        if (id == g_array_index(server->pending_listeners,
+                AgentPendingListener, i).id) {
+            g_array_remove_index(server->pending_listeners, i);
+            return;
+        }
+    }
+}
+
+void agent_server_set_authorizer(AgentServer* server,
+    bool (*authorize)(const object_path* device, const char* method,
+        void* user_data),
+    void* user_data)
+{
+    server->authorize = authorize;
+    server->authorize_data = user_data;
+}
+
+void agent_server_foreach_pending(AgentServer* server,
+    void (*callback)(const object_path* device, const char* method,
+        void* user_data),
+    void* user_data)
+{
+    for (guint i = 0; i < server->pending_requests->len; ++i) {
+        AgentRequest* request = g_ptr_array_index(server->pending_requests,
+            i);
+        callback(request->device, request->method, user_data);
+    }
+}
+
 ///////////////////////////////////////////////////////////////////////////////
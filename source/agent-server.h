@@ -7,7 +7,7 @@
 //
 // CREATED:         11/20/2021
 //
-// LAST EDITED:     11/27/2021
+// LAST EDITED:     10/18/2026
 //
 // Copyright 2021, Ethan D. Twardy
 //
@@ -28,43 +28,88 @@
 #ifndef AGENT_SERVER_H
 #define AGENT_SERVER_H
 
+#include <stdbool.h>
 #include <stdint.h>
 
 typedef char object_path;
 typedef char gchar;
+typedef int gboolean;
+typedef void* gpointer;
 typedef struct StatePublisher StatePublisher;
 typedef struct _IotAgentAgent1 IotAgentAgent1;
 typedef struct _GDBusMethodInvocation GDBusMethodInvocation;
+typedef struct _GPtrArray GPtrArray;
+typedef struct _GArray GArray;
+typedef struct RateLimiter RateLimiter;
 
+// Handlers are connected to the "handle-*" signals of the Agent1 skeleton,
+// with the AgentServer as user_data. They return TRUE if the invocation was
+// (or will be) completed.
 typedef struct AgentServer {
-    // Returns an owning string
-    gchar* (*RequestPinCode)(IotAgentAgent1* interface,
-        GDBusMethodInvocation* invocation, const object_path* device);
-    void (*DisplayPinCode)(IotAgentAgent1* interface,
+    gboolean (*RequestPinCode)(IotAgentAgent1* interface,
         GDBusMethodInvocation* invocation, const object_path* device,
-        const gchar* pincode);
-    uint32_t (*RequestPasskey)(IotAgentAgent1* interface,
-        GDBusMethodInvocation* invocation, const object_path* device);
-    void (*DisplayPasskey)(IotAgentAgent1* interface,
+        gpointer user_data);
+    gboolean (*DisplayPinCode)(IotAgentAgent1* interface,
         GDBusMethodInvocation* invocation, const object_path* device,
-        uint32_t passkey, uint16_t entered);
-    void (*RequestConfirmation)(IotAgentAgent1* interface,
+        const gchar* pincode, gpointer user_data);
+    gboolean (*RequestPasskey)(IotAgentAgent1* interface,
         GDBusMethodInvocation* invocation, const object_path* device,
-        uint32_t passkey);
-    void (*RequestAuthorization)(IotAgentAgent1* interface,
-        GDBusMethodInvocation* invocation, const object_path* device);
-    void (*AuthorizeService)(IotAgentAgent1* interface,
+        gpointer user_data);
+    gboolean (*DisplayPasskey)(IotAgentAgent1* interface,
+        GDBusMethodInvocation* invocation, const object_path* device,
+        uint32_t passkey, uint16_t entered, gpointer user_data);
+    gboolean (*RequestConfirmation)(IotAgentAgent1* interface,
+        GDBusMethodInvocation* invocation, const object_path* device,
+        uint32_t passkey, gpointer user_data);
+    gboolean (*RequestAuthorization)(IotAgentAgent1* interface,
+        GDBusMethodInvocation* invocation, const object_path* device,
+        gpointer user_data);
+    gboolean (*AuthorizeService)(IotAgentAgent1* interface,
         GDBusMethodInvocation* invocation, const object_path* path,
-        const gchar* uuid);
-    void (*Cancel)(IotAgentAgent1* interface,
-        GDBusMethodInvocation* invocation);
+        const gchar* uuid, gpointer user_data);
+    gboolean (*Cancel)(IotAgentAgent1* interface,
+        GDBusMethodInvocation* invocation, gpointer user_data);
 
     StatePublisher* state_publisher;
+    unsigned int state_observer;
+
+    // Requests from bluetoothd which are held until the agent is pairable
+    GPtrArray* pending_requests;
+    GArray* pending_listeners;
+    unsigned int next_listener_id;
+
+    // Bounds how often a single device may ask for authorization, so that a
+    // misbehaving peer can't flood the log or starve the other devices.
+    RateLimiter* device_limiter;
+    unsigned int rejected;
+
+    // Consulted before a request is held, see agent_server_set_authorizer()
+    bool (*authorize)(const object_path* device, const char* method,
+        void* user_data);
+    void* authorize_data;
 } AgentServer;
 
 AgentServer* agent_server_init(StatePublisher* publisher);
 void agent_server_free(AgentServer**);
 
+// Invoked whenever a request is added to or removed from the pending set.
+// Returns a listener id, which is never zero.
+unsigned int agent_server_add_pending_listener(AgentServer* server,
+    void (*changed)(void* user_data), void* user_data);
+void agent_server_remove_pending_listener(AgentServer* server,
+    unsigned int id);
+// Requests for which authorize returns true are approved straight away, in
+// any state and without rate limiting. Others are handled as usual. NULL
+// removes the authorizer.
+void agent_server_set_authorizer(AgentServer* server,
+    bool (*authorize)(const object_path* device, const char* method,
+        void* user_data),
+    void* user_data);
+void agent_server_foreach_pending(AgentServer* server,
+    void (*callback)(const object_path* device, const char* method,
+        void* user_data),
+    void* user_data);
+
 #endif // AGENT_SERVER_H
 
 ///////////////////////////////////////////////////////////////////////////////
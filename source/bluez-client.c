@@ -7,7 +7,7 @@
 //
 // CREATED:         11/27/2021
 //
-// LAST EDITED:     11/29/2021
+// LAST EDITED:     10/18/2026
 //
 // Copyright 2021, Ethan D. Twardy
 //
@@ -32,38 +32,119 @@
 #include <bluez-client.h>
 #include <bluez.h>
 #include <config.h>
+#include <memory-stats.h>
 #include <state.h>
 
+typedef struct BluezDevicesListener {
+    unsigned int id;
+    void (*changed)(void* user_data);
+    void* user_data;
+} BluezDevicesListener;
+
 typedef struct BluezClient {
+    StatePublisher* state_publisher;
+    StateObserverHandle state_observer;
     AgentManager1* manager;
     Adapter1* adapter;
+    char* adapter_path;
+
+    // Device1 proxies for the adapter, keyed by upper-case address
+    GDBusObjectManager* object_manager;
+    GHashTable* devices;
+    GArray* listeners;
+    unsigned int next_listener_id;
+
+    // Advertisement updates and discovered devices are flushed to listeners
+    // in batches
+    bool batch_pending;
+    guint batch_id;
+
+    // The filter is kept as the a{sv} that's sent to bluetoothd
+    GVariant* discovery_filter;
+    bool discovering;
+
+    // Another agent process owns the adapter settings now
+    bool handed_over;
+    // What the agent is registered as, NULL if it isn't
+    char* capability;
 } BluezClient;
 
 static const char* BLUEZ_SERVICE = "org.bluez";
 static const char* BLUEZ_OBJECT_PATH = "/org/bluez";
+static const char* BLUEZ_DEVICE_INTERFACE = "org.bluez.Device1";
+
+static const guint DEVICE_BATCH_INTERVAL_MS = 1000;
+
+// Device1 properties that change with every advertisement received
+static const char* const ADVERTISEMENT_PROPERTIES[] = {
+    "RSSI",
+    "TxPower",
+    "ManufacturerData",
+    "ServiceData",
+    "AdvertisingData",
+    "AdvertisingFlags",
+};
 
 ///////////////////////////////////////////////////////////////////////////////
 // Private API
 ////
 
+static bool priv_any_connected(BluezClient* client) {
+    GHashTableIter iter;
+    gpointer device = NULL;
+    g_hash_table_iter_init(&iter, client->devices);
+    while (g_hash_table_iter_next(&iter, NULL, &device)) {
+        if (device1_get_connected(DEVICE1(device))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// CONNECTED follows Device1.Connected: the agent is connected while any
+// device is. Pairing mode is only ever left explicitly, so it's not touched.
+static void priv_update_connected(BluezClient* client) {
+    const bool connected = priv_any_connected(client);
+    switch (state_get(client->state_publisher)) {
+    case STATE_CONNECTION_WAIT:
+        if (connected) {
+            state_set(client->state_publisher, STATE_CONNECTED);
+        }
+        break;
+    case STATE_CONNECTED:
+        if (!connected) {
+            state_set(client->state_publisher, STATE_CONNECTION_WAIT);
+        }
+        break;
+    default: break;
+    }
+}
+
 static void do_enter_connection_wait(BluezClient* bluez_client)
 {
     g_info("BluezClient: State CONNECTION_WAIT");
     // Configure Bluez to automatically disable discoverable mode after 60
     // seconds
     adapter1_set_discoverable(bluez_client->adapter, true);
+    // A device may have connected while we were pairable
+    priv_update_connected(bluez_client);
 }
 
 static void do_enter_connected(BluezClient* bluez_client)
 { g_info("BluezClient: State CONNECTED"); }
 
 static void do_enter_pairable(BluezClient* bluez_client)
-{ g_info("BluezClient: State PAIRABLE"); }
+{
+    g_info("BluezClient: State PAIRABLE");
+    bluez_client_start_discovery(bluez_client);
+}
 
 static void do_enter_shutdown(BluezClient* bluez_client)
 {
     g_info("BluezClient: State SHUTDOWN");
-    adapter1_set_discoverable(bluez_client->adapter, false);
+    if (!bluez_client->handed_over) {
+        adapter1_set_discoverable(bluez_client->adapter, false);
+    }
 }
 
 static void priv_on_entry(enum State state, void* user_data) {
@@ -85,8 +166,271 @@ static void priv_on_entry(enum State state, void* user_data) {
     }
 }
 
-static void priv_on_exit(enum State state, void* user_data)
-{}
+static void priv_on_exit(enum State state, void* user_data) {
+    BluezClient* client = (BluezClient*)user_data;
+    if (STATE_PAIRABLE == state) {
+        bluez_client_stop_discovery(client);
+    }
+}
+
+static void priv_notify_devices_changed(BluezClient* client) {
+    for (guint i = 0; i < client->listeners->len; ++i) {
+        BluezDevicesListener* listener = &g_array_index(client->listeners,
+            BluezDevicesListener, i);
+        listener->changed(listener->user_data);
+    }
+}
+
+static gboolean priv_on_batch_timeout(gpointer user_data) {
+    BluezClient* client = (BluezClient*)user_data;
+    client->batch_id = 0;
+    if (client->batch_pending) {
+        client->batch_pending = false;
+        priv_notify_devices_changed(client);
+    }
+    return G_SOURCE_REMOVE;
+}
+
+// The first change in a quiet period is delivered after one interval, so a
+// burst of advertisements costs one notification rather than one apiece.
+static void priv_notify_batched(BluezClient* client) {
+    client->batch_pending = true;
+    if (0 == client->batch_id) {
+        client->batch_id = g_timeout_add(DEVICE_BATCH_INTERVAL_MS,
+            priv_on_batch_timeout, client);
+    }
+}
+
+// A change delivered immediately makes any pending batch redundant
+static void priv_notify_now(BluezClient* client) {
+    client->batch_pending = false;
+    priv_notify_devices_changed(client);
+}
+
+static bool priv_is_advertisement_property(const char* name) {
+    for (size_t i = 0; i < G_N_ELEMENTS(ADVERTISEMENT_PROPERTIES); ++i) {
+        if (!strcmp(ADVERTISEMENT_PROPERTIES[i], name)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool priv_connected_changed(GVariant* changed,
+    const gchar* const* invalidated)
+{
+    if (g_variant_lookup(changed, "Connected", "b", NULL)) {
+        return true;
+    }
+    for (size_t i = 0; NULL != invalidated && NULL != invalidated[i]; ++i) {
+        if (!strcmp("Connected", invalidated[i])) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool priv_only_advertisement_changed(GVariant* changed,
+    const gchar* const* invalidated)
+{
+    GVariantIter iter;
+    const gchar* name = NULL;
+    g_variant_iter_init(&iter, changed);
+    while (g_variant_iter_next(&iter, "{&sv}", &name, NULL)) {
+        if (!priv_is_advertisement_property(name)) {
+            return false;
+        }
+    }
+
+    for (size_t i = 0; NULL != invalidated && NULL != invalidated[i]; ++i) {
+        if (!priv_is_advertisement_property(invalidated[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool priv_is_adapter_device(BluezClient* client,
+    GDBusInterface* interface)
+{
+    const char* object_path = g_dbus_proxy_get_object_path(
+        G_DBUS_PROXY(interface));
+    const size_t adapter_length = strlen(client->adapter_path);
+    return !strncmp(object_path, client->adapter_path, adapter_length)
+        && '/' == object_path[adapter_length];
+}
+
+// Device keys are upper-case addresses. Lookups normalize into a stack buffer
+// so that the request path doesn't allocate.
+enum { DEVICE_KEY_SIZE = 18 };
+
+static bool priv_make_key(const char* address, char key[DEVICE_KEY_SIZE]) {
+    size_t length = 0;
+    for (; '\0' != address[length]; ++length) {
+        if (DEVICE_KEY_SIZE - 1 <= length) {
+            return false;
+        }
+        key[length] = g_ascii_toupper(address[length]);
+    }
+    key[length] = '\0';
+    return true;
+}
+
+static void priv_add_device(BluezClient* client, GDBusInterface* interface) {
+    if (!IS_DEVICE1(interface) || !priv_is_adapter_device(client, interface)) {
+        return;
+    }
+
+    const char* address = device1_get_address(DEVICE1(interface));
+    if (NULL == address) {
+        return;
+    }
+
+    // bluetoothd re-announces devices, e.g. when a temporary device that
+    // expired is seen again. Only a new proxy is news.
+    char key[DEVICE_KEY_SIZE];
+    if (priv_make_key(address, key)
+        && interface == g_hash_table_lookup(client->devices, key)) {
+        return;
+    }
+
+    char* owned_key = g_ascii_strup(address, -1);
+    if (!g_hash_table_contains(client->devices, owned_key)) {
+        memory_stats_allocated(MEMORY_DOMAIN_DBUS, strlen(owned_key) + 1);
+    }
+    g_hash_table_replace(client->devices, owned_key,
+        g_object_ref(interface));
+    if (device1_get_connected(DEVICE1(interface))) {
+        priv_update_connected(client);
+    }
+    if (client->discovering && !device1_get_paired(DEVICE1(interface))) {
+        priv_notify_batched(client);
+    } else {
+        priv_notify_now(client);
+    }
+}
+
+static void priv_remove_device(BluezClient* client,
+    GDBusInterface* interface)
+{
+    if (!IS_DEVICE1(interface)) {
+        return;
+    }
+
+    const char* address = device1_get_address(DEVICE1(interface));
+    if (NULL == address) {
+        return;
+    }
+
+    const bool batched = client->discovering
+        && !device1_get_paired(DEVICE1(interface));
+    char key[DEVICE_KEY_SIZE];
+    if (priv_make_key(address, key)
+        && g_hash_table_remove(client->devices, key)) {
+        memory_stats_released(MEMORY_DOMAIN_DBUS, strlen(key) + 1);
+        priv_update_connected(client);
+        if (batched) {
+            priv_notify_batched(client);
+        } else {
+            priv_notify_now(client);
+        }
+    }
+}
+
+static GType priv_get_proxy_type(GDBusObjectManagerClient* manager,
+    const gchar* object_path, const gchar* interface_name, gpointer user_data)
+{
+    if (NULL == interface_name) {
+        return G_TYPE_DBUS_OBJECT_PROXY;
+    } else if (!strcmp(BLUEZ_DEVICE_INTERFACE, interface_name)) {
+        return TYPE_DEVICE1_PROXY;
+    }
+    return G_TYPE_DBUS_PROXY;
+}
+
+static void priv_on_interface_added(GDBusObjectManager* manager,
+    GDBusObject* object, GDBusInterface* interface, gpointer user_data)
+{ priv_add_device((BluezClient*)user_data, interface); }
+
+static void priv_on_interface_removed(GDBusObjectManager* manager,
+    GDBusObject* object, GDBusInterface* interface, gpointer user_data)
+{ priv_remove_device((BluezClient*)user_data, interface); }
+
+static void priv_on_properties_changed(GDBusObjectManagerClient* manager,
+    GDBusObjectProxy* object, GDBusProxy* interface, GVariant* changed,
+    const gchar* const* invalidated, gpointer user_data)
+{
+    BluezClient* client = (BluezClient*)user_data;
+    if (!IS_DEVICE1(interface)
+        || !priv_is_adapter_device(client, G_DBUS_INTERFACE(interface))) {
+        return;
+    }
+
+    if (priv_connected_changed(changed, invalidated)) {
+        priv_update_connected(client);
+    }
+    if (priv_only_advertisement_changed(changed, invalidated)) {
+        priv_notify_batched(client);
+    } else {
+        priv_notify_now(client);
+    }
+}
+
+static void priv_on_call_finished(GObject* source, GAsyncResult* result,
+    gpointer user_data)
+{
+    GError* error = NULL;
+    GVariant* value = g_dbus_proxy_call_finish(G_DBUS_PROXY(source), result,
+        &error);
+    if (NULL != error) {
+        g_warning("BluezClient: %s failed: %s", (const char*)user_data,
+            error->message);
+        g_error_free(error);
+        return;
+    }
+    g_variant_unref(value);
+}
+
+static void priv_send_discovery_filter(BluezClient* client) {
+    adapter1_call_set_discovery_filter(client->adapter,
+        client->discovery_filter, NULL, priv_on_call_finished,
+        "SetDiscoveryFilter");
+}
+
+static void priv_watch_devices(BluezClient* client,
+    GDBusConnection* connection)
+{
+    GError* error = NULL;
+    client->object_manager = g_dbus_object_manager_client_new_sync(connection,
+        G_DBUS_OBJECT_MANAGER_CLIENT_FLAGS_NONE, BLUEZ_SERVICE, "/",
+        priv_get_proxy_type, NULL, NULL, NULL, &error);
+    if (NULL != error) {
+        g_warning("BluezClient: Couldn't enumerate devices: %s",
+            error->message);
+        g_error_free(error);
+        return;
+    }
+
+    GList* objects = g_dbus_object_manager_get_objects(
+        client->object_manager);
+    for (GList* iter = objects; NULL != iter; iter = iter->next) {
+        GDBusInterface* interface = g_dbus_object_get_interface(
+            G_DBUS_OBJECT(iter->data), BLUEZ_DEVICE_INTERFACE);
+        if (NULL != interface) {
+            priv_add_device(client, interface);
+            g_object_unref(interface);
+        }
+    }
+    g_list_free_full(objects, g_object_unref);
+
+    g_signal_connect(client->object_manager, "interface-added",
+        G_CALLBACK(priv_on_interface_added), client);
+    g_signal_connect(client->object_manager, "interface-removed",
+        G_CALLBACK(priv_on_interface_removed), client);
+    g_signal_connect(client->object_manager,
+        "interface-proxy-properties-changed",
+        G_CALLBACK(priv_on_properties_changed), client);
+}
 
 ///////////////////////////////////////////////////////////////////////////////
 // Public API
@@ -99,12 +443,18 @@ BluezClient* bluez_client_init(StatePublisher* state_publisher,
     if (NULL == client) {
         return NULL;
     }
+    memset(client, 0, sizeof(BluezClient));
+    state_ref(state_publisher);
+    client->state_publisher = state_publisher;
 
     // Set up Agent
     GError* error = NULL;
-    client->manager = agent_manager1_proxy_new_sync(connection,
-        G_DBUS_PROXY_FLAGS_NONE, BLUEZ_SERVICE, BLUEZ_OBJECT_PATH, NULL,
-        &error);
+    // Neither proxy reads properties or listens to signals, so skip the
+    // extra round trips at startup.
+    const GDBusProxyFlags flags = G_DBUS_PROXY_FLAGS_DO_NOT_LOAD_PROPERTIES
+        | G_DBUS_PROXY_FLAGS_DO_NOT_CONNECT_SIGNALS;
+    client->manager = agent_manager1_proxy_new_sync(connection, flags,
+        BLUEZ_SERVICE, BLUEZ_OBJECT_PATH, NULL, &error);
     if (NULL != error) {
         g_error("Failed to set up bluetoothd D-Bus proxy: %s", error->message);
         g_error_free(error);
@@ -121,27 +471,35 @@ BluezClient* bluez_client_init(StatePublisher* state_publisher,
     object_path[prefix_length] = '/';
     strcpy(object_path + prefix_length + 1, device);
     object_path[prefix_length + 1 + device_length] = '\0';
-    client->adapter = adapter1_proxy_new_sync(connection,
-        G_DBUS_PROXY_FLAGS_NONE, BLUEZ_SERVICE, object_path, NULL,
-        &error);
-    free(object_path);
+    client->adapter = adapter1_proxy_new_sync(connection, flags,
+        BLUEZ_SERVICE, object_path, NULL, &error);
+    client->adapter_path = object_path;
     if (NULL == client->adapter) {
         g_error("Failed to set up bluetoothd D-Bus proxy: %s", error->message);
         g_error_free(error);
     }
 
-    if (0 != state_add_observer(state_publisher, priv_on_exit, priv_on_entry,
-            client)) {
+    client->devices = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+        g_object_unref);
+    client->listeners = g_array_new(FALSE, FALSE,
+        sizeof(BluezDevicesListener));
+    client->next_listener_id = 1;
+    priv_watch_devices(client, connection);
+    bluez_client_set_discovery_filter(client, &(BluezDiscoveryFilter){0});
+
+    client->state_observer = state_add_observer(state_publisher,
+        priv_on_exit, priv_on_entry, client);
+    if (0 == client->state_observer) {
         goto error;
     }
 
     return client;
  error:
-    free(client);
+    bluez_client_free(&client);
     return NULL;
 }
 
-void bluez_client_setup_agent(BluezClient* bluez_client,
+int bluez_client_register_agent(BluezClient* bluez_client,
     const char* object_path, const char* capability)
 {
     GError* error = NULL;
@@ -150,26 +508,249 @@ void bluez_client_setup_agent(BluezClient* bluez_client,
     agent_manager1_call_register_agent_sync(bluez_client->manager, object_path,
         capability, NULL, &error);
     if (NULL != error) {
-        g_error("Failed to regster agent with bluetoothd: %s", error->message);
+        g_warning("Failed to register agent with bluetoothd: %s",
+            error->message);
         g_error_free(error);
+        return 1;
     }
+    g_free(bluez_client->capability);
+    bluez_client->capability = g_strdup(capability);
 
     // Request to become the default agent
     agent_manager1_call_request_default_agent_sync(bluez_client->manager,
         object_path, NULL, &error);
     if (NULL != error) {
-        g_error("Failed to become the default agent: %s", error->message);
+        g_warning("Failed to become the default agent: %s", error->message);
+        g_error_free(error);
+        return 1;
+    }
+    return 0;
+}
+
+void bluez_client_setup_agent(BluezClient* bluez_client,
+    const char* object_path, const char* capability)
+{
+    if (0 != bluez_client_register_agent(bluez_client, object_path,
+            capability)) {
+        g_error("Couldn't set up the agent with bluetoothd");
+    }
+}
+
+void bluez_client_unregister_agent(BluezClient* bluez_client,
+    const char* object_path)
+{
+    GError* error = NULL;
+    agent_manager1_call_unregister_agent_sync(bluez_client->manager,
+        object_path, NULL, &error);
+    if (NULL != error) {
+        g_warning("Failed to unregister agent with bluetoothd: %s",
+            error->message);
         g_error_free(error);
     }
+    g_clear_pointer(&bluez_client->capability, g_free);
 }
 
+// bluetoothd only takes one registration per path, so the old one has to go
+// first. Both calls are synchronous, which keeps the time without a default
+// agent to two round trips.
+int bluez_client_set_agent_capability(BluezClient* bluez_client,
+    const char* object_path, const char* capability)
+{
+    char* previous = g_strdup(bluez_client->capability);
+    bluez_client_unregister_agent(bluez_client, object_path);
+    if (0 == bluez_client_register_agent(bluez_client, object_path,
+            capability)) {
+        g_free(previous);
+        return 0;
+    }
+
+    if (NULL != previous && 0 != bluez_client_register_agent(bluez_client,
+            object_path, previous)) {
+        g_warning("BluezClient: Couldn't register as %s again", previous);
+    }
+    g_free(previous);
+    return 1;
+}
+
+void bluez_client_hand_over(BluezClient* bluez_client)
+{ bluez_client->handed_over = true; }
+
 void bluez_client_free(BluezClient** client) {
     if (NULL == *client) {
         return;
     }
 
+    if (0 != (*client)->state_observer) {
+        state_remove_observer((*client)->state_publisher,
+            (*client)->state_observer);
+    }
+    state_deref(&(*client)->state_publisher);
+    if (NULL != (*client)->object_manager) {
+        g_signal_handlers_disconnect_by_data((*client)->object_manager,
+            *client);
+        g_object_unref((*client)->object_manager);
+    }
+    if (NULL != (*client)->devices) {
+        g_hash_table_unref((*client)->devices);
+    }
+    if (NULL != (*client)->listeners) {
+        g_array_unref((*client)->listeners);
+    }
+    if (0 != (*client)->batch_id) {
+        g_source_remove((*client)->batch_id);
+    }
+    g_clear_pointer(&(*client)->discovery_filter, g_variant_unref);
+    g_free((*client)->capability);
+    g_clear_object(&(*client)->adapter);
+    g_clear_object(&(*client)->manager);
+    free((*client)->adapter_path);
     free(*client);
     *client = NULL;
 }
 
+unsigned int bluez_client_add_devices_listener(BluezClient* client,
+    void (*changed)(void* user_data), void* user_data)
+{
+    BluezDevicesListener listener = {
+        .id = client->next_listener_id++,
+        .changed = changed,
+        .user_data = user_data,
+    };
+    g_array_append_val(client->listeners, listener);
+    return listener.id;
+}
+
+void bluez_client_remove_devices_listener(BluezClient* client,
+    unsigned int id)
+{
+    for (guint i = 0; i < client->listeners->len; ++i) {
+        if (id == g_array_index(client->listeners, BluezDevicesListener,
+                i).id) {
+            g_array_remove_index(client->listeners, i);
+            return;
+        }
+    }
+}
+
+void bluez_client_foreach_device(BluezClient* client,
+    void (*callback)(Device1* device, void* user_data), void* user_data)
+{
+    GHashTableIter iter;
+    gpointer device = NULL;
+    g_hash_table_iter_init(&iter, client->devices);
+    while (g_hash_table_iter_next(&iter, NULL, &device)) {
+        callback(DEVICE1(device), user_data);
+    }
+}
+
+unsigned int bluez_client_get_num_devices(BluezClient* client) {
+    return g_hash_table_size(client->devices);
+}
+
+void bluez_client_set_discovery_filter(BluezClient* client,
+    const BluezDiscoveryFilter* filter)
+{
+    GVariantBuilder builder;
+    g_variant_builder_init(&builder, G_VARIANT_TYPE_VARDICT);
+    if (NULL != filter->transport) {
+        g_variant_builder_add(&builder, "{sv}", "Transport",
+            g_variant_new_string(filter->transport));
+    }
+    if (0 != filter->rssi_floor) {
+        g_variant_builder_add(&builder, "{sv}", "RSSI",
+            g_variant_new_int16(filter->rssi_floor));
+    }
+    if (NULL != filter->uuids) {
+        g_variant_builder_add(&builder, "{sv}", "UUIDs",
+            g_variant_new_strv(filter->uuids, -1));
+    }
+
+    // Have bluetoothd drop repeated advertisement data, rather than signal
+    // ManufacturerData and ServiceData again for every advertisement
+    g_variant_builder_add(&builder, "{sv}", "DuplicateData",
+        g_variant_new_boolean(FALSE));
+
+    g_clear_pointer(&client->discovery_filter, g_variant_unref);
+    client->discovery_filter = g_variant_ref_sink(
+        g_variant_builder_end(&builder));
+    if (client->discovering) {
+        priv_send_discovery_filter(client);
+    }
+}
+
+void bluez_client_start_discovery(BluezClient* client) {
+    if (client->discovering) {
+        return;
+    }
+
+    // Calls on a connection are delivered in order, so the filter is in
+    // place before discovery starts.
+    client->discovering = true;
+    priv_send_discovery_filter(client);
+    adapter1_call_start_discovery(client->adapter, NULL,
+        priv_on_call_finished, "StartDiscovery");
+    g_info("BluezClient: Discovery started");
+}
+
+void bluez_client_stop_discovery(BluezClient* client) {
+    if (!client->discovering) {
+        return;
+    }
+
+    client->discovering = false;
+    adapter1_call_stop_discovery(client->adapter, NULL,
+        priv_on_call_finished, "StopDiscovery");
+    g_info("BluezClient: Discovery stopped");
+}
+
+bool bluez_client_is_discovering(BluezClient* client)
+{ return client->discovering; }
+
+Device1* bluez_client_get_device(BluezClient* client, const char* address) {
+    char key[DEVICE_KEY_SIZE];
+    if (!priv_make_key(address, key)) {
+        return NULL;
+    }
+    return g_hash_table_lookup(client->devices, key);
+}
+
+int bluez_client_device_action(BluezClient* client, const char* address,
+    enum BluezDeviceAction action)
+{
+    Device1* device = bluez_client_get_device(client, address);
+    if (NULL == device) {
+        return 1;
+    }
+
+    switch (action) {
+    case BLUEZ_DEVICE_TRUST:
+        device1_set_trusted(device, true);
+        break;
+    case BLUEZ_DEVICE_UNTRUST:
+        device1_set_trusted(device, false);
+        break;
+    case BLUEZ_DEVICE_BLOCK:
+        device1_set_blocked(device, true);
+        break;
+    case BLUEZ_DEVICE_UNBLOCK:
+        device1_set_blocked(device, false);
+        break;
+    case BLUEZ_DEVICE_CONNECT:
+        device1_call_connect(device, NULL, priv_on_call_finished, "Connect");
+        break;
+    case BLUEZ_DEVICE_DISCONNECT:
+        device1_call_disconnect(device, NULL, priv_on_call_finished,
+            "Disconnect");
+        break;
+    case BLUEZ_DEVICE_REMOVE:
+        adapter1_call_remove_device(client->adapter,
+            g_dbus_proxy_get_object_path(G_DBUS_PROXY(device)), NULL,
+            priv_on_call_finished, "RemoveDevice");
+        break;
+    }
+
+    g_info("BluezClient: %s action %d", address, action);
+    return 0;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
@@ -7,7 +7,7 @@
 //
 // CREATED:         11/27/2021
 //
-// LAST EDITED:     11/28/2021
+// LAST EDITED:     10/18/2026
 //
 // Copyright 2021, Ethan D. Twardy
 //
@@ -28,16 +28,83 @@
 #ifndef BLUEZ_CLIENT_H
 #define BLUEZ_CLIENT_H
 
+#include <stdbool.h>
+
 typedef struct BluezClient BluezClient;
 typedef struct StatePublisher StatePublisher;
 typedef struct _GDBusConnection GDBusConnection;
+typedef struct _Device1 Device1;
+
+enum BluezDeviceAction {
+    BLUEZ_DEVICE_TRUST,
+    BLUEZ_DEVICE_UNTRUST,
+    BLUEZ_DEVICE_BLOCK,
+    BLUEZ_DEVICE_UNBLOCK,
+    BLUEZ_DEVICE_CONNECT,
+    BLUEZ_DEVICE_DISCONNECT,
+    BLUEZ_DEVICE_REMOVE,
+};
+
+// Passed to bluetoothd's SetDiscoveryFilter. Unset members are omitted, so
+// that bluetoothd's defaults apply.
+typedef struct BluezDiscoveryFilter {
+    const char* transport;    // <- "auto", "bredr" or "le"; NULL if unset
+    short rssi_floor;         // <- In dBm; 0 if unset
+    const char* const* uuids; // <- NULL-terminated; NULL if unset
+} BluezDiscoveryFilter;
 
+// Moves between STATE_CONNECTION_WAIT and STATE_CONNECTED as devices connect
+// and disconnect.
 BluezClient* bluez_client_init(StatePublisher* state_publisher,
     GDBusConnection* connection, const char* device);
+// Registers the agent exported at object_path and makes it the default
+// agent. Returns non-zero on failure; bluez_client_setup_agent() aborts.
+int bluez_client_register_agent(BluezClient* bluez_client,
+    const char* object_path, const char* capability);
 void bluez_client_setup_agent(BluezClient* bluez_client,
     const char* object_path, const char* capability);
+void bluez_client_unregister_agent(BluezClient* bluez_client,
+    const char* object_path);
+// Re-registers with a different capability. On failure, the agent is
+// registered with its previous capability again and non-zero is returned.
+int bluez_client_set_agent_capability(BluezClient* bluez_client,
+    const char* object_path, const char* capability);
+// Leaves the adapter as it is on shutdown, because a successor process is
+// running it now. Discovery sessions are per-client, so they're still ended.
+void bluez_client_hand_over(BluezClient* bluez_client);
 void bluez_client_free(BluezClient** client);
 
+// Invoked whenever a device appears, disappears or changes properties.
+// Changes that only carry advertisement data (RSSI, TX power, manufacturer
+// and service data) are coalesced, and so are devices found while
+// discovering: listeners hear about them at most once per batch interval.
+// Returns a listener id, which is never zero.
+unsigned int bluez_client_add_devices_listener(BluezClient* client,
+    void (*changed)(void* user_data), void* user_data);
+void bluez_client_remove_devices_listener(BluezClient* client,
+    unsigned int id);
+
+// Iterate over the devices known to the adapter. Devices must not be added or
+// removed from within the callback.
+void bluez_client_foreach_device(BluezClient* client,
+    void (*callback)(Device1* device, void* user_data), void* user_data);
+unsigned int bluez_client_get_num_devices(BluezClient* client);
+// Returns NULL if no device with the given address is known
+Device1* bluez_client_get_device(BluezClient* client, const char* address);
+
+// Discovery runs while the agent is pairable, and may also be started and
+// stopped explicitly. Changing the filter while discovering re-applies it.
+void bluez_client_set_discovery_filter(BluezClient* client,
+    const BluezDiscoveryFilter* filter);
+void bluez_client_start_discovery(BluezClient* client);
+void bluez_client_stop_discovery(BluezClient* client);
+bool bluez_client_is_discovering(BluezClient* client);
+
+// Returns 0 if the action was dispatched to bluetoothd, non-zero if no device
+// with the given address is known. Actions complete asynchronously.
+int bluez_client_device_action(BluezClient* client, const char* address,
+    enum BluezDeviceAction action);
+
 #endif // BLUEZ_CLIENT_H
 
 ///////////////////////////////////////////////////////////////////////////////
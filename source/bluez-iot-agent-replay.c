@@ -0,0 +1,601 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            bluez-iot-agent-replay.c
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Replay a D-Bus capture against the agent
+//
+// CREATED:         10/18/2026
+//
+// LAST EDITED:     10/18/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+#include <argp.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <gio/gio.h>
+#include <glib-unix.h>
+#include <glib.h>
+
+#include <bluez-simulator.h>
+#include <config.h>
+#include <dbus-capture.h>
+
+const char* argp_program_name = CONFIG_PROGRAM_NAME "-replay "
+    CONFIG_PROGRAM_VERSION;
+const char* argp_program_bug_address = "<ethan.twardy@gmail.com>";
+
+static char doc[] = "Replay a D-Bus capture against " CONFIG_PROGRAM_NAME
+    "\v"
+    "Plays the part of bluetoothd: owns org.bluez on the bus, answers the "
+    "agent's method calls with the replies in the capture, and sends the "
+    "recorded signals and agent requests with their original timing. Run it "
+    "on a private bus (e.g. dbus-daemon --session --print-address), then "
+    "start the agent with --bus-address. Prints the agent's response times "
+    "when the capture has been played.\n\n"
+    "With --devices instead of a capture, simulates bluetoothd with that many "
+    "devices until interrupted. The agent may be restarted meanwhile. With "
+    "--pair-every, the devices that aren't connected arrive one at a time and "
+    "ask the agent to pair, and the pairing throughput is printed on exit.";
+static char args_doc[] = "CAPTURE\n--devices COUNT";
+
+static error_t parse_opt(int, char*, struct argp_state*);
+static const struct argp_option options[] = {
+    { "address", 'a', "ADDRESS", 0,
+      "Bus to replay on (the session bus by default)", 0 },
+    { "speed", 'x', "FACTOR", 0,
+      "Playback speed, or 0 to send everything without delay (1 by default)",
+      0 },
+    { "name", 'n', "NAME", 0,
+      "Well-known name of the agent (" CONFIG_SERVICE_NAME " by default)", 0 },
+    { "devices", 'D', "COUNT", 0,
+      "Simulate COUNT devices instead of replaying a capture", 0 },
+    { "connected", 'C', "COUNT", 0,
+      "How many of the simulated devices are paired and connected (none by"
+      " default)", 0 },
+    { "pair-every", 'P', "MILLISECONDS", 0,
+      "Have another simulated device arrive and pair every MILLISECONDS", 0 },
+    { 0 },
+};
+static struct argp argp = { options, parse_opt, args_doc, doc, NULL, NULL,
+    NULL };
+
+struct arguments {
+    const char* capture;
+    const char* address;
+    double speed;
+    const char* name;
+    unsigned int devices;
+    unsigned int connected;
+    unsigned int pair_interval_ms;
+};
+
+typedef struct Replay {
+    GDBusConnection* connection;
+    GMainLoop* main_loop;
+    GPtrArray* records;
+    double speed;
+    char* agent; // <- Unique name of the agent, once it's on the bus
+
+    // Recorded replies to the agent's calls, by path, interface and member
+    GHashTable* replies;
+    guint next_record;
+    gint64 started_at;
+    guint timer_id;
+    bool sent_all;
+
+    unsigned int messages_sent;
+    unsigned int calls_answered;
+    unsigned int calls_unanswered;
+    unsigned int pending_replies;
+    GArray* latencies; // <- Of gint64, microseconds
+    int result;
+} Replay;
+
+typedef struct PendingMessage {
+    Replay* replay;
+    GDBusMessage* message;
+    gint64 sent_at;
+} PendingMessage;
+
+static const char* BUS_NAME = "org.freedesktop.DBus";
+static const char* BLUEZ_NAME = "org.bluez";
+// Time allowed for the agent to react to the last message
+static const guint SETTLE_SECONDS = 2;
+
+static error_t parse_opt(int key, char* arg, struct argp_state* state) {
+    struct arguments* arguments = state->input;
+    char* end = NULL;
+    switch (key) {
+    case 'a':
+        arguments->address = arg;
+        break;
+    case 'x':
+        arguments->speed = strtod(arg, &end);
+        if ('\0' != *end || 0 > arguments->speed) {
+            argp_error(state, "invalid speed: %s", arg);
+        }
+        break;
+    case 'n':
+        arguments->name = arg;
+        break;
+    case 'D':
+        arguments->devices = strtoul(arg, &end, 10);
+        if ('\0' == *arg || '\0' != *end || '-' == *arg) {
+            argp_error(state, "invalid device count: %s", arg);
+        }
+        break;
+    case 'C':
+        arguments->connected = strtoul(arg, &end, 10);
+        if ('\0' == *arg || '\0' != *end || '-' == *arg) {
+            argp_error(state, "invalid device count: %s", arg);
+        }
+        break;
+    case 'P':
+        arguments->pair_interval_ms = strtoul(arg, &end, 10);
+        if ('\0' == *arg || '\0' != *end || '-' == *arg
+            || 0 == arguments->pair_interval_ms) {
+            argp_error(state, "invalid interval: %s", arg);
+        }
+        break;
+    case ARGP_KEY_ARG:
+        if (0 != state->arg_num) {
+            argp_usage(state);
+        }
+        arguments->capture = arg;
+        break;
+    case ARGP_KEY_END:
+        if ((NULL == arguments->capture) == (0 == arguments->devices)) {
+            argp_usage(state);
+        } else if (arguments->connected > arguments->devices) {
+            argp_error(state, "only %u devices are simulated",
+                arguments->devices);
+        }
+        break;
+    default:
+        return ARGP_ERR_UNKNOWN;
+    }
+
+    return 0;
+}
+
+static char* call_key(GDBusMessage* call) {
+    const char* path = g_dbus_message_get_path(call);
+    const char* interface = g_dbus_message_get_interface(call);
+    const char* member = g_dbus_message_get_member(call);
+    return g_strdup_printf("%s\n%s\n%s", NULL != path ? path : "",
+        NULL != interface ? interface : "", NULL != member ? member : "");
+}
+
+static void queue_free(gpointer data)
+{ g_queue_free_full((GQueue*)data, g_object_unref); }
+
+// Pair each call the agent made with the reply bluetoothd sent
+static void index_replies(Replay* replay) {
+    GHashTable* calls = g_hash_table_new(g_direct_hash, g_direct_equal);
+    for (guint i = 0; i < replay->records->len; ++i) {
+        DbusCaptureRecord* record = g_ptr_array_index(replay->records, i);
+        const GDBusMessageType type = g_dbus_message_get_message_type(
+            record->message);
+        const char* destination = g_dbus_message_get_destination(
+            record->message);
+        if (record->outgoing && G_DBUS_MESSAGE_TYPE_METHOD_CALL == type) {
+            if (NULL == destination || strcmp(destination, BUS_NAME)) {
+                g_hash_table_insert(calls, GUINT_TO_POINTER(
+                        g_dbus_message_get_serial(record->message)),
+                    record->message);
+            }
+            continue;
+        } else if (record->outgoing
+            || (G_DBUS_MESSAGE_TYPE_METHOD_RETURN != type
+                && G_DBUS_MESSAGE_TYPE_ERROR != type)) {
+            continue;
+        }
+
+        gpointer serial = GUINT_TO_POINTER(g_dbus_message_get_reply_serial(
+                record->message));
+        GDBusMessage* call = g_hash_table_lookup(calls, serial);
+        if (NULL == call) {
+            continue;
+        }
+        g_hash_table_remove(calls, serial);
+
+        char* key = call_key(call);
+        GQueue* queue = g_hash_table_lookup(replay->replies, key);
+        if (NULL == queue) {
+            queue = g_queue_new();
+            g_hash_table_insert(replay->replies, key, queue);
+        } else {
+            g_free(key);
+        }
+        g_queue_push_tail(queue, g_object_ref(record->message));
+    }
+    g_hash_table_unref(calls);
+}
+
+// Signals, and calls into the agent, are what the replay sends
+static bool is_stimulus(const DbusCaptureRecord* record) {
+    if (record->outgoing) {
+        return false;
+    }
+
+    const char* sender = g_dbus_message_get_sender(record->message);
+    const GDBusMessageType type = g_dbus_message_get_message_type(
+        record->message);
+    return (NULL == sender || strcmp(sender, BUS_NAME))
+        && (G_DBUS_MESSAGE_TYPE_SIGNAL == type
+            || G_DBUS_MESSAGE_TYPE_METHOD_CALL == type);
+}
+
+static gboolean on_settled(gpointer user_data) {
+    g_main_loop_quit(((Replay*)user_data)->main_loop);
+    return G_SOURCE_REMOVE;
+}
+
+static void check_finished(Replay* replay) {
+    if (replay->sent_all && 0 == replay->pending_replies) {
+        g_timeout_add_seconds(SETTLE_SECONDS, on_settled, replay);
+    }
+}
+
+static void on_reply(GObject* source, GAsyncResult* result,
+    gpointer user_data)
+{
+    PendingMessage* pending = (PendingMessage*)user_data;
+    Replay* replay = pending->replay;
+    const gint64 latency = g_get_monotonic_time() - pending->sent_at;
+    GError* error = NULL;
+    GDBusMessage* reply = g_dbus_connection_send_message_with_reply_finish(
+        G_DBUS_CONNECTION(source), result, &error);
+    if (NULL == reply) {
+        fprintf(stderr, "%s: %s\n", g_dbus_message_get_member(
+                pending->message), error->message);
+        g_error_free(error);
+    } else {
+        g_array_append_val(replay->latencies, latency);
+        g_object_unref(reply);
+    }
+
+    --replay->pending_replies;
+    g_object_unref(pending->message);
+    g_free(pending);
+    check_finished(replay);
+}
+
+static void send_stimulus(Replay* replay, const DbusCaptureRecord* record) {
+    GDBusMessage* message = g_dbus_message_copy(record->message, NULL);
+    g_dbus_message_set_sender(message, NULL);
+    if (NULL != g_dbus_message_get_destination(message)) {
+        g_dbus_message_set_destination(message, replay->agent);
+    }
+
+    ++replay->messages_sent;
+    if (G_DBUS_MESSAGE_TYPE_METHOD_CALL != g_dbus_message_get_message_type(
+            message)) {
+        g_dbus_connection_send_message(replay->connection, message,
+            G_DBUS_SEND_MESSAGE_FLAGS_NONE, NULL, NULL);
+        g_object_unref(message);
+        return;
+    }
+
+    PendingMessage* pending = g_new(PendingMessage, 1);
+    pending->replay = replay;
+    pending->message = message;
+    pending->sent_at = g_get_monotonic_time();
+    ++replay->pending_replies;
+    g_dbus_connection_send_message_with_reply(replay->connection, message,
+        G_DBUS_SEND_MESSAGE_FLAGS_NONE, -1, NULL, NULL, on_reply, pending);
+}
+
+static gint64 due_at(Replay* replay, const DbusCaptureRecord* record) {
+    return 0 < replay->speed ? (gint64)(record->offset / replay->speed) : 0;
+}
+
+static gboolean on_timer(gpointer user_data);
+
+static void schedule_next(Replay* replay) {
+    while (replay->next_record < replay->records->len
+        && !is_stimulus(g_ptr_array_index(replay->records,
+                replay->next_record))) {
+        ++replay->next_record;
+    }
+    if (replay->next_record >= replay->records->len) {
+        replay->sent_all = true;
+        check_finished(replay);
+        return;
+    }
+
+    const gint64 delay = due_at(replay, g_ptr_array_index(replay->records,
+            replay->next_record))
+        - (g_get_monotonic_time() - replay->started_at);
+    replay->timer_id = g_timeout_add(MAX(0, delay) / 1000, on_timer, replay);
+}
+
+static gboolean on_timer(gpointer user_data) {
+    Replay* replay = (Replay*)user_data;
+    replay->timer_id = 0;
+    const gint64 elapsed = g_get_monotonic_time() - replay->started_at;
+    for (; replay->next_record < replay->records->len;
+         ++replay->next_record) {
+        DbusCaptureRecord* record = g_ptr_array_index(replay->records,
+            replay->next_record);
+        if (!is_stimulus(record)) {
+            continue;
+        } else if (due_at(replay, record) > elapsed) {
+            break;
+        }
+        send_stimulus(replay, record);
+    }
+
+    schedule_next(replay);
+    return G_SOURCE_REMOVE;
+}
+
+// Calls from the agent are answered from the capture. A call made more often
+// than it was recorded gets the last recorded reply again.
+static gboolean answer_call(gpointer user_data) {
+    PendingMessage* pending = (PendingMessage*)user_data;
+    Replay* replay = pending->replay;
+    GDBusMessage* call = pending->message;
+    char* key = call_key(call);
+    GQueue* queue = g_hash_table_lookup(replay->replies, key);
+    g_free(key);
+
+    GDBusMessage* reply = NULL;
+    if (NULL != queue && !g_queue_is_empty(queue)) {
+        GDBusMessage* recorded = 1 < g_queue_get_length(queue)
+            ? g_queue_pop_head(queue) : g_object_ref(g_queue_peek_head(queue));
+        reply = g_dbus_message_copy(recorded, NULL);
+        g_object_unref(recorded);
+        g_dbus_message_set_sender(reply, NULL);
+        g_dbus_message_set_destination(reply,
+            g_dbus_message_get_sender(call));
+        g_dbus_message_set_reply_serial(reply,
+            g_dbus_message_get_serial(call));
+        ++replay->calls_answered;
+    } else {
+        reply = g_dbus_message_new_method_error(call,
+            "org.freedesktop.DBus.Error.UnknownMethod",
+            "%s.%s isn't in the capture", g_dbus_message_get_interface(call),
+            g_dbus_message_get_member(call));
+        ++replay->calls_unanswered;
+    }
+
+    g_dbus_connection_send_message(replay->connection, reply,
+        G_DBUS_SEND_MESSAGE_FLAGS_NONE, NULL, NULL);
+    g_object_unref(reply);
+    g_object_unref(call);
+    g_free(pending);
+    return G_SOURCE_REMOVE;
+}
+
+// Runs on the GDBus worker thread. Method calls are taken from GDBus, which
+// would otherwise reply that nothing is exported at the path.
+static GDBusMessage* filter(GDBusConnection* connection,
+    GDBusMessage* message, gboolean incoming, gpointer user_data)
+{
+    if (!incoming || G_DBUS_MESSAGE_TYPE_METHOD_CALL
+        != g_dbus_message_get_message_type(message)) {
+        return message;
+    }
+
+    PendingMessage* pending = g_new(PendingMessage, 1);
+    pending->replay = (Replay*)user_data;
+    pending->message = message;
+    pending->sent_at = 0;
+    g_idle_add(answer_call, pending);
+    return NULL;
+}
+
+static void on_agent_appeared(GDBusConnection* connection, const gchar* name,
+    const gchar* name_owner, gpointer user_data)
+{
+    Replay* replay = (Replay*)user_data;
+    if (NULL != replay->agent) {
+        return;
+    }
+
+    printf("Replaying %u messages to %s (%s)\n", replay->records->len, name,
+        name_owner);
+    replay->agent = g_strdup(name_owner);
+    replay->started_at = g_get_monotonic_time();
+    schedule_next(replay);
+}
+
+static void on_agent_vanished(GDBusConnection* connection, const gchar* name,
+    gpointer user_data)
+{
+    Replay* replay = (Replay*)user_data;
+    if (NULL == replay->agent) {
+        return;
+    }
+
+    fprintf(stderr, "%s left the bus before the replay finished\n", name);
+    replay->result = 1;
+    g_main_loop_quit(replay->main_loop);
+}
+
+static void on_name_lost(GDBusConnection* connection, const gchar* name,
+    gpointer user_data)
+{
+    Replay* replay = (Replay*)user_data;
+    fprintf(stderr, "Couldn't own %s on the bus\n", name);
+    replay->result = 1;
+    g_main_loop_quit(replay->main_loop);
+}
+
+static gint compare_latency(gconstpointer first, gconstpointer second) {
+    const gint64 a = *(const gint64*)first;
+    const gint64 b = *(const gint64*)second;
+    return (a > b) - (a < b);
+}
+
+static void print_summary(Replay* replay) {
+    const double elapsed = (double)(g_get_monotonic_time()
+        - replay->started_at) / G_TIME_SPAN_SECOND;
+    printf("Sent %u messages in %.3f s; answered %u calls from the capture, "
+        "%u calls weren't in it\n", replay->messages_sent, elapsed,
+        replay->calls_answered, replay->calls_unanswered);
+
+    GArray* latencies = replay->latencies;
+    if (0 == latencies->len) {
+        return;
+    }
+
+    g_array_sort(latencies, compare_latency);
+    gint64 total = 0;
+    for (guint i = 0; i < latencies->len; ++i) {
+        total += g_array_index(latencies, gint64, i);
+    }
+    printf("Agent response time over %u calls (ms): min %.3f, mean %.3f, "
+        "p50 %.3f, p95 %.3f, max %.3f\n", latencies->len,
+        g_array_index(latencies, gint64, 0) / 1000.0,
+        (double)total / latencies->len / 1000.0,
+        g_array_index(latencies, gint64, latencies->len / 2) / 1000.0,
+        g_array_index(latencies, gint64, latencies->len * 95 / 100) / 1000.0,
+        g_array_index(latencies, gint64, latencies->len - 1) / 1000.0);
+}
+
+static gboolean on_interrupted(gpointer user_data) {
+    g_main_loop_quit((GMainLoop*)user_data);
+    return G_SOURCE_CONTINUE;
+}
+
+static void on_simulator_name_lost(GDBusConnection* connection,
+    const gchar* name, gpointer user_data)
+{
+    fprintf(stderr, "Couldn't own %s on the bus\n", name);
+    g_main_loop_quit((GMainLoop*)user_data);
+}
+
+static int simulate(GDBusConnection* connection,
+    const struct arguments* arguments)
+{
+    BluezSimulator* simulator = bluez_simulator_init(connection, "hci0",
+        arguments->devices, arguments->connected,
+        arguments->pair_interval_ms);
+    if (NULL == simulator) {
+        return 1;
+    }
+
+    GMainLoop* main_loop = g_main_loop_new(NULL, FALSE);
+    guint interrupt_id = g_unix_signal_add(SIGINT, on_interrupted,
+        main_loop);
+    guint terminate_id = g_unix_signal_add(SIGTERM, on_interrupted,
+        main_loop);
+    guint owner_id = g_bus_own_name_on_connection(connection, BLUEZ_NAME,
+        G_BUS_NAME_OWNER_FLAGS_NONE, NULL, on_simulator_name_lost, main_loop,
+        NULL);
+    printf("Simulating %u devices, %u of them connected\n",
+        arguments->devices, arguments->connected);
+    fflush(stdout);
+    g_main_loop_run(main_loop);
+    bluez_simulator_print_summary(simulator);
+
+    g_bus_unown_name(owner_id);
+    g_source_remove(terminate_id);
+    g_source_remove(interrupt_id);
+    g_main_loop_unref(main_loop);
+    bluez_simulator_free(&simulator);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    struct arguments arguments = { .speed = 1.0,
+        .name = CONFIG_SERVICE_NAME };
+    argp_parse(&argp, argc, argv, 0, 0, &arguments);
+
+    GPtrArray* records = NULL;
+    if (NULL != arguments.capture) {
+        records = dbus_capture_load(arguments.capture);
+        if (NULL == records) {
+            fprintf(stderr, "%s: couldn't read %s\n", argv[0],
+                arguments.capture);
+            return 1;
+        }
+    }
+
+    GError* error = NULL;
+    GDBusConnection* connection = NULL;
+    if (NULL != arguments.address) {
+        connection = g_dbus_connection_new_for_address_sync(
+            arguments.address,
+            G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT
+            | G_DBUS_CONNECTION_FLAGS_MESSAGE_BUS_CONNECTION, NULL, NULL,
+            &error);
+    } else {
+        connection = g_bus_get_sync(G_BUS_TYPE_SESSION, NULL, &error);
+    }
+    if (NULL != error) {
+        fprintf(stderr, "%s: couldn't connect to bus: %s\n", argv[0],
+            error->message);
+        g_error_free(error);
+        g_clear_pointer(&records, g_ptr_array_unref);
+        return 1;
+    }
+
+    if (NULL == records) {
+        const int result = simulate(connection, &arguments);
+        g_object_unref(connection);
+        return result;
+    }
+
+    Replay replay = {
+        .connection = connection,
+        .main_loop = g_main_loop_new(NULL, FALSE),
+        .records = records,
+        .speed = arguments.speed,
+        .replies = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+            queue_free),
+        .latencies = g_array_new(FALSE, FALSE, sizeof(gint64)),
+    };
+    index_replies(&replay);
+
+    guint filter_id = g_dbus_connection_add_filter(connection, filter,
+        &replay, NULL);
+    guint owner_id = g_bus_own_name_on_connection(connection, BLUEZ_NAME,
+        G_BUS_NAME_OWNER_FLAGS_NONE, NULL, on_name_lost, &replay, NULL);
+    guint watcher_id = g_bus_watch_name_on_connection(connection,
+        arguments.name, G_BUS_NAME_WATCHER_FLAGS_NONE, on_agent_appeared,
+        on_agent_vanished, &replay, NULL);
+    printf("Waiting for %s\n", arguments.name);
+    g_main_loop_run(replay.main_loop);
+    if (NULL != replay.agent) {
+        print_summary(&replay);
+    }
+
+    g_bus_unwatch_name(watcher_id);
+    g_bus_unown_name(owner_id);
+    g_dbus_connection_remove_filter(connection, filter_id);
+    if (0 != replay.timer_id) {
+        g_source_remove(replay.timer_id);
+    }
+    g_array_unref(replay.latencies);
+    g_hash_table_unref(replay.replies);
+    g_free(replay.agent);
+    g_main_loop_unref(replay.main_loop);
+    g_object_unref(connection);
+    g_ptr_array_unref(records);
+    return replay.result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
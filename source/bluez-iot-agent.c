@@ -7,7 +7,7 @@
 //
 // CREATED:         11/20/2021
 //
-// LAST EDITED:     12/04/2021
+// LAST EDITED:     10/18/2026
 //
 // Copyright 2021, Ethan D. Twardy
 //
@@ -27,17 +27,29 @@
 
 #include <argp.h>
 #include <stdbool.h>
+#include <unistd.h>
 
 #include <glib.h>
 #include <glib-unix.h>
-#include <libsoup/soup.h>
 
+#include <activation.h>
 #include <agent-server.h>
 #include <bluez.h>
 #include <bluez-agent.h>
 #include <bluez-client.h>
+#include <certificate-watcher.h>
+#include <checkpoint.h>
 #include <config.h>
+#include <control-server.h>
+#include <dbus-capture.h>
+#include <handoff.h>
+#include <idle-monitor.h>
+#include <link-monitor.h>
+#include <logger.h>
+#include <provisioning.h>
+#include <settings.h>
 #include <state.h>
+#include <web-listener.h>
 #include <web-server.h>
 
 const char* argp_program_name = CONFIG_PROGRAM_NAME " " CONFIG_PROGRAM_VERSION;
@@ -49,26 +61,88 @@ static error_t parse_opt(int, char*, struct argp_state*);
 static const struct argp_option options[] = {
     { "no-register-name", 'n', NULL, OPTION_ARG_OPTIONAL,
       "Don't attempt to register the service name with D-Bus", 0 },
+    { "config", 'c', "PATH", 0,
+      "Configuration file, re-read on SIGHUP (" CONFIG_SETTINGS_PATH
+      " by default)", 0 },
     { "device", 'd', "DEVICE", OPTION_ARG_OPTIONAL,
       "The Bluetooth device to listen on (hci0 by default, hciN)", 0 },
+    { "read-only-lan", 'r', NULL, 0,
+      "Only serve GET requests on the network; control is local only", 0 },
+    { "control-socket", 's', "PATH", 0,
+      "Path of the local control socket (" CONFIG_CONTROL_SOCKET_PATH
+      " by default)", 0 },
+    { "idle-exit", 'i', "MINUTES", 0,
+      "Exit after MINUTES without activity while not pairing (0, the default,"
+      " never exits)", 0 },
+    { "state-file", 'f', "PATH", 0,
+      "Where to checkpoint state for warm restarts (" CONFIG_STATE_PATH
+      " by default)", 0 },
+    { "record", 'R', "PATH", 0,
+      "Record all D-Bus traffic to PATH, for " CONFIG_PROGRAM_NAME "-replay",
+      0 },
+    { "bus-address", 'b', "ADDRESS", 0,
+      "Connect to the bus at ADDRESS instead of the system bus", 0 },
+    { "take-over", 't', NULL, 0,
+      "Take over the sockets and bus name of the running agent, which exits"
+      " once we're ready", 0 },
     { 0 },
 };
 static struct argp argp = { options, parse_opt, NULL, doc, NULL, NULL, NULL };
 
+// Anything given on the command line overrides the configuration file
 struct arguments {
     bool register_name;
+    const char* config_file;
     const char* device;
+    bool read_only_lan;
+    const char* control_socket;
+    bool idle_exit_set;
+    unsigned int idle_exit_minutes;
+    const char* state_file;
+    const char* webroot;
+    const char* record_file;
+    const char* bus_address;
+    bool take_over;
 };
 
 static error_t parse_opt(int key, char* arg, struct argp_state* state) {
     struct arguments* arguments = state->input;
+    char* end = NULL;
     switch (key) {
     case 'n':
         arguments->register_name = false;
         break;
+    case 'c':
+        arguments->config_file = arg;
+        break;
     case 'd':
         arguments->device = arg;
         break;
+    case 'r':
+        arguments->read_only_lan = true;
+        break;
+    case 's':
+        arguments->control_socket = arg;
+        break;
+    case 'i':
+        arguments->idle_exit_set = true;
+        arguments->idle_exit_minutes = strtoul(arg, &end, 10);
+        if ('\0' == *arg || '\0' != *end || '-' == *arg) {
+            argp_error(state, "invalid idle timeout: %s", arg);
+        }
+        break;
+    case 'f':
+        arguments->state_file = arg;
+        break;
+    case 'R':
+        arguments->record_file = arg;
+        break;
+    case 'b':
+        arguments->bus_address = arg;
+        break;
+    case 't':
+        arguments->take_over = true;
+        break;
     case ARGP_KEY_END:
         break;
     default:
@@ -78,31 +152,323 @@ static error_t parse_opt(int key, char* arg, struct argp_state* state) {
     return 0;
 }
 
-static void register_handlers(GDBusConnection* connection, const gchar* name,
-    const gpointer user_data)
+static void apply_arguments(Settings* settings,
+    const struct arguments* arguments)
+{
+    if (NULL != arguments->device) {
+        g_free(settings->adapter);
+        settings->adapter = g_strdup(arguments->device);
+    }
+    if (NULL != arguments->webroot) {
+        g_free(settings->webroot);
+        settings->webroot = g_strdup(arguments->webroot);
+    }
+    if (NULL != arguments->control_socket) {
+        g_free(settings->control_socket);
+        settings->control_socket = g_strdup(arguments->control_socket);
+    }
+    if (arguments->read_only_lan) {
+        settings->lan_read_only = true;
+    }
+    if (arguments->idle_exit_set) {
+        settings->idle_exit_minutes = arguments->idle_exit_minutes;
+    }
+}
+
+struct services {
+    AgentServer* agent_server;
+    ControlServer* control_server;
+    HandoffServer* handoff_server;
+    HandoffClient* handoff_client;
+};
+
+// bluetoothd calls the agent at our unique name, so everything is exported
+// before we register, and before we take the well-known name.
+static void export_objects(GDBusConnection* connection,
+    struct services* services)
 {
-    AgentServer* agent_server = (AgentServer*)user_data;
+    AgentServer* agent_server = services->agent_server;
     IotAgentAgent1* interface = iot_agent_agent1_skeleton_new();
     GError* error = NULL;
     g_dbus_interface_skeleton_export(G_DBUS_INTERFACE_SKELETON(interface),
         connection, CONFIG_OBJECT_PATH, &error);
     g_signal_connect(interface, "handle-cancel",
-        G_CALLBACK(agent_server->Cancel), NULL);
+        G_CALLBACK(agent_server->Cancel), agent_server);
     g_signal_connect(interface, "handle-authorize-service",
-        G_CALLBACK(agent_server->AuthorizeService), NULL);
-    g_info("Agent listening on D-Bus at dest=%s,path=%s", name,
-        CONFIG_OBJECT_PATH);
+        G_CALLBACK(agent_server->AuthorizeService), agent_server);
+    g_signal_connect(interface, "handle-request-confirmation",
+        G_CALLBACK(agent_server->RequestConfirmation), agent_server);
+    g_signal_connect(interface, "handle-request-authorization",
+        G_CALLBACK(agent_server->RequestAuthorization), agent_server);
+    if (NULL == error) {
+        control_server_export(services->control_server, connection,
+            CONFIG_OBJECT_PATH, &error);
+    }
     if (NULL != error) {
         g_error("Couldn't register object: %s", error->message);
     }
 }
 
+static void name_acquired(GDBusConnection* connection, const gchar* name,
+    const gpointer user_data)
+{
+    struct services* services = (struct services*)user_data;
+    g_info("Agent listening on D-Bus at dest=%s,path=%s", name,
+        CONFIG_OBJECT_PATH);
+
+    // We're already the default agent, so the old one can go
+    handoff_client_complete(&services->handoff_client);
+}
+
 static void name_lost(GDBusConnection* connection, const gchar* name,
     gpointer user_data)
 {
+    struct services* services = (struct services*)user_data;
+    if (NULL != services->handoff_server
+        && handoff_server_in_progress(services->handoff_server)) {
+        g_info("Handoff: %s is owned by our successor now", name);
+        return;
+    }
     g_error("Lost name on connection, or unable to own name");
 }
 
+// Everything that a configuration reload may need to touch
+struct runtime {
+    const struct arguments* arguments;
+    Settings* settings;
+    const ActivationSockets* activation_sockets;
+    StatePublisher* state_publisher;
+    AgentServer* agent_server;
+    BluezClient* bluez_client;
+    WebServer* web_server;
+    WebListener* lan_listener;
+    WebListener* local_listener;
+    CertificateWatcher* certificate_watcher;
+    IdleMonitor* idle_monitor;
+    Provisioning* provisioning;
+    HandoffServer* handoff_server;
+    guint drain_id;
+};
+
+static const guint DRAIN_POLL_MILLISECONDS = 50;
+
+static void set_discovery_filter(struct runtime* runtime) {
+    const Settings* settings = runtime->settings;
+    BluezDiscoveryFilter filter = {
+        .transport = settings->discovery_transport,
+        .rssi_floor = (short)settings->discovery_rssi_floor,
+        .uuids = (const char* const*)settings->discovery_uuids,
+    };
+    bluez_client_set_discovery_filter(runtime->bluez_client, &filter);
+}
+
+static void set_log_verbosity(const Settings* settings) {
+    logger_reset_verbosity();
+    for (char** entry = settings->log_verbosity;
+         NULL != entry && NULL != *entry; ++entry) {
+        char** pair = g_strsplit(*entry, "=", 2);
+        logger_set_verbosity(strcmp(pair[0], "Default") ? pair[0] : NULL,
+            pair[1]);
+        g_strfreev(pair);
+    }
+}
+
+static void on_activity(void* user_data)
+{ idle_monitor_poke((IdleMonitor*)user_data); }
+
+static void set_idle_exit(struct runtime* runtime, unsigned int minutes) {
+    if (0 == minutes) {
+        web_listener_set_activity_callback(runtime->lan_listener, NULL, NULL);
+        web_listener_set_activity_callback(runtime->local_listener, NULL,
+            NULL);
+        idle_monitor_free(&runtime->idle_monitor);
+        return;
+    } else if (NULL != runtime->idle_monitor) {
+        idle_monitor_set_timeout(runtime->idle_monitor, minutes * 60);
+        return;
+    }
+
+    runtime->idle_monitor = idle_monitor_init(runtime->state_publisher,
+        runtime->agent_server, runtime->bluez_client, minutes * 60);
+    web_listener_set_activity_callback(runtime->lan_listener, on_activity,
+        runtime->idle_monitor);
+    web_listener_set_activity_callback(runtime->local_listener, on_activity,
+        runtime->idle_monitor);
+}
+
+static void on_certificate_renewed(GTlsCertificate* certificate,
+    void* user_data)
+{ web_listener_set_tls_certificate((WebListener*)user_data, certificate); }
+
+// Only the LAN listener speaks TLS; the control socket is local. Returns
+// non-zero, keeping the current certificate, if the new one can't be loaded.
+static int set_tls(struct runtime* runtime) {
+    const Settings* settings = runtime->settings;
+    CertificateWatcher* watcher = NULL;
+    if (NULL != settings->web_certificate) {
+        watcher = certificate_watcher_init(settings->web_certificate,
+            settings->web_private_key);
+        if (NULL == watcher) {
+            return 1;
+        }
+        certificate_watcher_set_callback(watcher, on_certificate_renewed,
+            runtime->lan_listener);
+    }
+
+    certificate_watcher_free(&runtime->certificate_watcher);
+    runtime->certificate_watcher = watcher;
+    web_listener_set_tls_certificate(runtime->lan_listener,
+        NULL != watcher ? certificate_watcher_get(watcher) : NULL);
+    return 0;
+}
+
+static int listen_lan(struct runtime* runtime) {
+    if (NULL != runtime->activation_sockets->web) {
+        return web_listener_listen_socket(runtime->lan_listener,
+            runtime->activation_sockets->web);
+    }
+
+    return web_listener_listen_inet(runtime->lan_listener,
+        runtime->settings->web_address, runtime->settings->web_port);
+}
+
+static int listen_control(struct runtime* runtime) {
+    if (NULL != runtime->activation_sockets->control) {
+        return web_listener_listen_socket(runtime->local_listener,
+            runtime->activation_sockets->control);
+    }
+
+    return web_listener_listen_unix(runtime->local_listener,
+        runtime->settings->control_socket);
+}
+
+// The listeners give up on requests that take too long, so this ends
+static gboolean on_drain_tick(gpointer user_data) {
+    struct runtime* runtime = (struct runtime*)user_data;
+    if (0 != runtime->web_server->in_flight) {
+        return G_SOURCE_CONTINUE;
+    }
+
+    g_info("Handoff: Requests drained, exiting");
+    runtime->drain_id = 0;
+    state_set(runtime->state_publisher, STATE_SHUTDOWN);
+    return G_SOURCE_REMOVE;
+}
+
+// The successor accepts on our sockets and is the default agent by now
+static void on_handed_off(void* user_data) {
+    struct runtime* runtime = (struct runtime*)user_data;
+    bluez_client_hand_over(runtime->bluez_client);
+    web_listener_release(runtime->lan_listener);
+    web_listener_release(runtime->local_listener);
+    runtime->drain_id = g_timeout_add(DRAIN_POLL_MILLISECONDS, on_drain_tick,
+        runtime);
+}
+
+// Re-read the configuration file, and rebuild only those subsystems whose
+// settings actually changed. Settings that couldn't be applied keep their
+// previous values, so that they're retried on the next reload.
+static int reload_handler(gpointer user_data) {
+    struct runtime* runtime = (struct runtime*)user_data;
+    Settings* settings = settings_init();
+    if (0 != settings_load(settings, runtime->arguments->config_file)) {
+        g_warning("Settings: Keeping the current configuration");
+        settings_free(&settings);
+        return G_SOURCE_CONTINUE;
+    }
+    apply_arguments(settings, runtime->arguments);
+
+    Settings* previous = runtime->settings;
+    const unsigned int changes = settings_diff(previous, settings);
+    g_info("Settings: Reloaded %s (changes=0x%x)",
+        runtime->arguments->config_file, changes);
+    if (changes & SETTINGS_CHANGED_ADAPTER) {
+        g_warning("Settings: Adapter changes take effect on restart");
+        g_free(settings->adapter);
+        settings->adapter = g_strdup(previous->adapter);
+    }
+    // The agent's object path is compiled in (CONFIG_OBJECT_PATH): the
+    // skeleton is exported there once, so only the capability can change.
+    if (changes & SETTINGS_CHANGED_CAPABILITY) {
+        if (0 == bluez_client_set_agent_capability(runtime->bluez_client,
+                CONFIG_OBJECT_PATH, settings->capability)) {
+            g_info("Settings: Agent re-registered as %s",
+                settings->capability);
+        } else {
+            g_warning("Settings: Keeping capability %s",
+                previous->capability);
+            g_free(settings->capability);
+            settings->capability = g_strdup(previous->capability);
+        }
+    }
+    if ((changes & SETTINGS_CHANGED_WEBROOT)
+        && 0 != web_server_set_webroot(runtime->web_server,
+            settings->webroot)) {
+        g_free(settings->webroot);
+        settings->webroot = g_strdup(previous->webroot);
+    }
+    if (changes & SETTINGS_CHANGED_LAN_ACCESS) {
+        runtime->web_server->lan_read_only = settings->lan_read_only;
+    }
+    if (changes & SETTINGS_CHANGED_WEB_LIMITS) {
+        web_server_set_limits(runtime->web_server, settings->web_request_rate,
+            settings->web_request_burst, settings->web_max_concurrent);
+    }
+
+    runtime->settings = settings;
+    if ((changes & SETTINGS_CHANGED_TLS) && 0 != set_tls(runtime)) {
+        g_free(settings->web_certificate);
+        g_free(settings->web_private_key);
+        settings->web_certificate = g_strdup(previous->web_certificate);
+        settings->web_private_key = g_strdup(previous->web_private_key);
+    }
+    // A listener that can't bind its new address stays where it was, and so
+    // does the setting
+    if (changes & SETTINGS_CHANGED_WEB_LISTEN) {
+        if (NULL != runtime->activation_sockets->web) {
+            g_warning("Settings: The web socket was inherited, restart to"
+                " move it");
+        } else if (0 != listen_lan(runtime)) {
+            g_warning("Settings: Still listening at %s:%u",
+                NULL != previous->web_address ? previous->web_address : "*",
+                previous->web_port);
+            g_free(settings->web_address);
+            settings->web_address = g_strdup(previous->web_address);
+            settings->web_port = previous->web_port;
+        }
+    }
+    if (changes & SETTINGS_CHANGED_CONTROL_SOCKET) {
+        if (NULL != runtime->activation_sockets->control) {
+            g_warning("Settings: The control socket was inherited, restart"
+                " to move it");
+        } else if (0 != listen_control(runtime)) {
+            g_warning("Settings: Still listening at %s",
+                previous->control_socket);
+            g_free(settings->control_socket);
+            settings->control_socket = g_strdup(previous->control_socket);
+        }
+    }
+    if (changes & SETTINGS_CHANGED_IDLE_EXIT) {
+        set_idle_exit(runtime, settings->idle_exit_minutes);
+    }
+    if (changes & SETTINGS_CHANGED_DISCOVERY) {
+        set_discovery_filter(runtime);
+    }
+    if (changes & SETTINGS_CHANGED_LOGGING) {
+        set_log_verbosity(settings);
+    }
+    if ((changes & SETTINGS_CHANGED_PROVISIONING)
+        && 0 != provisioning_load_manifest(runtime->provisioning,
+            settings->provisioning_manifest)) {
+        g_free(settings->provisioning_manifest);
+        settings->provisioning_manifest = g_strdup(
+            previous->provisioning_manifest);
+    }
+
+    settings_free(&previous);
+    return G_SOURCE_CONTINUE;
+}
+
 static int signal_handler(gpointer user_data) {
     // All attached signal sources just cause the loop to exit gracefully
     StatePublisher* publisher = (StatePublisher*)user_data;
@@ -111,16 +477,62 @@ static int signal_handler(gpointer user_data) {
 }
 
 int main(int argc, char** argv) {
-    struct arguments arguments = { .register_name = true, .device="hci0" };
+    struct arguments arguments = { .register_name = true,
+        .config_file = CONFIG_SETTINGS_PATH,
+        .state_file = CONFIG_STATE_PATH,
+        .webroot = getenv("AGENT_WEBROOT") };
     argp_parse(&argp, argc, argv, 0, 0, &arguments);
+    logger_init();
+
+    Settings* settings = settings_init();
+    if (NULL == settings) {
+        g_error("Couldn't allocate settings: %s", strerror(errno));
+    }
+    if (0 != settings_load(settings, arguments.config_file)) {
+        g_error("Couldn't load configuration from %s", arguments.config_file);
+    }
+    apply_arguments(settings, &arguments);
+    set_log_verbosity(settings);
+
+    // Sockets passed by systemd if we were socket-activated, or by the agent
+    // we're taking over from
+    ActivationSockets activation_sockets = {0};
+    HandoffClient* handoff_client = NULL;
+    enum State handed_over_state = STATE_NONE;
+    if (arguments.take_over) {
+        handoff_client = handoff_client_init(CONFIG_HANDOFF_SOCKET_PATH,
+            &activation_sockets, &handed_over_state);
+        if (NULL == handoff_client) {
+            g_error("Couldn't take over from the running agent");
+        }
+    } else {
+        activation_get_sockets(&activation_sockets);
+    }
 
     GError* error = NULL;
-    GDBusConnection* connection = g_bus_get_sync(G_BUS_TYPE_SYSTEM, NULL,
-        &error);
+    GDBusConnection* connection = NULL;
+    if (NULL != arguments.bus_address) {
+        connection = g_dbus_connection_new_for_address_sync(
+            arguments.bus_address,
+            G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT
+            | G_DBUS_CONNECTION_FLAGS_MESSAGE_BUS_CONNECTION, NULL, NULL,
+            &error);
+    } else {
+        connection = g_bus_get_sync(G_BUS_TYPE_SYSTEM, NULL, &error);
+    }
     if (NULL != error) {
         g_error("Couldn't connect to bus: %s", error->message);
     }
 
+    // Recording starts before anything talks to bluetoothd
+    DbusRecorder* recorder = NULL;
+    if (NULL != arguments.record_file) {
+        recorder = dbus_recorder_init(connection, arguments.record_file);
+        if (NULL == recorder) {
+            g_error("Couldn't record to %s", arguments.record_file);
+        }
+    }
+
     // State machine
     StatePublisher* state_publisher = state_init();
 
@@ -129,46 +541,148 @@ int main(int argc, char** argv) {
         g_error("Couldn't initialize agent server: %s", strerror(errno));
     }
 
-    if (arguments.register_name) {
-        g_bus_own_name_on_connection(connection, CONFIG_SERVICE_NAME,
-            G_BUS_NAME_OWNER_FLAGS_NONE, register_handlers, name_lost,
-            agent_server, NULL);
-    } else {
-        const gchar* service_name = g_dbus_connection_get_unique_name(
-            connection);
-        register_handlers(connection, service_name, agent_server);
-    }
-
     GMainLoop* main_loop = g_main_loop_new(NULL, FALSE);
     GMainContext* main_context = g_main_loop_get_context(main_loop);
 
     // Signal handlers for graceful shutdown
-    GSource* signal_source = g_unix_signal_source_new(SIGINT);
-    g_source_set_callback(signal_source, signal_handler, state_publisher,
-        NULL);
-    g_source_attach(signal_source, main_context);
-
-    // Web Server
-    const char* webroot_path = getenv("AGENT_WEBROOT");
-    if (NULL == webroot_path) {
-        webroot_path = CONFIG_WEBROOT_PATH;
-    }
-    WebServer* web_server = web_server_init(webroot_path, state_publisher);
-    SoupServer* soup_server = soup_server_new("tls-certificate", NULL,
-        "raw-paths", FALSE, "server-header", argp_program_name, NULL);
-    soup_server_add_handler(soup_server, "/", web_server->handle_connection,
-        web_server, NULL);
-    soup_server_listen_all(soup_server, CONFIG_WEB_SERVER_PORT, 0, &error);
-    g_info("Web server listening at 0.0.0.0:%d", CONFIG_WEB_SERVER_PORT);
+    const int shutdown_signals[] = { SIGINT, SIGTERM };
+    for (size_t i = 0; i < G_N_ELEMENTS(shutdown_signals); ++i) {
+        GSource* signal_source = g_unix_signal_source_new(
+            shutdown_signals[i]);
+        g_source_set_callback(signal_source, signal_handler, state_publisher,
+            NULL);
+        g_source_attach(signal_source, main_context);
+        g_source_unref(signal_source);
+    }
 
     // bluetoothd D-Bus client
     BluezClient* bluez_client = bluez_client_init(state_publisher, connection,
-        arguments.device);
+        settings->adapter);
+
+    // Checkpoint, so a restart can pick up where we left off
+    Checkpoint* checkpoint = checkpoint_init(arguments.state_file,
+        state_publisher, bluez_client);
+    if (NULL == checkpoint) {
+        g_error("Couldn't initialize checkpoint: %s", strerror(errno));
+    }
+
+    // Link quality of connected devices
+    LinkMonitor* link_monitor = link_monitor_init(bluez_client,
+        settings->adapter);
+    if (NULL == link_monitor) {
+        g_error("Couldn't initialize link monitor: %s", strerror(errno));
+    }
+
+    // Control interface for local services
+    ControlServer* control_server = control_server_init(state_publisher,
+        bluez_client, agent_server);
+    if (NULL == control_server) {
+        g_error("Couldn't initialize control server: %s", strerror(errno));
+    }
+
+    // Export, become the default agent, and only then take the name. During
+    // a handoff, our predecessor answers until we're the default agent, and
+    // we answer from then on. A successor may take the name from us later.
+    struct services services = {
+        .agent_server = agent_server,
+        .control_server = control_server,
+        .handoff_server = NULL,
+        .handoff_client = handoff_client,
+    };
+    export_objects(connection, &services);
     bluez_client_setup_agent(bluez_client, CONFIG_OBJECT_PATH,
-        CONFIG_AGENT_CAPABILITY);
+        settings->capability);
+    if (arguments.register_name) {
+        GBusNameOwnerFlags flags = G_BUS_NAME_OWNER_FLAGS_ALLOW_REPLACEMENT;
+        if (arguments.take_over) {
+            flags |= G_BUS_NAME_OWNER_FLAGS_REPLACE;
+        }
+        g_bus_own_name_on_connection(connection, CONFIG_SERVICE_NAME, flags,
+            name_acquired, name_lost, &services, NULL);
+    } else {
+        const gchar* service_name = g_dbus_connection_get_unique_name(
+            connection);
+        name_acquired(connection, service_name, &services);
+    }
+
+    // Bulk pairing against a manifest, alongside the state machine
+    Provisioning* provisioning = provisioning_init(state_publisher,
+        bluez_client, agent_server);
+    if (NULL == provisioning) {
+        g_error("Couldn't initialize provisioning: %s", strerror(errno));
+    }
 
-    // Bring up in STATE_CONNECTION_WAIT, then do the main loop
-    state_set(state_publisher, STATE_CONNECTION_WAIT);
+    // Web Server, on the network and on the local control socket
+    WebServer* web_server = web_server_init(settings->webroot,
+        state_publisher, bluez_client, link_monitor, provisioning);
+    if (NULL == web_server) {
+        g_error("Couldn't load web content from %s", settings->webroot);
+    }
+    web_server->lan_read_only = settings->lan_read_only;
+    web_server_set_limits(web_server, settings->web_request_rate,
+        settings->web_request_burst, settings->web_max_concurrent);
+
+    struct runtime runtime = {
+        .arguments = &arguments,
+        .settings = settings,
+        .activation_sockets = &activation_sockets,
+        .state_publisher = state_publisher,
+        .agent_server = agent_server,
+        .bluez_client = bluez_client,
+        .web_server = web_server,
+        .lan_listener = web_listener_init(web_server, argp_program_name),
+        .local_listener = web_listener_init(web_server, argp_program_name),
+        .certificate_watcher = NULL,
+        .idle_monitor = NULL,
+        .provisioning = provisioning,
+        .handoff_server = NULL,
+        .drain_id = 0,
+    };
+    if (NULL == runtime.lan_listener || NULL == runtime.local_listener) {
+        g_error("Couldn't initialize web listeners: %s", strerror(errno));
+    }
+    if (0 != set_tls(&runtime)) {
+        g_error("Couldn't load TLS certificate %s",
+            settings->web_certificate);
+    }
+    if (0 != listen_lan(&runtime)) {
+        g_warning("Web server isn't listening on the network");
+    }
+    if (0 != listen_control(&runtime)) {
+        g_warning("Web server isn't listening on the control socket");
+    }
+    set_idle_exit(&runtime, settings->idle_exit_minutes);
+    set_discovery_filter(&runtime);
+    if (0 != provisioning_load_manifest(provisioning,
+            settings->provisioning_manifest)) {
+        g_warning("Provisioning: Ignoring manifest %s",
+            settings->provisioning_manifest);
+        g_clear_pointer(&settings->provisioning_manifest, g_free);
+    }
+
+    // Wait for a successor, for upgrades without downtime
+    runtime.handoff_server = handoff_server_init(CONFIG_HANDOFF_SOCKET_PATH,
+        state_publisher, agent_server, runtime.lan_listener,
+        runtime.local_listener);
+    if (NULL == runtime.handoff_server) {
+        g_warning("Handoff: Upgrades will interrupt service");
+    } else {
+        handoff_server_set_callback(runtime.handoff_server, on_handed_off,
+            &runtime);
+    }
+    services.handoff_server = runtime.handoff_server;
+
+    GSource* reload_source = g_unix_signal_source_new(SIGHUP);
+    g_source_set_callback(reload_source, reload_handler, &runtime, NULL);
+    g_source_attach(reload_source, main_context);
+
+    // Bring up in the checkpointed state, or carry on where our predecessor
+    // is, then do the main loop
+    enum State initial_state = checkpoint_restore(checkpoint);
+    if (STATE_NONE != handed_over_state) {
+        initial_state = handed_over_state;
+    }
+    state_set(state_publisher, initial_state);
     while (STATE_SHUTDOWN != state_get(state_publisher)) {
         state_do_entry(state_publisher);
         g_main_context_iteration(main_context, FALSE);
@@ -177,10 +691,29 @@ int main(int argc, char** argv) {
 
     g_info("Exiting gracefully");
     state_do_entry(state_publisher); // <- need to "enter" STATE_SHUTDOWN
-    bluez_client_free(&bluez_client);
+    g_source_destroy(reload_source);
+    g_source_unref(reload_source);
+    if (0 != runtime.drain_id) {
+        g_source_remove(runtime.drain_id);
+    }
+    handoff_client_free(&services.handoff_client);
+    handoff_server_free(&runtime.handoff_server);
+    set_idle_exit(&runtime, 0);
+    web_listener_free(&runtime.local_listener);
+    web_listener_free(&runtime.lan_listener);
+    certificate_watcher_free(&runtime.certificate_watcher);
     web_server_free(&web_server);
+    provisioning_free(&provisioning);
+    control_server_free(&control_server);
+    link_monitor_free(&link_monitor);
+    checkpoint_free(&checkpoint);
+    bluez_client_free(&bluez_client);
     agent_server_free(&agent_server);
+    dbus_recorder_free(&recorder);
     state_deref(&state_publisher);
+    settings_free(&runtime.settings);
+    activation_sockets_clear(&activation_sockets);
+    logger_shutdown();
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,219 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            bluez-iot-agentctl.c
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Command-line client for the agent's local control socket
+//
+// CREATED:         10/18/2026
+//
+// LAST EDITED:     10/18/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+#include <argp.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <gio/gunixsocketaddress.h>
+#include <glib.h>
+#include <libsoup/soup.h>
+
+#include <config.h>
+
+const char* argp_program_name = CONFIG_PROGRAM_NAME "ctl "
+    CONFIG_PROGRAM_VERSION;
+const char* argp_program_bug_address = "<ethan.twardy@gmail.com>";
+
+static char doc[] = "Query and control a running " CONFIG_PROGRAM_NAME
+    "\v"
+    "Commands:\n"
+    "  state                  Print the agent's state\n"
+    "  devices                Print the devices known to the adapter\n"
+    "  pairing start|stop     Enter or leave pairing mode\n"
+    "  discovery start|stop   Start or stop scanning for nearby devices\n"
+    "  trust|untrust MAC      Change whether a device is trusted\n"
+    "  block|unblock MAC      Change whether a device is blocked\n"
+    "  connect|disconnect MAC Connect or disconnect a device\n"
+    "  remove MAC             Remove a device from the adapter";
+static char args_doc[] = "COMMAND [ARGUMENT]";
+
+static error_t parse_opt(int, char*, struct argp_state*);
+static const struct argp_option options[] = {
+    { "socket", 's', "PATH", 0,
+      "Path of the control socket (" CONFIG_CONTROL_SOCKET_PATH
+      " by default)", 0 },
+    { 0 },
+};
+static struct argp argp = { options, parse_opt, args_doc, doc, NULL, NULL,
+    NULL };
+
+struct arguments {
+    const char* socket;
+    const char* command;
+    const char* argument;
+};
+
+// Maps a command onto a request against the REST API
+typedef struct Command {
+    const char* name;
+    const char* method;
+    const char* path_format;
+    bool takes_argument;
+} Command;
+
+static error_t parse_opt(int key, char* arg, struct argp_state* state) {
+    struct arguments* arguments = state->input;
+    switch (key) {
+    case 's':
+        arguments->socket = arg;
+        break;
+    case ARGP_KEY_ARG:
+        if (0 == state->arg_num) {
+            arguments->command = arg;
+        } else if (1 == state->arg_num) {
+            arguments->argument = arg;
+        } else {
+            argp_usage(state);
+        }
+        break;
+    case ARGP_KEY_END:
+        if (NULL == arguments->command) {
+            argp_usage(state);
+        }
+        break;
+    default:
+        return ARGP_ERR_UNKNOWN;
+    }
+
+    return 0;
+}
+
+static const Command* find_subcommand(const Command* commands,
+    size_t num_commands, const char* argument)
+{
+    for (size_t i = 0; NULL != argument && i < num_commands; ++i) {
+        if (!strcmp(commands[i].name, argument)) {
+            return &commands[i];
+        }
+    }
+    return NULL;
+}
+
+static const Command* find_command(const char* name, const char* argument) {
+    static const Command commands[] = {
+        { "state", "GET", "/api/state", false },
+        { "devices", "GET", "/api/devices", false },
+        { "trust", "POST", "/api/devices/%s/trust", true },
+        { "untrust", "DELETE", "/api/devices/%s/trust", true },
+        { "block", "POST", "/api/devices/%s/block", true },
+        { "unblock", "DELETE", "/api/devices/%s/block", true },
+        { "connect", "POST", "/api/devices/%s/connect", true },
+        { "disconnect", "DELETE", "/api/devices/%s/connect", true },
+        { "remove", "POST", "/api/devices/%s/remove", true },
+    };
+    static const Command pairing[] = {
+        { "start", "POST", "/api/pairing/start", false },
+        { "stop", "POST", "/api/pairing/stop", false },
+    };
+    static const Command discovery[] = {
+        { "start", "POST", "/api/discovery/start", false },
+        { "stop", "POST", "/api/discovery/stop", false },
+    };
+
+    if (!strcmp("pairing", name)) {
+        return find_subcommand(pairing, G_N_ELEMENTS(pairing), argument);
+    } else if (!strcmp("discovery", name)) {
+        return find_subcommand(discovery, G_N_ELEMENTS(discovery), argument);
+    }
+
+    for (size_t i = 0; i < G_N_ELEMENTS(commands); ++i) {
+        if (!strcmp(commands[i].name, name)) {
+            return &commands[i];
+        }
+    }
+    return NULL;
+}
+
+int main(int argc, char** argv) {
+    struct arguments arguments = { .socket = CONFIG_CONTROL_SOCKET_PATH };
+    argp_parse(&argp, argc, argv, 0, 0, &arguments);
+
+    const Command* command = find_command(arguments.command,
+        arguments.argument);
+    if (NULL == command
+        || (command->takes_argument && NULL == arguments.argument)) {
+        fprintf(stderr, "%s: invalid command, see --help\n", argv[0]);
+        return 2;
+    }
+
+    // The host is ignored, every connection goes to the Unix socket. The
+    // argument is escaped, so that it can't change the shape of the path.
+    char* argument = NULL;
+    if (NULL != arguments.argument) {
+        argument = g_uri_escape_string(arguments.argument, NULL, FALSE);
+    }
+    char* path = g_strdup_printf(command->path_format, argument);
+    char* uri = g_strdup_printf("http://localhost%s", path);
+    g_free(argument);
+    SoupMessage* message = soup_message_new(command->method, uri);
+    if (NULL == message) {
+        fprintf(stderr, "%s: invalid argument: %s\n", argv[0],
+            arguments.argument);
+        g_free(uri);
+        g_free(path);
+        return 2;
+    }
+
+    GSocketAddress* address = g_unix_socket_address_new(arguments.socket);
+    SoupSession* session = soup_session_new_with_options(
+        "remote-connectable", address, NULL);
+
+    GError* error = NULL;
+    GBytes* body = soup_session_send_and_read(session, message, NULL, &error);
+    int result = 0;
+    if (NULL != error) {
+        fprintf(stderr, "%s: %s: %s\n", argv[0], arguments.socket,
+            error->message);
+        g_error_free(error);
+        result = 1;
+    } else {
+        guint status = soup_message_get_status(message);
+        gsize length = 0;
+        const char* data = g_bytes_get_data(body, &length);
+        if (0 < length) {
+            fwrite(data, 1, length, stdout);
+            fputc('\n', stdout);
+        }
+        if (200 > status || 300 <= status) {
+            fprintf(stderr, "%s: %u %s\n", argv[0], status,
+                soup_message_get_reason_phrase(message));
+            result = 1;
+        }
+        g_bytes_unref(body);
+    }
+
+    g_object_unref(message);
+    g_object_unref(session);
+    g_object_unref(address);
+    g_free(uri);
+    g_free(path);
+    return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,465 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            bluez-simulator.c
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Stand-in for bluetoothd with simulated devices
+//
+// CREATED:         10/18/2026
+//
+// LAST EDITED:     10/18/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <gio/gio.h>
+#include <glib.h>
+
+#include <bluez.h>
+#include <bluez-simulator.h>
+#include <config.h>
+
+// How long a device is visible before it asks to pair
+static const guint PAIRING_DELAY_MS = 200;
+static const guint32 SIMULATED_PASSKEY = 123456;
+
+typedef struct BluezSimulator BluezSimulator;
+
+typedef struct SimulatedPairing {
+    BluezSimulator* simulator;
+    Device1* device;
+    char* object_path;
+    guint pairing_id;
+    gint64 arrived_at;
+    gint64 requested_at;
+    gint64 answered_at;   // <- 0 until the agent answers
+    bool approved;
+} SimulatedPairing;
+
+typedef struct BluezSimulator {
+    GDBusConnection* connection;
+    GDBusObjectManagerServer* object_manager;
+    AgentManager1* agent_manager;
+    Adapter1* adapter;
+    char* adapter_path;
+    GPtrArray* devices; // <- Device1 skeletons, in address order
+    unsigned int num_devices;
+
+    // The default agent, which pairing requests go to
+    char* agent_name;
+    char* agent_path;
+
+    guint pair_interval_ms;
+    guint arrival_id;
+    GPtrArray* pairings; // <- SimulatedPairing, in order of arrival
+    unsigned int num_answered;
+    GCancellable* cancellable;
+} BluezSimulator;
+
+///////////////////////////////////////////////////////////////////////////////
+// Private API
+////
+
+static char* priv_device_path(BluezSimulator* simulator, unsigned int index) {
+    return g_strdup_printf("%s/dev_02_00_00_00_%02X_%02X",
+        simulator->adapter_path, (index >> 8) & 0xff, index & 0xff);
+}
+
+static void priv_set_agent(BluezSimulator* simulator, const char* name,
+    const char* path)
+{
+    g_free(simulator->agent_name);
+    g_free(simulator->agent_path);
+    simulator->agent_name = g_strdup(name);
+    simulator->agent_path = g_strdup(path);
+}
+
+static gboolean priv_on_arrival(gpointer user_data);
+
+static gboolean priv_on_register_agent(AgentManager1* manager,
+    GDBusMethodInvocation* invocation, const gchar* agent,
+    const gchar* capability, gpointer user_data)
+{
+    BluezSimulator* simulator = (BluezSimulator*)user_data;
+    const char* sender = g_dbus_method_invocation_get_sender(invocation);
+    printf("Agent %s registered at %s (%s)\n", sender, agent, capability);
+    fflush(stdout);
+    if (NULL == simulator->agent_name) {
+        priv_set_agent(simulator, sender, agent);
+    }
+    agent_manager1_complete_register_agent(manager, invocation);
+    return TRUE;
+}
+
+static gboolean priv_on_request_default_agent(AgentManager1* manager,
+    GDBusMethodInvocation* invocation, const gchar* agent,
+    gpointer user_data)
+{
+    BluezSimulator* simulator = (BluezSimulator*)user_data;
+    priv_set_agent(simulator, g_dbus_method_invocation_get_sender(invocation),
+        agent);
+    if (0 != simulator->pair_interval_ms && 0 == simulator->arrival_id
+        && simulator->devices->len < simulator->num_devices) {
+        simulator->arrival_id = g_timeout_add(simulator->pair_interval_ms,
+            priv_on_arrival, simulator);
+    }
+    agent_manager1_complete_request_default_agent(manager, invocation);
+    return TRUE;
+}
+
+static gboolean priv_on_unregister_agent(AgentManager1* manager,
+    GDBusMethodInvocation* invocation, const gchar* agent,
+    gpointer user_data)
+{
+    BluezSimulator* simulator = (BluezSimulator*)user_data;
+    const char* sender = g_dbus_method_invocation_get_sender(invocation);
+    printf("Agent %s unregistered\n", sender);
+    fflush(stdout);
+    if (!g_strcmp0(sender, simulator->agent_name)) {
+        g_clear_pointer(&simulator->agent_name, g_free);
+        g_clear_pointer(&simulator->agent_path, g_free);
+    }
+    agent_manager1_complete_unregister_agent(manager, invocation);
+    return TRUE;
+}
+
+static gboolean priv_on_start_discovery(Adapter1* adapter,
+    GDBusMethodInvocation* invocation, gpointer user_data)
+{
+    adapter1_complete_start_discovery(adapter, invocation);
+    return TRUE;
+}
+
+static gboolean priv_on_stop_discovery(Adapter1* adapter,
+    GDBusMethodInvocation* invocation, gpointer user_data)
+{
+    adapter1_complete_stop_discovery(adapter, invocation);
+    return TRUE;
+}
+
+static gboolean priv_on_set_discovery_filter(Adapter1* adapter,
+    GDBusMethodInvocation* invocation, GVariant* filter, gpointer user_data)
+{
+    adapter1_complete_set_discovery_filter(adapter, invocation);
+    return TRUE;
+}
+
+static gboolean priv_on_remove_device(Adapter1* adapter,
+    GDBusMethodInvocation* invocation, const gchar* device,
+    gpointer user_data)
+{
+    BluezSimulator* simulator = (BluezSimulator*)user_data;
+    g_dbus_object_manager_server_unexport(simulator->object_manager, device);
+    adapter1_complete_remove_device(adapter, invocation);
+    return TRUE;
+}
+
+static gboolean priv_on_connect(Device1* device,
+    GDBusMethodInvocation* invocation, gpointer user_data)
+{
+    device1_set_connected(device, true);
+    device1_complete_connect(device, invocation);
+    return TRUE;
+}
+
+static gboolean priv_on_disconnect(Device1* device,
+    GDBusMethodInvocation* invocation, gpointer user_data)
+{
+    device1_set_connected(device, false);
+    device1_complete_disconnect(device, invocation);
+    return TRUE;
+}
+
+static void priv_export(BluezSimulator* simulator, const char* object_path,
+    gpointer interface)
+{
+    GDBusObjectSkeleton* object = g_dbus_object_skeleton_new(object_path);
+    g_dbus_object_skeleton_add_interface(object,
+        G_DBUS_INTERFACE_SKELETON(interface));
+    g_dbus_object_manager_server_export(simulator->object_manager, object);
+    g_object_unref(object);
+}
+
+static Device1* priv_add_device(BluezSimulator* simulator,
+    unsigned int index, bool connected)
+{
+    char address[18];
+    g_snprintf(address, sizeof(address), "02:00:00:00:%02X:%02X",
+        (index >> 8) & 0xff, index & 0xff);
+    char* alias = g_strdup_printf("Simulated %u", index);
+    char* object_path = priv_device_path(simulator, index);
+
+    Device1* device = device1_skeleton_new();
+    device1_set_address(device, address);
+    device1_set_address_type(device, "public");
+    device1_set_alias(device, alias);
+    device1_set_paired(device, connected);
+    device1_set_trusted(device, connected);
+    device1_set_blocked(device, false);
+    device1_set_connected(device, connected);
+    device1_set_rssi(device, -60);
+    device1_set_tx_power(device, 0);
+    g_signal_connect(device, "handle-connect", G_CALLBACK(priv_on_connect),
+        simulator);
+    g_signal_connect(device, "handle-disconnect",
+        G_CALLBACK(priv_on_disconnect), simulator);
+    priv_export(simulator, object_path, device);
+
+    g_free(object_path);
+    g_free(alias);
+    return device;
+}
+
+static void priv_on_confirmed(GObject* source, GAsyncResult* result,
+    gpointer user_data)
+{
+    GError* error = NULL;
+    GVariant* reply = g_dbus_connection_call_finish(G_DBUS_CONNECTION(source),
+        result, &error);
+    if (NULL != error && g_error_matches(error, G_IO_ERROR,
+            G_IO_ERROR_CANCELLED)) {
+        g_error_free(error);
+        return; // <- The simulator is gone
+    }
+
+    SimulatedPairing* pairing = (SimulatedPairing*)user_data;
+    BluezSimulator* simulator = pairing->simulator;
+    pairing->answered_at = g_get_monotonic_time();
+    if (NULL != error) {
+        printf("%s rejected: %s\n", device1_get_address(pairing->device),
+            error->message);
+        g_error_free(error);
+    } else {
+        g_variant_unref(reply);
+        pairing->approved = true;
+        device1_set_paired(pairing->device, true);
+        device1_set_connected(pairing->device, true);
+    }
+
+    if (++simulator->num_answered == simulator->pairings->len) {
+        printf("Every simulated device has been answered\n");
+        fflush(stdout);
+    }
+}
+
+// Stands in for the device starting to pair, some time after it's seen
+static gboolean priv_on_pairing(gpointer user_data) {
+    SimulatedPairing* pairing = (SimulatedPairing*)user_data;
+    BluezSimulator* simulator = pairing->simulator;
+    pairing->pairing_id = 0;
+    pairing->requested_at = g_get_monotonic_time();
+    g_dbus_connection_call(simulator->connection, simulator->agent_name,
+        simulator->agent_path, "org.bluez.Agent1", "RequestConfirmation",
+        g_variant_new("(ou)", pairing->object_path, SIMULATED_PASSKEY), NULL,
+        G_DBUS_CALL_FLAGS_NONE, -1, simulator->cancellable,
+        priv_on_confirmed, pairing);
+    return G_SOURCE_REMOVE;
+}
+
+// One device shows up each interval, while there's an agent to pair with
+static gboolean priv_on_arrival(gpointer user_data) {
+    BluezSimulator* simulator = (BluezSimulator*)user_data;
+    if (NULL == simulator->agent_name) {
+        return G_SOURCE_CONTINUE;
+    }
+
+    const unsigned int index = simulator->devices->len + 1;
+    SimulatedPairing* pairing = g_new0(SimulatedPairing, 1);
+    pairing->simulator = simulator;
+    pairing->device = priv_add_device(simulator, index, false);
+    pairing->object_path = priv_device_path(simulator, index);
+    pairing->arrived_at = g_get_monotonic_time();
+    g_ptr_array_add(simulator->devices, pairing->device);
+    g_ptr_array_add(simulator->pairings, pairing);
+    pairing->pairing_id = g_timeout_add(PAIRING_DELAY_MS, priv_on_pairing,
+        pairing);
+
+    if (simulator->devices->len < simulator->num_devices) {
+        return G_SOURCE_CONTINUE;
+    }
+    simulator->arrival_id = 0;
+    return G_SOURCE_REMOVE;
+}
+
+static void priv_pairing_free(gpointer data) {
+    SimulatedPairing* pairing = (SimulatedPairing*)data;
+    if (0 != pairing->pairing_id) {
+        g_source_remove(pairing->pairing_id);
+    }
+    g_free(pairing->object_path);
+    g_free(pairing);
+}
+
+static gint priv_compare_latency(gconstpointer first, gconstpointer second)
+{
+    const gint64 difference = *(const gint64*)first - *(const gint64*)second;
+    return 0 > difference ? -1 : 0 < difference;
+}
+
+static void priv_print_latency(const char* phase, GArray* latencies) {
+    if (0 == latencies->len) {
+        return;
+    }
+
+    g_array_sort(latencies, priv_compare_latency);
+    gint64 total = 0;
+    for (guint i = 0; i < latencies->len; ++i) {
+        total += g_array_index(latencies, gint64, i);
+    }
+    printf("%s over %u devices (ms): min %.3f, mean %.3f, p50 %.3f, "
+        "p95 %.3f, max %.3f\n", phase, latencies->len,
+        g_array_index(latencies, gint64, 0) / 1000.0,
+        (double)total / latencies->len / 1000.0,
+        g_array_index(latencies, gint64, latencies->len / 2) / 1000.0,
+        g_array_index(latencies, gint64, latencies->len * 95 / 100) / 1000.0,
+        g_array_index(latencies, gint64, latencies->len - 1) / 1000.0);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Public API
+////
+
+BluezSimulator* bluez_simulator_init(GDBusConnection* connection,
+    const char* adapter, unsigned int num_devices,
+    unsigned int num_connected, unsigned int pair_interval_ms)
+{
+    BluezSimulator* simulator = malloc(sizeof(BluezSimulator));
+    if (NULL == simulator) {
+        return NULL;
+    }
+
+    simulator->connection = g_object_ref(connection);
+    simulator->object_manager = g_dbus_object_manager_server_new("/");
+    simulator->adapter_path = g_strdup_printf("%s/%s",
+        CONFIG_ADAPTER_PATH_PREFIX, adapter);
+    simulator->devices = g_ptr_array_new_with_free_func(g_object_unref);
+    simulator->num_devices = num_devices;
+    simulator->agent_name = NULL;
+    simulator->agent_path = NULL;
+    simulator->pair_interval_ms = pair_interval_ms;
+    simulator->arrival_id = 0;
+    simulator->pairings = g_ptr_array_new_with_free_func(priv_pairing_free);
+    simulator->num_answered = 0;
+    simulator->cancellable = g_cancellable_new();
+
+    simulator->agent_manager = agent_manager1_skeleton_new();
+    g_signal_connect(simulator->agent_manager, "handle-register-agent",
+        G_CALLBACK(priv_on_register_agent), simulator);
+    g_signal_connect(simulator->agent_manager,
+        "handle-request-default-agent",
+        G_CALLBACK(priv_on_request_default_agent), simulator);
+    g_signal_connect(simulator->agent_manager, "handle-unregister-agent",
+        G_CALLBACK(priv_on_unregister_agent), simulator);
+    priv_export(simulator, CONFIG_ADAPTER_PATH_PREFIX,
+        simulator->agent_manager);
+
+    simulator->adapter = adapter1_skeleton_new();
+    adapter1_set_discoverable(simulator->adapter, false);
+    g_signal_connect(simulator->adapter, "handle-start-discovery",
+        G_CALLBACK(priv_on_start_discovery), simulator);
+    g_signal_connect(simulator->adapter, "handle-stop-discovery",
+        G_CALLBACK(priv_on_stop_discovery), simulator);
+    g_signal_connect(simulator->adapter, "handle-set-discovery-filter",
+        G_CALLBACK(priv_on_set_discovery_filter), simulator);
+    g_signal_connect(simulator->adapter, "handle-remove-device",
+        G_CALLBACK(priv_on_remove_device), simulator);
+    priv_export(simulator, simulator->adapter_path, simulator->adapter);
+
+    // With pairing simulated, the others arrive once there's an agent
+    const unsigned int num_present = 0 != pair_interval_ms
+        ? num_connected : num_devices;
+    for (unsigned int i = 1; i <= num_present; ++i) {
+        g_ptr_array_add(simulator->devices, priv_add_device(simulator, i,
+                i <= num_connected));
+    }
+
+    g_dbus_object_manager_server_set_connection(simulator->object_manager,
+        connection);
+    return simulator;
+}
+
+void bluez_simulator_free(BluezSimulator** simulator) {
+    if (NULL == *simulator) {
+        return;
+    }
+
+    if (0 != (*simulator)->arrival_id) {
+        g_source_remove((*simulator)->arrival_id);
+    }
+    g_cancellable_cancel((*simulator)->cancellable);
+    g_object_unref((*simulator)->cancellable);
+    g_ptr_array_unref((*simulator)->pairings);
+    g_free((*simulator)->agent_name);
+    g_free((*simulator)->agent_path);
+    g_object_unref((*simulator)->object_manager);
+    g_ptr_array_unref((*simulator)->devices);
+    g_object_unref((*simulator)->adapter);
+    g_object_unref((*simulator)->agent_manager);
+    g_free((*simulator)->adapter_path);
+    g_object_unref((*simulator)->connection);
+    free(*simulator);
+    *simulator = NULL;
+}
+
+void bluez_simulator_print_summary(BluezSimulator* simulator) {
+    GPtrArray* pairings = simulator->pairings;
+    if (0 == pairings->len) {
+        return;
+    }
+
+    GArray* confirmation = g_array_new(FALSE, FALSE, sizeof(gint64));
+    GArray* total = g_array_new(FALSE, FALSE, sizeof(gint64));
+    const gint64 started_at = ((SimulatedPairing*)pairings->pdata[0])
+        ->arrived_at;
+    gint64 finished_at = started_at;
+    unsigned int paired = 0;
+    for (guint i = 0; i < pairings->len; ++i) {
+        SimulatedPairing* pairing = pairings->pdata[i];
+        if (0 == pairing->answered_at) {
+            continue;
+        }
+
+        gint64 latency = pairing->answered_at - pairing->requested_at;
+        g_array_append_val(confirmation, latency);
+        if (pairing->approved) {
+            ++paired;
+            latency = pairing->answered_at - pairing->arrived_at;
+            g_array_append_val(total, latency);
+            finished_at = MAX(finished_at, pairing->answered_at);
+        }
+    }
+
+    const double minutes = (double)(finished_at - started_at)
+        / G_TIME_SPAN_MINUTE;
+    printf("Paired %u of %u arrivals, %u rejected, %u unanswered",
+        paired, pairings->len, simulator->num_answered - paired,
+        pairings->len - simulator->num_answered);
+    if (0 < paired && 0 < minutes) {
+        printf("; %.1f devices per minute", paired / minutes);
+    }
+    printf("\n");
+    priv_print_latency("Agent confirmation", confirmation);
+    priv_print_latency("Arrival to connected", total);
+    g_array_unref(confirmation);
+    g_array_unref(total);
+}
+
+///////////////////////////////////////////////////////////////////////////////
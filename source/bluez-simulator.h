@@ -0,0 +1,56 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            bluez-simulator.h
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Stand-in for bluetoothd with simulated devices
+//
+// CREATED:         10/18/2026
+//
+// LAST EDITED:     10/18/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+#ifndef BLUEZ_SIMULATOR_H
+#define BLUEZ_SIMULATOR_H
+
+typedef struct _GDBusConnection GDBusConnection;
+
+// Plays the part of bluetoothd for devices that don't exist: exports an
+// adapter and its devices through the object manager at /, as bluetoothd
+// does, and accepts the agent's registration. Devices are locally
+// administered addresses, 02:00:00:00:00:01 onwards. The first num_connected
+// are paired and connected from the start.
+//
+// Without a pairing interval, the rest have only been seen. Otherwise they
+// arrive one every interval once an agent is the default, and each asks the
+// agent for RequestConfirmation shortly after it's seen. If the agent
+// approves, the device is marked paired and connected at once.
+typedef struct BluezSimulator BluezSimulator;
+
+// Objects are exported on the connection, but org.bluez isn't owned
+BluezSimulator* bluez_simulator_init(GDBusConnection* connection,
+    const char* adapter, unsigned int num_devices,
+    unsigned int num_connected, unsigned int pair_interval_ms);
+// Prints the devices paired per minute, and the latency of the agent's
+// answer and from arrival to connection, if pairing was simulated
+void bluez_simulator_print_summary(BluezSimulator* simulator);
+void bluez_simulator_free(BluezSimulator** simulator);
+
+#endif // BLUEZ_SIMULATOR_H
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,178 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            buffer-pool.c
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Recycled response buffers
+//
+// CREATED:         10/18/2026
+//
+// LAST EDITED:     10/18/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+
+#include <buffer-pool.h>
+
+// Blocks from 256 bytes up to 64 KiB are recycled. Anything larger is rare
+// enough that it's just allocated.
+enum {
+    MINIMUM_BLOCK_SHIFT = 8,
+    NUM_SIZE_CLASSES = 9,
+    MAXIMUM_FREE_PER_CLASS = 4,
+};
+
+typedef struct BufferPool BufferPool;
+
+typedef struct PoolBlock {
+    BufferPool* pool;
+    struct PoolBlock* next;
+    size_t capacity;
+    int size_class; // <- -1 if the block isn't recycled
+    unsigned char data[];
+} PoolBlock;
+
+typedef struct BufferPool {
+    enum MemoryDomain domain;
+    PoolBlock* free_blocks[NUM_SIZE_CLASSES];
+    unsigned int num_free[NUM_SIZE_CLASSES];
+    unsigned int outstanding;
+    bool closing;
+} BufferPool;
+
+///////////////////////////////////////////////////////////////////////////////
+// Private API
+////
+
+static int priv_size_class(size_t length) {
+    size_t capacity = (size_t)1 << MINIMUM_BLOCK_SHIFT;
+    for (int size_class = 0; size_class < NUM_SIZE_CLASSES; ++size_class) {
+        if (length <= capacity) {
+            return size_class;
+        }
+        capacity <<= 1;
+    }
+    return -1;
+}
+
+static void priv_block_free(BufferPool* pool, PoolBlock* block) {
+    memory_stats_released(pool->domain, block->capacity);
+    free(block);
+}
+
+static void priv_release_free_blocks(BufferPool* pool) {
+    for (int i = 0; i < NUM_SIZE_CLASSES; ++i) {
+        while (NULL != pool->free_blocks[i]) {
+            PoolBlock* block = pool->free_blocks[i];
+            pool->free_blocks[i] = block->next;
+            priv_block_free(pool, block);
+        }
+        pool->num_free[i] = 0;
+    }
+}
+
+static void priv_on_bytes_released(gpointer user_data) {
+    PoolBlock* block = (PoolBlock*)user_data;
+    BufferPool* pool = block->pool;
+    --pool->outstanding;
+    if (pool->closing) {
+        priv_block_free(pool, block);
+        if (0 == pool->outstanding) {
+            free(pool);
+        }
+        return;
+    }
+
+    const int size_class = block->size_class;
+    if (0 > size_class
+        || MAXIMUM_FREE_PER_CLASS <= pool->num_free[size_class]) {
+        priv_block_free(pool, block);
+        return;
+    }
+
+    block->next = pool->free_blocks[size_class];
+    pool->free_blocks[size_class] = block;
+    ++pool->num_free[size_class];
+}
+
+static PoolBlock* priv_block_get(BufferPool* pool, size_t length) {
+    const int size_class = priv_size_class(length);
+    if (0 <= size_class && NULL != pool->free_blocks[size_class]) {
+        PoolBlock* block = pool->free_blocks[size_class];
+        pool->free_blocks[size_class] = block->next;
+        --pool->num_free[size_class];
+        return block;
+    }
+
+    const size_t capacity = 0 <= size_class
+        ? (size_t)1 << (MINIMUM_BLOCK_SHIFT + size_class) : length;
+    PoolBlock* block = malloc(sizeof(PoolBlock) + capacity);
+    if (NULL == block) {
+        g_error("Couldn't allocate buffer: %s", strerror(errno));
+    }
+
+    memory_stats_allocated(pool->domain, capacity);
+    block->pool = pool;
+    block->capacity = capacity;
+    block->size_class = size_class;
+    return block;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Public API
+////
+
+BufferPool* buffer_pool_new(enum MemoryDomain domain) {
+    BufferPool* pool = calloc(1, sizeof(BufferPool));
+    if (NULL == pool) {
+        return NULL;
+    }
+
+    pool->domain = domain;
+    return pool;
+}
+
+GBytes* buffer_pool_copy(BufferPool* pool, const void* data, size_t length) {
+    PoolBlock* block = priv_block_get(pool, length);
+    block->next = NULL;
+    memcpy(block->data, data, length);
+    ++pool->outstanding;
+    return g_bytes_new_with_free_func(block->data, length,
+        priv_on_bytes_released, block);
+}
+
+void buffer_pool_free(BufferPool** pool) {
+    if (NULL == *pool) {
+        return;
+    }
+
+    priv_release_free_blocks(*pool);
+    if (0 == (*pool)->outstanding) {
+        free(*pool);
+    } else {
+        (*pool)->closing = true;
+    }
+    *pool = NULL;
+}
+
+///////////////////////////////////////////////////////////////////////////////
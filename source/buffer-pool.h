@@ -0,0 +1,52 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            buffer-pool.h
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Recycled response buffers
+//
+// CREATED:         10/18/2026
+//
+// LAST EDITED:     10/18/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+#ifndef BUFFER_POOL_H
+#define BUFFER_POOL_H
+
+#include <stddef.h>
+
+#include <memory-stats.h>
+
+typedef struct _GBytes GBytes;
+
+// Hands out GBytes backed by blocks in power-of-two size classes. When the
+// last reference to a GBytes is dropped, its block goes back to the pool
+// rather than to the heap, so that buffers which are rebuilt over and over
+// (response bodies, mostly) don't churn the allocator.
+typedef struct BufferPool BufferPool;
+
+BufferPool* buffer_pool_new(enum MemoryDomain domain);
+// Returns a new reference, release with g_bytes_unref()
+GBytes* buffer_pool_copy(BufferPool* pool, const void* data, size_t length);
+// Blocks still referenced elsewhere keep the pool alive until they're
+// returned.
+void buffer_pool_free(BufferPool** pool);
+
+#endif // BUFFER_POOL_H
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,180 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            certificate-watcher.c
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Keeps a TLS certificate loaded, and reloads it on renewal
+//
+// CREATED:         10/18/2026
+//
+// LAST EDITED:     10/18/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+#include <stdlib.h>
+
+#include <gio/gio.h>
+
+#include <certificate-watcher.h>
+
+typedef struct CertificateWatcher {
+    char* certificate_path;
+    char* key_path;
+    GTlsCertificate* certificate;
+    GFileMonitor* monitors[2];
+    guint reload_id;
+    void (*changed)(GTlsCertificate* certificate, void* user_data);
+    void* user_data;
+} CertificateWatcher;
+
+// Renewal replaces the certificate and the key separately; wait for both
+static const guint RELOAD_DELAY_SECONDS = 2;
+
+///////////////////////////////////////////////////////////////////////////////
+// Private API
+////
+
+static GTlsCertificate* priv_load(CertificateWatcher* watcher) {
+    GError* error = NULL;
+    GTlsCertificate* certificate = g_tls_certificate_new_from_files(
+        watcher->certificate_path, watcher->key_path, &error);
+    if (NULL != error) {
+        g_warning("CertificateWatcher: Couldn't load %s: %s",
+            watcher->certificate_path, error->message);
+        g_error_free(error);
+        return NULL;
+    }
+    return certificate;
+}
+
+static gboolean priv_on_reload(gpointer user_data) {
+    CertificateWatcher* watcher = (CertificateWatcher*)user_data;
+    watcher->reload_id = 0;
+    GTlsCertificate* certificate = priv_load(watcher);
+    if (NULL == certificate) {
+        return G_SOURCE_REMOVE;
+    } else if (g_tls_certificate_is_same(certificate, watcher->certificate)) {
+        g_object_unref(certificate);
+        return G_SOURCE_REMOVE;
+    }
+
+    g_info("CertificateWatcher: Loaded renewed certificate %s",
+        watcher->certificate_path);
+    g_object_unref(watcher->certificate);
+    watcher->certificate = certificate;
+    if (NULL != watcher->changed) {
+        watcher->changed(certificate, watcher->user_data);
+    }
+    return G_SOURCE_REMOVE;
+}
+
+static void priv_on_file_changed(GFileMonitor* monitor, GFile* file,
+    GFile* other_file, GFileMonitorEvent event, gpointer user_data)
+{
+    CertificateWatcher* watcher = (CertificateWatcher*)user_data;
+    if (G_FILE_MONITOR_EVENT_CHANGED == event
+        || G_FILE_MONITOR_EVENT_ATTRIBUTE_CHANGED == event) {
+        return; // <- Wait for CHANGES_DONE_HINT, or the file to be replaced
+    }
+
+    if (0 != watcher->reload_id) {
+        g_source_remove(watcher->reload_id);
+    }
+    watcher->reload_id = g_timeout_add_seconds(RELOAD_DELAY_SECONDS,
+        priv_on_reload, watcher);
+}
+
+static GFileMonitor* priv_monitor(CertificateWatcher* watcher,
+    const char* path)
+{
+    GError* error = NULL;
+    GFile* file = g_file_new_for_path(path);
+    GFileMonitor* monitor = g_file_monitor_file(file, G_FILE_MONITOR_NONE,
+        NULL, &error);
+    g_object_unref(file);
+    if (NULL != error) {
+        g_warning("CertificateWatcher: Renewals of %s won't be noticed: %s",
+            path, error->message);
+        g_error_free(error);
+        return NULL;
+    }
+
+    g_signal_connect(monitor, "changed", G_CALLBACK(priv_on_file_changed),
+        watcher);
+    return monitor;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Public API
+////
+
+CertificateWatcher* certificate_watcher_init(const char* certificate_path,
+    const char* key_path)
+{
+    CertificateWatcher* watcher = calloc(1, sizeof(CertificateWatcher));
+    if (NULL == watcher) {
+        return NULL;
+    }
+
+    watcher->certificate_path = g_strdup(certificate_path);
+    watcher->key_path = g_strdup(key_path);
+    watcher->certificate = priv_load(watcher);
+    if (NULL == watcher->certificate) {
+        certificate_watcher_free(&watcher);
+        return NULL;
+    }
+
+    watcher->monitors[0] = priv_monitor(watcher, certificate_path);
+    watcher->monitors[1] = priv_monitor(watcher, key_path);
+    return watcher;
+}
+
+GTlsCertificate* certificate_watcher_get(CertificateWatcher* watcher)
+{ return watcher->certificate; }
+
+void certificate_watcher_set_callback(CertificateWatcher* watcher,
+    void (*changed)(GTlsCertificate* certificate, void* user_data),
+    void* user_data)
+{
+    watcher->changed = changed;
+    watcher->user_data = user_data;
+}
+
+void certificate_watcher_free(CertificateWatcher** watcher) {
+    if (NULL == *watcher) {
+        return;
+    }
+
+    for (size_t i = 0; i < G_N_ELEMENTS((*watcher)->monitors); ++i) {
+        if (NULL != (*watcher)->monitors[i]) {
+            g_signal_handlers_disconnect_by_data((*watcher)->monitors[i],
+                *watcher);
+            g_file_monitor_cancel((*watcher)->monitors[i]);
+            g_object_unref((*watcher)->monitors[i]);
+        }
+    }
+    if (0 != (*watcher)->reload_id) {
+        g_source_remove((*watcher)->reload_id);
+    }
+    g_clear_object(&(*watcher)->certificate);
+    g_free((*watcher)->certificate_path);
+    g_free((*watcher)->key_path);
+    free(*watcher);
+    *watcher = NULL;
+}
+
+///////////////////////////////////////////////////////////////////////////////
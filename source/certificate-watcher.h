@@ -0,0 +1,51 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            certificate-watcher.h
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Keeps a TLS certificate loaded, and reloads it on renewal
+//
+// CREATED:         10/18/2026
+//
+// LAST EDITED:     10/18/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+#ifndef CERTIFICATE_WATCHER_H
+#define CERTIFICATE_WATCHER_H
+
+typedef struct _GTlsCertificate GTlsCertificate;
+
+// The certificate and key are parsed once, and again only when either file
+// changes on disk (e.g. when a renewal job replaces them). A renewal that
+// fails to load leaves the previous certificate in service.
+typedef struct CertificateWatcher CertificateWatcher;
+
+// Returns NULL if the certificate or key can't be loaded
+CertificateWatcher* certificate_watcher_init(const char* certificate_path,
+    const char* key_path);
+// The returned certificate is owned by the watcher
+GTlsCertificate* certificate_watcher_get(CertificateWatcher* watcher);
+// Invoked after a renewed certificate is loaded
+void certificate_watcher_set_callback(CertificateWatcher* watcher,
+    void (*changed)(GTlsCertificate* certificate, void* user_data),
+    void* user_data);
+void certificate_watcher_free(CertificateWatcher** watcher);
+
+#endif // CERTIFICATE_WATCHER_H
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,343 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            checkpoint.c
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Implementation of the state checkpoint
+//
+// CREATED:         10/18/2026
+//
+// LAST EDITED:     10/18/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <bluez.h>
+#include <bluez-client.h>
+#include <checkpoint.h>
+
+// On-disk format, in host byte order. The checksum covers the whole file
+// with the checksum field itself set to zero. Bump the version whenever the
+// layout changes; checkpoints of other versions are ignored.
+typedef struct CheckpointHeader {
+    char magic[4];
+    uint16_t version;
+    uint16_t num_devices;
+    uint32_t state;
+    uint32_t checksum;
+    int64_t state_entered_at; // <- Wall clock, microseconds
+} CheckpointHeader;
+
+typedef struct CheckpointDevice {
+    char address[18];
+    uint8_t flags;
+    uint8_t reserved;
+} CheckpointDevice;
+
+_Static_assert(24 == sizeof(CheckpointHeader), "Checkpoint header layout");
+_Static_assert(20 == sizeof(CheckpointDevice), "Checkpoint device layout");
+
+static const char CHECKPOINT_MAGIC[4] = { 'B', 'I', 'A', 'C' };
+static const uint16_t CHECKPOINT_VERSION = 1;
+
+static const uint8_t DEVICE_PAIRED    = 1 << 0;
+static const uint8_t DEVICE_TRUSTED   = 1 << 1;
+static const uint8_t DEVICE_BLOCKED   = 1 << 2;
+static const uint8_t DEVICE_CONNECTED = 1 << 3;
+
+// Devices change often (RSSI, for one), so writes for them are coalesced
+static const guint DEVICE_WRITE_DELAY_SECONDS = 5;
+
+typedef struct Checkpoint {
+    char* path;
+    StatePublisher* state_publisher;
+    BluezClient* bluez_client;
+    StateObserverHandle state_observer;
+    unsigned int devices_listener;
+
+    enum State state;
+    int64_t state_entered_at;
+    GBytes* last_written;
+    guint write_id;
+} Checkpoint;
+
+///////////////////////////////////////////////////////////////////////////////
+// Private API
+////
+
+static uint32_t priv_checksum(const uint8_t* data, size_t length) {
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; ++i) {
+        hash ^= data[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static void priv_append_device(Device1* device, void* user_data) {
+    GByteArray* buffer = (GByteArray*)user_data;
+    CheckpointDevice record = {0};
+    const char* address = device1_get_address(device);
+    if (NULL == address) {
+        return;
+    }
+
+    g_strlcpy(record.address, address, sizeof(record.address));
+    record.flags = (device1_get_paired(device) ? DEVICE_PAIRED : 0)
+        | (device1_get_trusted(device) ? DEVICE_TRUSTED : 0)
+        | (device1_get_blocked(device) ? DEVICE_BLOCKED : 0)
+        | (device1_get_connected(device) ? DEVICE_CONNECTED : 0);
+    g_byte_array_append(buffer, (const guint8*)&record, sizeof(record));
+}
+
+static GBytes* priv_serialize(Checkpoint* checkpoint) {
+    GByteArray* buffer = g_byte_array_sized_new(sizeof(CheckpointHeader)
+        + sizeof(CheckpointDevice)
+        * bluez_client_get_num_devices(checkpoint->bluez_client));
+    CheckpointHeader header = {0};
+    g_byte_array_append(buffer, (const guint8*)&header, sizeof(header));
+    bluez_client_foreach_device(checkpoint->bluez_client, priv_append_device,
+        buffer);
+
+    memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic));
+    header.version = CHECKPOINT_VERSION;
+    header.num_devices = (buffer->len - sizeof(header))
+        / sizeof(CheckpointDevice);
+    header.state = checkpoint->state;
+    header.state_entered_at = checkpoint->state_entered_at;
+    memcpy(buffer->data, &header, sizeof(header));
+    header.checksum = priv_checksum(buffer->data, buffer->len);
+    memcpy(buffer->data, &header, sizeof(header));
+    return g_byte_array_free_to_bytes(buffer);
+}
+
+static void priv_write(Checkpoint* checkpoint) {
+    if (0 != checkpoint->write_id) {
+        g_source_remove(checkpoint->write_id);
+        checkpoint->write_id = 0;
+    }
+
+    GBytes* contents = priv_serialize(checkpoint);
+    if (NULL != checkpoint->last_written
+        && g_bytes_equal(contents, checkpoint->last_written)) {
+        g_bytes_unref(contents);
+        return;
+    }
+
+    gchar* directory = g_path_get_dirname(checkpoint->path);
+    g_mkdir_with_parents(directory, 0755);
+    g_free(directory);
+
+    // Writes to a temporary file and renames it over the checkpoint
+    gsize length = 0;
+    const gchar* data = g_bytes_get_data(contents, &length);
+    GError* error = NULL;
+    if (!g_file_set_contents(checkpoint->path, data, length, &error)) {
+        g_warning("Checkpoint: Couldn't write %s: %s", checkpoint->path,
+            error->message);
+        g_error_free(error);
+        g_bytes_unref(contents);
+        return;
+    }
+
+    if (NULL != checkpoint->last_written) {
+        g_bytes_unref(checkpoint->last_written);
+    }
+    checkpoint->last_written = contents;
+}
+
+static gboolean priv_on_write_timeout(gpointer user_data) {
+    Checkpoint* checkpoint = (Checkpoint*)user_data;
+    checkpoint->write_id = 0;
+    priv_write(checkpoint);
+    return G_SOURCE_REMOVE;
+}
+
+static void priv_on_entry(enum State state, void* user_data) {
+    Checkpoint* checkpoint = (Checkpoint*)user_data;
+    if (state == checkpoint->state) {
+        return;
+    }
+
+    checkpoint->state = state;
+    checkpoint->state_entered_at = g_get_real_time();
+    priv_write(checkpoint);
+}
+
+static void priv_on_devices_changed(void* user_data) {
+    Checkpoint* checkpoint = (Checkpoint*)user_data;
+    if (0 == checkpoint->write_id) {
+        checkpoint->write_id = g_timeout_add_seconds(
+            DEVICE_WRITE_DELAY_SECONDS, priv_on_write_timeout, checkpoint);
+    }
+}
+
+static const CheckpointHeader* priv_validate(const uint8_t* data,
+    size_t length)
+{
+    if (length < sizeof(CheckpointHeader)) {
+        return NULL;
+    }
+
+    CheckpointHeader header;
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic))
+        || CHECKPOINT_VERSION != header.version
+        || length != sizeof(header)
+        + header.num_devices * sizeof(CheckpointDevice)) {
+        return NULL;
+    }
+
+    // The mapping is read-only, so verify the checksum over a copy
+    uint8_t* copy = g_memdup2(data, length);
+    memset(copy + offsetof(CheckpointHeader, checksum), 0,
+        sizeof(header.checksum));
+    const bool valid = header.checksum == priv_checksum(copy, length);
+    g_free(copy);
+    return valid ? (const CheckpointHeader*)data : NULL;
+}
+
+// The connected state is only believable if a device that was connected when
+// the checkpoint was taken is still connected now, according to bluetoothd.
+// Returns that device's address, or NULL.
+static const char* priv_find_live_connection(Checkpoint* checkpoint,
+    const CheckpointDevice* devices, uint16_t num_devices)
+{
+    for (uint16_t i = 0; i < num_devices; ++i) {
+        char address[sizeof(devices[i].address) + 1] = {0};
+        memcpy(address, devices[i].address, sizeof(devices[i].address));
+        if (!(devices[i].flags & DEVICE_CONNECTED)) {
+            continue;
+        }
+
+        Device1* device = bluez_client_get_device(checkpoint->bluez_client,
+            address);
+        if (NULL != device && device1_get_connected(device)) {
+            return device1_get_address(device);
+        }
+    }
+    return NULL;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Public API
+////
+
+Checkpoint* checkpoint_init(const char* path, StatePublisher* state_publisher,
+    BluezClient* bluez_client)
+{
+    Checkpoint* checkpoint = malloc(sizeof(Checkpoint));
+    if (NULL == checkpoint) {
+        return NULL;
+    }
+
+    checkpoint->path = g_strdup(path);
+    state_ref(state_publisher);
+    checkpoint->state_publisher = state_publisher;
+    checkpoint->bluez_client = bluez_client;
+    checkpoint->state = STATE_NONE;
+    checkpoint->state_entered_at = 0;
+    checkpoint->last_written = NULL;
+    checkpoint->write_id = 0;
+
+    // Shutdown isn't a state we'd want to resume in
+    checkpoint->state_observer = state_add_observer_full(state_publisher,
+        NULL, priv_on_entry, checkpoint, STATE_PRIORITY_LOW,
+        STATE_MASK(STATE_CONNECTION_WAIT) | STATE_MASK(STATE_CONNECTED)
+        | STATE_MASK(STATE_PAIRABLE));
+    checkpoint->devices_listener = bluez_client_add_devices_listener(
+        bluez_client, priv_on_devices_changed, checkpoint);
+    return checkpoint;
+}
+
+enum State checkpoint_restore(Checkpoint* checkpoint) {
+    GError* error = NULL;
+    GMappedFile* file = g_mapped_file_new(checkpoint->path, FALSE, &error);
+    if (NULL == file) {
+        if (!g_error_matches(error, G_FILE_ERROR, G_FILE_ERROR_NOENT)) {
+            g_warning("Checkpoint: Couldn't load %s: %s", checkpoint->path,
+                error->message);
+        }
+        g_error_free(error);
+        return STATE_CONNECTION_WAIT;
+    }
+
+    const uint8_t* data = (const uint8_t*)g_mapped_file_get_contents(file);
+    const size_t length = g_mapped_file_get_length(file);
+    const CheckpointHeader* header = priv_validate(data, length);
+    enum State state = STATE_CONNECTION_WAIT;
+    if (NULL == header) {
+        g_warning("Checkpoint: Ignoring invalid checkpoint %s",
+            checkpoint->path);
+        g_mapped_file_unref(file);
+        return state;
+    }
+
+    // Pairing mode is always explicitly requested, so it's never resumed.
+    const CheckpointDevice* devices = (const CheckpointDevice*)(
+        data + sizeof(CheckpointHeader));
+    if (STATE_CONNECTED == header->state) {
+        const char* address = priv_find_live_connection(checkpoint, devices,
+            header->num_devices);
+        if (NULL != address) {
+            g_info("Checkpoint: %s is still connected", address);
+            state = STATE_CONNECTED;
+        } else {
+            g_info("Checkpoint: No device is still connected");
+        }
+    }
+
+    if (state == header->state) {
+        checkpoint->state = state;
+        checkpoint->state_entered_at = header->state_entered_at;
+        checkpoint->last_written = g_bytes_new(data, length);
+    }
+
+    g_info("Checkpoint: Resuming in %s (%u devices indexed)",
+        state_to_string(state), (unsigned int)header->num_devices);
+    g_mapped_file_unref(file);
+    return state;
+}
+
+void checkpoint_free(Checkpoint** checkpoint) {
+    if (NULL == *checkpoint) {
+        return;
+    }
+
+    if (0 != (*checkpoint)->write_id) {
+        priv_write(*checkpoint);
+    }
+    bluez_client_remove_devices_listener((*checkpoint)->bluez_client,
+        (*checkpoint)->devices_listener);
+    state_remove_observer((*checkpoint)->state_publisher,
+        (*checkpoint)->state_observer);
+    state_deref(&(*checkpoint)->state_publisher);
+    if (NULL != (*checkpoint)->last_written) {
+        g_bytes_unref((*checkpoint)->last_written);
+    }
+    g_free((*checkpoint)->path);
+    free(*checkpoint);
+    *checkpoint = NULL;
+}
+
+///////////////////////////////////////////////////////////////////////////////
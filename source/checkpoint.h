@@ -0,0 +1,50 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            checkpoint.h
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Persist agent state across restarts
+//
+// CREATED:         10/18/2026
+//
+// LAST EDITED:     10/18/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <state.h>
+
+typedef struct BluezClient BluezClient;
+
+// The checkpoint holds the state machine and an index of known devices. It
+// is rewritten atomically whenever either changes, and only if its contents
+// differ from what's already on disk.
+typedef struct Checkpoint Checkpoint;
+
+Checkpoint* checkpoint_init(const char* path, StatePublisher* state_publisher,
+    BluezClient* bluez_client);
+// Returns the state to bring the agent up in, or STATE_CONNECTION_WAIT if
+// there is no usable checkpoint.
+enum State checkpoint_restore(Checkpoint* checkpoint);
+// Writes any outstanding changes before freeing
+void checkpoint_free(Checkpoint** checkpoint);
+
+#endif // CHECKPOINT_H
+
+///////////////////////////////////////////////////////////////////////////////
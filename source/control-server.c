@@ -0,0 +1,244 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            control-server.c
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Implementation of the Control D-Bus interface
+//
+// CREATED:         10/18/2026
+//
+// LAST EDITED:     10/18/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include <agent-server.h>
+#include <bluez.h>
+#include <bluez-client.h>
+#include <control-server.h>
+#include <iot-agent-control.h>
+#include <state.h>
+
+static const int DIRTY_STATE   = 1 << 0;
+static const int DIRTY_DEVICES = 1 << 1;
+static const int DIRTY_PENDING = 1 << 2;
+
+typedef struct ControlServer {
+    StatePublisher* state_publisher;
+    BluezClient* bluez_client;
+    AgentServer* agent_server;
+    IotAgentControl* interface;
+    bool exported;
+
+    StateObserverHandle state_observer;
+    unsigned int devices_listener;
+    unsigned int pending_listener;
+
+    // Changes are accumulated and applied from an idle callback, so a burst
+    // of device updates costs one rebuild and one PropertiesChanged.
+    int dirty;
+    guint refresh_id;
+} ControlServer;
+
+static const char* ERROR_NOT_PAIRABLE = "org.bluez.iot_agent.Error.NotPairable";
+
+///////////////////////////////////////////////////////////////////////////////
+// Private API
+////
+
+typedef struct DeviceLists {
+    GPtrArray* paired;
+    GPtrArray* connected;
+} DeviceLists;
+
+static void priv_collect_device(Device1* device, void* user_data) {
+    DeviceLists* lists = (DeviceLists*)user_data;
+    const char* path = g_dbus_proxy_get_object_path(G_DBUS_PROXY(device));
+    if (device1_get_paired(device)) {
+        g_ptr_array_add(lists->paired, (gpointer)path);
+    }
+    if (device1_get_connected(device)) {
+        g_ptr_array_add(lists->connected, (gpointer)path);
+    }
+}
+
+static void priv_refresh_devices(ControlServer* server) {
+    DeviceLists lists = {
+        .paired = g_ptr_array_new(),
+        .connected = g_ptr_array_new(),
+    };
+    bluez_client_foreach_device(server->bluez_client, priv_collect_device,
+        &lists);
+    g_ptr_array_add(lists.paired, NULL);
+    g_ptr_array_add(lists.connected, NULL);
+
+    // The generated setters only notify if the value actually changed
+    iot_agent_control_set_paired_devices(server->interface,
+        (const gchar* const*)lists.paired->pdata);
+    iot_agent_control_set_connected_devices(server->interface,
+        (const gchar* const*)lists.connected->pdata);
+    g_ptr_array_unref(lists.paired);
+    g_ptr_array_unref(lists.connected);
+}
+
+static void priv_collect_pending(const object_path* device,
+    const char* method, void* user_data)
+{
+    g_variant_builder_add((GVariantBuilder*)user_data, "(os)", device, method);
+}
+
+static void priv_refresh_pending(ControlServer* server) {
+    GVariantBuilder builder;
+    g_variant_builder_init(&builder, G_VARIANT_TYPE("a(os)"));
+    agent_server_foreach_pending(server->agent_server, priv_collect_pending,
+        &builder);
+    iot_agent_control_set_pending_requests(server->interface,
+        g_variant_builder_end(&builder));
+}
+
+static gboolean priv_refresh(gpointer user_data) {
+    ControlServer* server = (ControlServer*)user_data;
+    server->refresh_id = 0;
+    if (server->dirty & DIRTY_STATE) {
+        iot_agent_control_set_state(server->interface,
+            state_to_string(state_get(server->state_publisher)));
+    }
+    if (server->dirty & DIRTY_DEVICES) {
+        priv_refresh_devices(server);
+    }
+    if (server->dirty & DIRTY_PENDING) {
+        priv_refresh_pending(server);
+    }
+    server->dirty = 0;
+    return G_SOURCE_REMOVE;
+}
+
+static void priv_mark_dirty(ControlServer* server, int dirty) {
+    server->dirty |= dirty;
+    if (0 == server->refresh_id) {
+        server->refresh_id = g_idle_add(priv_refresh, server);
+    }
+}
+
+static void priv_on_entry(enum State state, void* user_data)
+{ priv_mark_dirty((ControlServer*)user_data, DIRTY_STATE); }
+
+static void priv_on_devices_changed(void* user_data)
+{ priv_mark_dirty((ControlServer*)user_data, DIRTY_DEVICES); }
+
+static void priv_on_pending_changed(void* user_data)
+{ priv_mark_dirty((ControlServer*)user_data, DIRTY_PENDING); }
+
+static gboolean start_pairing(IotAgentControl* interface,
+    GDBusMethodInvocation* invocation, gpointer user_data)
+{
+    ControlServer* server = (ControlServer*)user_data;
+    if (STATE_PAIRABLE != state_get(server->state_publisher)) {
+        state_set(server->state_publisher, STATE_PAIRABLE);
+    }
+    iot_agent_control_complete_start_pairing(interface, invocation);
+    return TRUE;
+}
+
+static gboolean stop_pairing(IotAgentControl* interface,
+    GDBusMethodInvocation* invocation, gpointer user_data)
+{
+    ControlServer* server = (ControlServer*)user_data;
+    if (STATE_PAIRABLE != state_get(server->state_publisher)) {
+        g_dbus_method_invocation_return_dbus_error(invocation,
+            ERROR_NOT_PAIRABLE, "Agent is not in pairing mode");
+        return TRUE;
+    }
+
+    state_set(server->state_publisher, STATE_CONNECTION_WAIT);
+    iot_agent_control_complete_stop_pairing(interface, invocation);
+    return TRUE;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Public API
+////
+
+ControlServer* control_server_init(StatePublisher* state_publisher,
+    BluezClient* bluez_client, AgentServer* agent_server)
+{
+    ControlServer* server = malloc(sizeof(ControlServer));
+    if (NULL == server) {
+        return NULL;
+    }
+
+    server->interface = iot_agent_control_skeleton_new();
+    server->exported = false;
+    g_signal_connect(server->interface, "handle-start-pairing",
+        G_CALLBACK(start_pairing), server);
+    g_signal_connect(server->interface, "handle-stop-pairing",
+        G_CALLBACK(stop_pairing), server);
+
+    state_ref(state_publisher);
+    server->state_publisher = state_publisher;
+    server->bluez_client = bluez_client;
+    server->agent_server = agent_server;
+    server->state_observer = state_add_observer(state_publisher, NULL,
+        priv_on_entry, server);
+    server->devices_listener = bluez_client_add_devices_listener(bluez_client,
+        priv_on_devices_changed, server);
+    server->pending_listener = agent_server_add_pending_listener(agent_server,
+        priv_on_pending_changed, server);
+
+    // Populate the initial values before anyone can read them
+    server->dirty = DIRTY_STATE | DIRTY_DEVICES | DIRTY_PENDING;
+    server->refresh_id = 0;
+    priv_refresh(server);
+    return server;
+}
+
+int control_server_export(ControlServer* server, GDBusConnection* connection,
+    const char* object_path, GError** error)
+{
+    server->exported = g_dbus_interface_skeleton_export(
+        G_DBUS_INTERFACE_SKELETON(server->interface), connection, object_path,
+        error);
+    return server->exported ? 0 : 1;
+}
+
+void control_server_free(ControlServer** server) {
+    if (NULL == *server) {
+        return;
+    }
+
+    if (0 != (*server)->refresh_id) {
+        g_source_remove((*server)->refresh_id);
+    }
+    agent_server_remove_pending_listener((*server)->agent_server,
+        (*server)->pending_listener);
+    bluez_client_remove_devices_listener((*server)->bluez_client,
+        (*server)->devices_listener);
+    state_remove_observer((*server)->state_publisher,
+        (*server)->state_observer);
+    state_deref(&(*server)->state_publisher);
+    if ((*server)->exported) {
+        g_dbus_interface_skeleton_unexport(
+            G_DBUS_INTERFACE_SKELETON((*server)->interface));
+    }
+    g_object_unref((*server)->interface);
+    free(*server);
+    *server = NULL;
+}
+
+///////////////////////////////////////////////////////////////////////////////
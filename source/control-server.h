@@ -0,0 +1,48 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            control-server.h
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     D-Bus interface exposing the agent's own state to local
+//                  services.
+//
+// CREATED:         10/18/2026
+//
+// LAST EDITED:     10/18/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+#ifndef CONTROL_SERVER_H
+#define CONTROL_SERVER_H
+
+typedef struct AgentServer AgentServer;
+typedef struct BluezClient BluezClient;
+typedef struct StatePublisher StatePublisher;
+typedef struct _GDBusConnection GDBusConnection;
+typedef struct _GError GError;
+
+typedef struct ControlServer ControlServer;
+
+ControlServer* control_server_init(StatePublisher* state_publisher,
+    BluezClient* bluez_client, AgentServer* agent_server);
+int control_server_export(ControlServer* server, GDBusConnection* connection,
+    const char* object_path, GError** error);
+void control_server_free(ControlServer** server);
+
+#endif // CONTROL_SERVER_H
+
+///////////////////////////////////////////////////////////////////////////////
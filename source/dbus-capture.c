@@ -0,0 +1,243 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            dbus-capture.c
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Record D-Bus traffic to a file, and read it back
+//
+// CREATED:         10/18/2026
+//
+// LAST EDITED:     10/18/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <gio/gio.h>
+
+#include <dbus-capture.h>
+
+// On-disk format, in host byte order: a header, then for each message a
+// record header followed by the message blob. Bump the version whenever the
+// layout changes.
+typedef struct CaptureHeader {
+    char magic[4];
+    uint16_t version;
+    uint16_t reserved;
+    int64_t started_at; // <- Wall clock, microseconds
+} CaptureHeader;
+
+typedef struct CaptureRecordHeader {
+    int64_t offset;
+    uint32_t length;
+    uint8_t outgoing;
+    uint8_t reserved[3];
+} CaptureRecordHeader;
+
+_Static_assert(16 == sizeof(CaptureHeader), "Capture header layout");
+_Static_assert(16 == sizeof(CaptureRecordHeader), "Capture record layout");
+
+static const char CAPTURE_MAGIC[4] = { 'B', 'I', 'A', 'D' };
+static const uint16_t CAPTURE_VERSION = 1;
+
+// The filter may still be running on the worker thread when the recorder is
+// freed, so the recorder itself is only released by the filter's destroy
+// notification.
+typedef struct DbusRecorder {
+    GDBusConnection* connection;
+    guint filter_id;
+    char* path;
+    GMutex lock;
+    FILE* file;
+    gint64 started_at;
+    GByteArray* buffer;
+} DbusRecorder;
+
+///////////////////////////////////////////////////////////////////////////////
+// Private API
+////
+
+static GDBusMessage* priv_filter(GDBusConnection* connection,
+    GDBusMessage* message, gboolean incoming, gpointer user_data)
+{
+    DbusRecorder* recorder = (DbusRecorder*)user_data;
+    const gint64 now = g_get_monotonic_time();
+    gsize length = 0;
+    guchar* blob = g_dbus_message_to_blob(message, &length,
+        G_DBUS_CAPABILITY_FLAGS_NONE, NULL);
+    if (NULL == blob) {
+        return message;
+    }
+
+    CaptureRecordHeader header = {
+        .offset = now - recorder->started_at,
+        .length = length,
+        .outgoing = !incoming,
+    };
+    g_mutex_lock(&recorder->lock);
+    if (NULL != recorder->file) {
+        // One write per record, so that a crash loses at most one
+        g_byte_array_set_size(recorder->buffer, 0);
+        g_byte_array_append(recorder->buffer, (const guint8*)&header,
+            sizeof(header));
+        g_byte_array_append(recorder->buffer, blob, length);
+        if (1 != fwrite(recorder->buffer->data, recorder->buffer->len, 1,
+                recorder->file) || 0 != fflush(recorder->file)) {
+            g_warning("DbusRecorder: Stopped recording to %s: %s",
+                recorder->path, strerror(errno));
+            fclose(recorder->file);
+            recorder->file = NULL;
+        }
+    }
+    g_mutex_unlock(&recorder->lock);
+    g_free(blob);
+    return message;
+}
+
+static void priv_recorder_free(gpointer user_data) {
+    DbusRecorder* recorder = (DbusRecorder*)user_data;
+    if (NULL != recorder->file) {
+        fclose(recorder->file);
+    }
+    g_info("DbusRecorder: Closed %s", recorder->path);
+    g_byte_array_unref(recorder->buffer);
+    g_mutex_clear(&recorder->lock);
+    g_object_unref(recorder->connection);
+    g_free(recorder->path);
+    free(recorder);
+}
+
+static void priv_record_free(gpointer data) {
+    DbusCaptureRecord* record = (DbusCaptureRecord*)data;
+    g_object_unref(record->message);
+    g_free(record);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Public API
+////
+
+DbusRecorder* dbus_recorder_init(GDBusConnection* connection,
+    const char* path)
+{
+    FILE* file = fopen(path, "wb");
+    if (NULL == file) {
+        g_warning("DbusRecorder: Couldn't create %s: %s", path,
+            strerror(errno));
+        return NULL;
+    }
+
+    CaptureHeader header = {
+        .version = CAPTURE_VERSION,
+        .started_at = g_get_real_time(),
+    };
+    memcpy(header.magic, CAPTURE_MAGIC, sizeof(header.magic));
+    if (1 != fwrite(&header, sizeof(header), 1, file)) {
+        g_warning("DbusRecorder: Couldn't write %s: %s", path,
+            strerror(errno));
+        fclose(file);
+        return NULL;
+    }
+
+    DbusRecorder* recorder = malloc(sizeof(DbusRecorder));
+    if (NULL == recorder) {
+        fclose(file);
+        return NULL;
+    }
+
+    recorder->connection = g_object_ref(connection);
+    recorder->path = g_strdup(path);
+    g_mutex_init(&recorder->lock);
+    recorder->file = file;
+    recorder->started_at = g_get_monotonic_time();
+    recorder->buffer = g_byte_array_new();
+    recorder->filter_id = g_dbus_connection_add_filter(connection,
+        priv_filter, recorder, priv_recorder_free);
+    g_info("DbusRecorder: Recording D-Bus traffic to %s", path);
+    return recorder;
+}
+
+void dbus_recorder_free(DbusRecorder** recorder) {
+    if (NULL == *recorder) {
+        return;
+    }
+
+    g_dbus_connection_remove_filter((*recorder)->connection,
+        (*recorder)->filter_id);
+    *recorder = NULL;
+}
+
+GPtrArray* dbus_capture_load(const char* path) {
+    GError* error = NULL;
+    GMappedFile* file = g_mapped_file_new(path, FALSE, &error);
+    if (NULL != error) {
+        g_warning("DbusCapture: Couldn't load %s: %s", path, error->message);
+        g_error_free(error);
+        return NULL;
+    }
+
+    const uint8_t* data = (const uint8_t*)g_mapped_file_get_contents(file);
+    const size_t length = g_mapped_file_get_length(file);
+    CaptureHeader header = {0};
+    if (sizeof(header) <= length) {
+        memcpy(&header, data, sizeof(header));
+    }
+    if (memcmp(header.magic, CAPTURE_MAGIC, sizeof(header.magic))
+        || CAPTURE_VERSION != header.version) {
+        g_warning("DbusCapture: %s isn't a capture", path);
+        g_mapped_file_unref(file);
+        return NULL;
+    }
+
+    GPtrArray* records = g_ptr_array_new_with_free_func(priv_record_free);
+    size_t position = sizeof(header);
+    while (position + sizeof(CaptureRecordHeader) <= length) {
+        CaptureRecordHeader record_header;
+        memcpy(&record_header, data + position, sizeof(record_header));
+        position += sizeof(record_header);
+        if (record_header.length > length - position) {
+            break;
+        }
+
+        GDBusMessage* message = g_dbus_message_new_from_blob(
+            (guchar*)data + position, record_header.length,
+            G_DBUS_CAPABILITY_FLAGS_NONE, &error);
+        position += record_header.length;
+        if (NULL == message) {
+            g_warning("DbusCapture: Skipping a message: %s", error->message);
+            g_clear_error(&error);
+            continue;
+        }
+
+        DbusCaptureRecord* record = g_new(DbusCaptureRecord, 1);
+        record->offset = record_header.offset;
+        record->outgoing = 0 != record_header.outgoing;
+        record->message = message;
+        g_ptr_array_add(records, record);
+    }
+
+    if (position != length) {
+        g_warning("DbusCapture: %s was cut short", path);
+    }
+    g_mapped_file_unref(file);
+    return records;
+}
+
+///////////////////////////////////////////////////////////////////////////////
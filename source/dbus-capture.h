@@ -0,0 +1,62 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            dbus-capture.h
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Record D-Bus traffic to a file, and read it back
+//
+// CREATED:         10/18/2026
+//
+// LAST EDITED:     10/18/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+#ifndef DBUS_CAPTURE_H
+#define DBUS_CAPTURE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct _GDBusConnection GDBusConnection;
+typedef struct _GDBusMessage GDBusMessage;
+typedef struct _GPtrArray GPtrArray;
+
+// A capture holds every message sent or received on a connection, in the
+// D-Bus wire format, along with when it was seen.
+typedef struct DbusCaptureRecord {
+    int64_t offset;  // <- Monotonic, microseconds since the capture began
+    bool outgoing;   // <- Sent on the connection, rather than received
+    GDBusMessage* message;
+} DbusCaptureRecord;
+
+// Records until freed. Messages are written as they pass through the
+// connection's worker thread, so a capture survives the agent crashing.
+typedef struct DbusRecorder DbusRecorder;
+
+// Returns NULL if the file can't be created
+DbusRecorder* dbus_recorder_init(GDBusConnection* connection,
+    const char* path);
+void dbus_recorder_free(DbusRecorder** recorder);
+
+// Returns an array of DbusCaptureRecord* in the order they were recorded, or
+// NULL if the file isn't a capture. A capture that was cut short is read up
+// to the last complete record.
+GPtrArray* dbus_capture_load(const char* path);
+
+#endif // DBUS_CAPTURE_H
+
+///////////////////////////////////////////////////////////////////////////////
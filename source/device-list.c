@@ -0,0 +1,461 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            device-list.c
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Paginated, sorted device list, streamed to the client
+//
+// CREATED:         10/18/2026
+//
+// LAST EDITED:     10/18/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libsoup/soup.h>
+
+#include <bluez.h>
+#include <bluez-client.h>
+#include <device-list.h>
+#include <memory-stats.h>
+#include <snapshot.h>
+
+enum DeviceSort {
+    DEVICE_SORT_NAME,
+    DEVICE_SORT_ADDRESS,
+    DEVICE_SORT_RSSI,
+    DEVICE_SORT_COUNT,
+};
+
+enum DeviceListFormat {
+    DEVICE_LIST_JSON,
+    DEVICE_LIST_HTML,
+};
+
+typedef struct DeviceList {
+    BluezClient* bluez_client;
+    unsigned int devices_listener;
+    // Addresses, in each order. NULL until needed after a change.
+    GPtrArray* orders[DEVICE_SORT_COUNT];
+    GPtrArray* streams;
+} DeviceList;
+
+// One response being written. It holds its own reference to the order it
+// started with, so a change to the device table doesn't disturb it; devices
+// removed since are skipped.
+typedef struct DeviceStream {
+    DeviceList* list;
+    SoupServerMessage* message;
+    enum DeviceListFormat format;
+    enum DeviceSort sort;
+    GPtrArray* order;
+    unsigned int page;
+    unsigned int per_page;
+    guint position;
+    guint end;
+    bool empty;
+    bool complete;
+    GString* chunk;
+} DeviceStream;
+
+static const unsigned int DEFAULT_PER_PAGE = 50;
+static const unsigned int MAXIMUM_PER_PAGE = 200;
+static const guint DEVICES_PER_CHUNK = 16;
+
+///////////////////////////////////////////////////////////////////////////////
+// Private API
+////
+
+static int priv_compare_address(gconstpointer first, gconstpointer second)
+{
+    return g_strcmp0(device1_get_address(*(Device1* const*)first),
+        device1_get_address(*(Device1* const*)second));
+}
+
+static int priv_compare_name(gconstpointer first, gconstpointer second) {
+    const char* first_name = device1_get_alias(*(Device1* const*)first);
+    const char* second_name = device1_get_alias(*(Device1* const*)second);
+    const int result = g_ascii_strcasecmp(
+        NULL != first_name ? first_name : "",
+        NULL != second_name ? second_name : "");
+    return 0 != result ? result : priv_compare_address(first, second);
+}
+
+// Strongest first. bluetoothd reports 0 when it hasn't seen the device.
+static int priv_compare_rssi(gconstpointer first, gconstpointer second) {
+    int first_rssi = device1_get_rssi(*(Device1* const*)first);
+    int second_rssi = device1_get_rssi(*(Device1* const*)second);
+    first_rssi = 0 != first_rssi ? first_rssi : G_MININT16;
+    second_rssi = 0 != second_rssi ? second_rssi : G_MININT16;
+    return first_rssi != second_rssi ? second_rssi - first_rssi
+        : priv_compare_address(first, second);
+}
+
+static const struct {
+    const char* name;
+    GCompareFunc compare;
+} SORTS[DEVICE_SORT_COUNT] = {
+    [DEVICE_SORT_NAME] = { "name", priv_compare_name },
+    [DEVICE_SORT_ADDRESS] = { "address", priv_compare_address },
+    [DEVICE_SORT_RSSI] = { "rssi", priv_compare_rssi },
+};
+
+static void priv_address_free(gpointer data) {
+    memory_stats_released(MEMORY_DOMAIN_WEB,
+        sizeof(gpointer) + strlen((char*)data) + 1);
+    g_free(data);
+}
+
+static void priv_collect_device(Device1* device, void* user_data)
+{ g_ptr_array_add((GPtrArray*)user_data, device); }
+
+static GPtrArray* priv_get_order(DeviceList* list, enum DeviceSort sort) {
+    if (NULL != list->orders[sort]) {
+        return list->orders[sort];
+    }
+
+    const guint num_devices = bluez_client_get_num_devices(
+        list->bluez_client);
+    GPtrArray* devices = g_ptr_array_sized_new(num_devices);
+    bluez_client_foreach_device(list->bluez_client, priv_collect_device,
+        devices);
+    g_ptr_array_sort(devices, SORTS[sort].compare);
+
+    GPtrArray* order = g_ptr_array_new_full(devices->len, priv_address_free);
+    for (guint i = 0; i < devices->len; ++i) {
+        const char* address = device1_get_address(
+            g_ptr_array_index(devices, i));
+        if (NULL != address) {
+            memory_stats_allocated(MEMORY_DOMAIN_WEB,
+                sizeof(gpointer) + strlen(address) + 1);
+            g_ptr_array_add(order, g_strdup(address));
+        }
+    }
+    g_ptr_array_unref(devices);
+    list->orders[sort] = order;
+    return order;
+}
+
+static void priv_on_devices_changed(void* user_data) {
+    DeviceList* list = (DeviceList*)user_data;
+    for (int i = 0; i < DEVICE_SORT_COUNT; ++i) {
+        g_clear_pointer(&list->orders[i], g_ptr_array_unref);
+    }
+}
+
+static int priv_parse_uint(const char* value, unsigned int minimum,
+    unsigned int maximum, unsigned int* result)
+{
+    char* end = NULL;
+    errno = 0;
+    const unsigned long parsed = strtoul(value, &end, 10);
+    if ('\0' == *value || '\0' != *end || 0 != errno || minimum > parsed
+        || maximum < parsed) {
+        return 1;
+    }
+    *result = parsed;
+    return 0;
+}
+
+static int priv_parse_query(DeviceStream* stream, GHashTable* query) {
+    stream->page = 1;
+    stream->per_page = DEFAULT_PER_PAGE;
+    stream->sort = DEVICE_SORT_NAME;
+    if (NULL == query) {
+        return 0;
+    }
+
+    const char* value = g_hash_table_lookup(query, "page");
+    if (NULL != value && 0 != priv_parse_uint(value, 1, G_MAXINT,
+            &stream->page)) {
+        return 1;
+    }
+    value = g_hash_table_lookup(query, "per_page");
+    if (NULL != value && 0 != priv_parse_uint(value, 1, MAXIMUM_PER_PAGE,
+            &stream->per_page)) {
+        return 1;
+    }
+    value = g_hash_table_lookup(query, "sort");
+    if (NULL == value) {
+        return 0;
+    }
+    for (int i = 0; i < DEVICE_SORT_COUNT; ++i) {
+        if (!strcmp(value, SORTS[i].name)) {
+            stream->sort = i;
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void priv_append_html(GString* buffer, const char* text) {
+    for (; NULL != text && '\0' != *text; ++text) {
+        switch (*text) {
+        case '<': g_string_append(buffer, "&lt;"); break;
+        case '>': g_string_append(buffer, "&gt;"); break;
+        case '&': g_string_append(buffer, "&amp;"); break;
+        case '"': g_string_append(buffer, "&quot;"); break;
+        case '\'': g_string_append(buffer, "&#39;"); break;
+        default: g_string_append_c(buffer, *text); break;
+        }
+    }
+}
+
+static void priv_append_html_row(GString* buffer, Device1* device) {
+    g_string_append(buffer, "<tr><td>");
+    priv_append_html(buffer, device1_get_alias(device));
+    g_string_append(buffer, "</td><td>");
+    priv_append_html(buffer, device1_get_address(device));
+    g_string_append(buffer, "</td><td>");
+    const struct { bool set; const char* name; } flags[] = {
+        { device1_get_paired(device), "paired" },
+        { device1_get_trusted(device), "trusted" },
+        { device1_get_blocked(device), "blocked" },
+        { device1_get_connected(device), "connected" },
+    };
+    const char* separator = "";
+    for (size_t i = 0; i < G_N_ELEMENTS(flags); ++i) {
+        if (flags[i].set) {
+            g_string_append_printf(buffer, "%s%s", separator, flags[i].name);
+            separator = ", ";
+        }
+    }
+    g_string_append_printf(buffer, "</td><td>%d</td></tr>\n",
+        (int)device1_get_rssi(device));
+}
+
+static void priv_append_header(DeviceStream* stream, const char* stylesheet,
+    size_t stylesheet_length)
+{
+    GString* chunk = stream->chunk;
+    if (DEVICE_LIST_JSON == stream->format) {
+        g_string_append_printf(chunk, "{\"total\":%u,\"page\":%u"
+            ",\"per_page\":%u,\"sort\":\"%s\",\"devices\":[",
+            stream->order->len, stream->page, stream->per_page,
+            SORTS[stream->sort].name);
+        return;
+    }
+
+    g_string_append(chunk, "<!doctype html>\n<html lang=\"en\">\n<head>\n"
+        "<meta charset=\"utf-8\" />\n<meta name=\"viewport\" "
+        "content=\"width=device-width, initial-scale=1\" />\n"
+        "<title>Devices - BlueZ IoT Agent</title>\n"
+        "<style type=\"text/css\">\n");
+    if (NULL != stylesheet) {
+        g_string_append_len(chunk, stylesheet, stylesheet_length);
+    }
+    g_string_append(chunk, "</style>\n</head>\n<body>\n<h1>Devices</h1>\n"
+        "<p>Sort by");
+    for (int i = 0; i < DEVICE_SORT_COUNT; ++i) {
+        g_string_append_printf(chunk, " <a href=\"?sort=%s&amp;per_page=%u\">"
+            "%s</a>", SORTS[i].name, stream->per_page, SORTS[i].name);
+    }
+    g_string_append(chunk, "</p>\n<table>\n<tr><th>Name</th><th>Address</th>"
+        "<th>Status</th><th>RSSI</th></tr>\n");
+}
+
+static void priv_append_footer(DeviceStream* stream) {
+    GString* chunk = stream->chunk;
+    if (DEVICE_LIST_JSON == stream->format) {
+        g_string_append(chunk, "]}");
+        return;
+    }
+
+    const unsigned int num_pages = MAX(1, (stream->order->len
+            + stream->per_page - 1) / stream->per_page);
+    g_string_append(chunk, "</table>\n<p>");
+    if (1 < stream->page) {
+        g_string_append_printf(chunk, "<a href=\"?page=%u&amp;per_page=%u"
+            "&amp;sort=%s\">Previous</a> ", MIN(stream->page, num_pages + 1)
+            - 1, stream->per_page, SORTS[stream->sort].name);
+    }
+    g_string_append_printf(chunk, "Page %u of %u", stream->page, num_pages);
+    if (stream->page < num_pages) {
+        g_string_append_printf(chunk, " <a href=\"?page=%u&amp;per_page=%u"
+            "&amp;sort=%s\">Next</a>", stream->page + 1, stream->per_page,
+            SORTS[stream->sort].name);
+    }
+    g_string_append(chunk, "</p>\n<p><a href=\"/\">Back</a></p>\n"
+        "</body>\n</html>\n");
+}
+
+// An empty chunk would end the response, so devices are added until there's
+// something to send.
+static void priv_write_chunk(DeviceStream* stream) {
+    guint written = 0;
+    while (stream->position < stream->end && written < DEVICES_PER_CHUNK) {
+        Device1* device = bluez_client_get_device(stream->list->bluez_client,
+            g_ptr_array_index(stream->order, stream->position++));
+        if (NULL == device) {
+            continue;
+        }
+
+        if (DEVICE_LIST_JSON == stream->format) {
+            if (!stream->empty) {
+                g_string_append_c(stream->chunk, ',');
+            }
+            device_list_append_json(stream->chunk, device);
+        } else {
+            priv_append_html_row(stream->chunk, device);
+        }
+        stream->empty = false;
+        ++written;
+    }
+
+    const bool complete = stream->position >= stream->end;
+    if (complete) {
+        priv_append_footer(stream);
+    }
+
+    SoupMessageBody* body = soup_server_message_get_response_body(
+        stream->message);
+    soup_message_body_append(body, SOUP_MEMORY_COPY, stream->chunk->str,
+        stream->chunk->len);
+    g_string_truncate(stream->chunk, 0);
+    if (complete) {
+        soup_message_body_complete(body);
+        stream->complete = true;
+    }
+}
+
+static void priv_on_wrote_chunk(SoupServerMessage* message,
+    gpointer user_data)
+{
+    DeviceStream* stream = (DeviceStream*)user_data;
+    if (!stream->complete) {
+        priv_write_chunk(stream);
+    }
+}
+
+static void priv_on_finished(SoupServerMessage* message, gpointer user_data)
+{
+    DeviceStream* stream = (DeviceStream*)user_data;
+    g_ptr_array_remove_fast(stream->list->streams, stream);
+}
+
+static void priv_stream_free(gpointer data) {
+    DeviceStream* stream = (DeviceStream*)data;
+    g_signal_handlers_disconnect_by_data(stream->message, stream);
+    g_object_unref(stream->message);
+    g_ptr_array_unref(stream->order);
+    g_string_free(stream->chunk, TRUE);
+    g_free(stream);
+}
+
+static void priv_stream(DeviceList* list, SoupServerMessage* message,
+    GHashTable* query, enum DeviceListFormat format, const char* stylesheet,
+    size_t stylesheet_length)
+{
+    DeviceStream* stream = g_new0(DeviceStream, 1);
+    if (0 != priv_parse_query(stream, query)) {
+        g_free(stream);
+        soup_server_message_set_status(message, SOUP_STATUS_BAD_REQUEST,
+            NULL);
+        return;
+    }
+
+    stream->list = list;
+    stream->message = g_object_ref(message);
+    stream->format = format;
+    stream->order = g_ptr_array_ref(priv_get_order(list, stream->sort));
+    const guint64 start = (guint64)(stream->page - 1) * stream->per_page;
+    stream->position = MIN(start, stream->order->len);
+    stream->end = MIN(stream->position + stream->per_page,
+        stream->order->len);
+    stream->empty = true;
+    stream->chunk = g_string_sized_new(2048);
+
+    SoupMessageHeaders* headers = soup_server_message_get_response_headers(
+        message);
+    soup_message_headers_set_content_type(headers,
+        DEVICE_LIST_JSON == format ? "application/json" : "text/html", NULL);
+    soup_message_headers_replace(headers, "Cache-Control", "no-cache");
+    soup_message_headers_set_encoding(headers, SOUP_ENCODING_CHUNKED);
+    soup_message_body_set_accumulate(
+        soup_server_message_get_response_body(message), FALSE);
+
+    g_signal_connect(message, "wrote-chunk",
+        G_CALLBACK(priv_on_wrote_chunk), stream);
+    g_signal_connect(message, "finished", G_CALLBACK(priv_on_finished),
+        stream);
+    g_ptr_array_add(list->streams, stream);
+
+    priv_append_header(stream, stylesheet, stylesheet_length);
+    priv_write_chunk(stream);
+    soup_server_message_set_status(message, SOUP_STATUS_OK, NULL);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Public API
+////
+
+DeviceList* device_list_init(BluezClient* bluez_client) {
+    DeviceList* list = calloc(1, sizeof(DeviceList));
+    if (NULL == list) {
+        return NULL;
+    }
+
+    list->bluez_client = bluez_client;
+    list->streams = g_ptr_array_new_with_free_func(priv_stream_free);
+    list->devices_listener = bluez_client_add_devices_listener(bluez_client,
+        priv_on_devices_changed, list);
+    return list;
+}
+
+void device_list_free(DeviceList** list) {
+    if (NULL == *list) {
+        return;
+    }
+
+    bluez_client_remove_devices_listener((*list)->bluez_client,
+        (*list)->devices_listener);
+    priv_on_devices_changed(*list);
+    g_ptr_array_unref((*list)->streams);
+    free(*list);
+    *list = NULL;
+}
+
+void device_list_append_json(GString* buffer, Device1* device) {
+    g_string_append(buffer, "{\"address\":");
+    snapshot_append_json_string(buffer, device1_get_address(device));
+    g_string_append(buffer, ",\"name\":");
+    snapshot_append_json_string(buffer, device1_get_alias(device));
+    g_string_append_printf(buffer, ",\"paired\":%s,\"trusted\":%s"
+        ",\"blocked\":%s,\"connected\":%s,\"rssi\":%d}",
+        device1_get_paired(device) ? "true" : "false",
+        device1_get_trusted(device) ? "true" : "false",
+        device1_get_blocked(device) ? "true" : "false",
+        device1_get_connected(device) ? "true" : "false",
+        (int)device1_get_rssi(device));
+}
+
+void device_list_stream_json(DeviceList* list, SoupServerMessage* message,
+    GHashTable* query)
+{ priv_stream(list, message, query, DEVICE_LIST_JSON, NULL, 0); }
+
+void device_list_stream_html(DeviceList* list, SoupServerMessage* message,
+    GHashTable* query, const char* stylesheet, size_t stylesheet_length)
+{
+    priv_stream(list, message, query, DEVICE_LIST_HTML, stylesheet,
+        stylesheet_length);
+}
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,67 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            device-list.h
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Paginated, sorted device list, streamed to the client
+//
+// CREATED:         10/18/2026
+//
+// LAST EDITED:     10/18/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+#ifndef DEVICE_LIST_H
+#define DEVICE_LIST_H
+
+#include <stddef.h>
+
+typedef struct BluezClient BluezClient;
+typedef struct _Device1 Device1;
+typedef struct _GString GString;
+typedef struct _GHashTable GHashTable;
+typedef struct _SoupServerMessage SoupServerMessage;
+
+// Keeps the devices sorted by name, address and signal strength. Each order
+// is built on first use after the device table changes, and shared by every
+// response that is streaming it. Responses are written a few devices at a
+// time with chunked encoding, and chunks are released once written, so the
+// memory a response needs doesn't grow with the number of devices.
+//
+// Query parameters:
+//   page=1           1-based
+//   per_page=50      At most 200
+//   sort=name        name, address or rssi (strongest first)
+typedef struct DeviceList DeviceList;
+
+DeviceList* device_list_init(BluezClient* bluez_client);
+void device_list_free(DeviceList** list);
+
+// Appends the JSON representation of one device
+void device_list_append_json(GString* buffer, Device1* device);
+
+// Streams {"total":..,"page":..,"per_page":..,"sort":..,"devices":[..]}.
+// Sets the status on the message, 400 for an invalid query.
+void device_list_stream_json(DeviceList* list, SoupServerMessage* message,
+    GHashTable* query);
+// Streams an HTML page with the stylesheet inlined, like the index page
+void device_list_stream_html(DeviceList* list, SoupServerMessage* message,
+    GHashTable* query, const char* stylesheet, size_t stylesheet_length);
+
+#endif // DEVICE_LIST_H
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,504 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            handoff.c
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Hand the running agent over to a new process
+//
+// CREATED:         10/18/2026
+//
+// LAST EDITED:     10/18/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <gio/gio.h>
+#include <gio/gunixconnection.h>
+#include <gio/gunixsocketaddress.h>
+
+#include <activation.h>
+#include <agent-server.h>
+#include <handoff.h>
+#include <web-listener.h>
+
+// Sent by the old agent, followed by one fd per bit set in sockets, in bit
+// order. The successor answers with HANDOFF_READY once it has taken over.
+typedef struct HandoffHeader {
+    char magic[4];
+    uint16_t version;
+    uint8_t state;
+    uint8_t sockets;
+} HandoffHeader;
+
+_Static_assert(8 == sizeof(HandoffHeader), "Handoff header layout");
+
+enum {
+    HANDOFF_SOCKET_WEB,
+    HANDOFF_SOCKET_CONTROL,
+    HANDOFF_SOCKET_COUNT,
+};
+
+typedef struct HandoffServer {
+    char* path;
+    StatePublisher* state_publisher;
+    AgentServer* agent_server;
+    WebListener* listeners[HANDOFF_SOCKET_COUNT];
+    GSocketService* service;
+    void (*completed)(void* user_data);
+    void* user_data;
+
+    // The successor, until it's ready or gives up
+    GSocketConnection* connection;
+    GCancellable* cancellable;
+    guint timeout_id;
+    gint64 started_at;
+    char reply;
+    bool connected; // <- A successor connected at some point
+    bool complete;
+
+    // A successor kept waiting until our held agent requests are answered
+    GSocketConnection* postponed;
+    unsigned int pending_listener;
+    guint postpone_timeout_id;
+    guint resume_id;
+} HandoffServer;
+
+typedef struct HandoffClient {
+    GSocketConnection* connection;
+    gint64 started_at;
+} HandoffClient;
+
+static const char HANDOFF_MAGIC[4] = { 'B', 'I', 'A', 'H' };
+static const uint16_t HANDOFF_VERSION = 1;
+static const char HANDOFF_READY = 'R';
+
+// The successor talks to bluetoothd and the bus before it's ready
+static const guint HANDOFF_TIMEOUT_SECONDS = 30;
+
+///////////////////////////////////////////////////////////////////////////////
+// Private API
+////
+
+static bool priv_is_authorized_peer(GSocketConnection* connection) {
+    GCredentials* credentials = g_socket_get_credentials(
+        g_socket_connection_get_socket(connection), NULL);
+    if (NULL == credentials) {
+        return false;
+    }
+
+    uid_t uid = g_credentials_get_unix_user(credentials, NULL);
+    g_object_unref(credentials);
+    return 0 == uid || geteuid() == uid;
+}
+
+static void priv_reset(HandoffServer* server) {
+    if (0 != server->timeout_id) {
+        g_source_remove(server->timeout_id);
+        server->timeout_id = 0;
+    }
+    if (NULL != server->cancellable) {
+        g_cancellable_cancel(server->cancellable);
+        g_clear_object(&server->cancellable);
+    }
+    if (NULL != server->connection) {
+        g_io_stream_close(G_IO_STREAM(server->connection), NULL, NULL);
+        g_clear_object(&server->connection);
+    }
+}
+
+static gboolean priv_on_timeout(gpointer user_data) {
+    HandoffServer* server = (HandoffServer*)user_data;
+    server->timeout_id = 0;
+    g_warning("Handoff: Successor wasn't ready after %u seconds, carrying on",
+        HANDOFF_TIMEOUT_SECONDS);
+    priv_reset(server);
+    return G_SOURCE_REMOVE;
+}
+
+static void priv_on_reply(GObject* source, GAsyncResult* result,
+    gpointer user_data)
+{
+    GError* error = NULL;
+    const gssize length = g_input_stream_read_finish(G_INPUT_STREAM(source),
+        result, &error);
+    if (g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+        // The server may already be gone
+        g_error_free(error);
+        return;
+    }
+
+    HandoffServer* server = (HandoffServer*)user_data;
+    if (1 != length || HANDOFF_READY != server->reply) {
+        g_warning("Handoff: Successor went away (%s), carrying on",
+            NULL != error ? error->message : "no reply");
+        g_clear_error(&error);
+        priv_reset(server);
+        return;
+    }
+
+    g_info("Handoff: Successor ready after %.1f ms",
+        (g_get_monotonic_time() - server->started_at) / 1000.0);
+    priv_reset(server);
+    server->complete = true;
+    if (NULL != server->completed) {
+        server->completed(server->user_data);
+    }
+}
+
+static int priv_send_sockets(HandoffServer* server,
+    GSocketConnection* connection)
+{
+    GSocket* sockets[HANDOFF_SOCKET_COUNT] = {0};
+    HandoffHeader header = {
+        .version = HANDOFF_VERSION,
+        .state = state_get(server->state_publisher),
+    };
+    memcpy(header.magic, HANDOFF_MAGIC, sizeof(header.magic));
+    for (int i = 0; i < HANDOFF_SOCKET_COUNT; ++i) {
+        sockets[i] = web_listener_get_socket(server->listeners[i]);
+        if (NULL != sockets[i]) {
+            header.sockets |= 1u << i;
+        }
+    }
+
+    // Both messages are tiny, so these don't block the main loop for long
+    GError* error = NULL;
+    GOutputStream* output = g_io_stream_get_output_stream(
+        G_IO_STREAM(connection));
+    if (!g_output_stream_write_all(output, &header, sizeof(header), NULL,
+            NULL, &error)) {
+        goto error;
+    }
+    for (int i = 0; i < HANDOFF_SOCKET_COUNT; ++i) {
+        if (NULL != sockets[i] && !g_unix_connection_send_fd(
+                G_UNIX_CONNECTION(connection), g_socket_get_fd(sockets[i]),
+                NULL, &error)) {
+            goto error;
+        }
+    }
+    return 0;
+
+ error:
+    g_warning("Handoff: Couldn't pass sockets to successor: %s",
+        error->message);
+    g_error_free(error);
+    return 1;
+}
+
+static int priv_start(HandoffServer* server, GSocketConnection* connection)
+{
+    if (0 != priv_send_sockets(server, connection)) {
+        return 1;
+    }
+
+    g_info("Handoff: Successor connected, waiting for it to take over");
+    server->connected = true;
+    server->started_at = g_get_monotonic_time();
+    server->connection = g_object_ref(connection);
+    server->cancellable = g_cancellable_new();
+    g_input_stream_read_async(
+        g_io_stream_get_input_stream(G_IO_STREAM(connection)),
+        &server->reply, 1, G_PRIORITY_DEFAULT, server->cancellable,
+        priv_on_reply, server);
+    server->timeout_id = g_timeout_add_seconds(HANDOFF_TIMEOUT_SECONDS,
+        priv_on_timeout, server);
+    return 0;
+}
+
+// Returns the postponed successor, or NULL if there isn't one
+static GSocketConnection* priv_end_postponement(HandoffServer* server) {
+    if (0 != server->pending_listener) {
+        agent_server_remove_pending_listener(server->agent_server,
+            server->pending_listener);
+        server->pending_listener = 0;
+    }
+    if (0 != server->postpone_timeout_id) {
+        g_source_remove(server->postpone_timeout_id);
+        server->postpone_timeout_id = 0;
+    }
+    if (0 != server->resume_id) {
+        g_source_remove(server->resume_id);
+        server->resume_id = 0;
+    }
+
+    GSocketConnection* connection = server->postponed;
+    server->postponed = NULL;
+    return connection;
+}
+
+static void priv_close(GSocketConnection* connection) {
+    g_io_stream_close(G_IO_STREAM(connection), NULL, NULL);
+    g_object_unref(connection);
+}
+
+// Only bluetoothd's connection to us can answer the requests we hold, so
+// they'd be canceled if we left now.
+static gboolean priv_on_resume(gpointer user_data) {
+    HandoffServer* server = (HandoffServer*)user_data;
+    server->resume_id = 0;
+    if (0 != server->agent_server->pending_requests->len) {
+        return G_SOURCE_REMOVE;
+    }
+
+    g_info("Handoff: No more held requests, handing over");
+    GSocketConnection* connection = priv_end_postponement(server);
+    if (0 != priv_start(server, connection)) {
+        g_io_stream_close(G_IO_STREAM(connection), NULL, NULL);
+    }
+    g_object_unref(connection);
+    return G_SOURCE_REMOVE;
+}
+
+// Listeners mustn't be removed while the agent server is notifying them
+static void priv_on_pending_changed(void* user_data) {
+    HandoffServer* server = (HandoffServer*)user_data;
+    if (0 == server->agent_server->pending_requests->len
+        && 0 == server->resume_id) {
+        server->resume_id = g_idle_add(priv_on_resume, server);
+    }
+}
+
+static gboolean priv_on_postpone_timeout(gpointer user_data) {
+    HandoffServer* server = (HandoffServer*)user_data;
+    server->postpone_timeout_id = 0;
+    g_warning("Handoff: Still holding %u requests after %u seconds, turning"
+        " the successor away", server->agent_server->pending_requests->len,
+        HANDOFF_TIMEOUT_SECONDS);
+    priv_close(priv_end_postponement(server));
+    return G_SOURCE_REMOVE;
+}
+
+static gboolean priv_on_incoming(GSocketService* service,
+    GSocketConnection* connection, GObject* source_object,
+    gpointer user_data)
+{
+    HandoffServer* server = (HandoffServer*)user_data;
+    if (NULL != server->connection || NULL != server->postponed
+        || server->complete) {
+        g_warning("Handoff: Refusing a second successor");
+        return FALSE;
+    } else if (!priv_is_authorized_peer(connection)) {
+        g_warning("Handoff: Refusing successor owned by another user");
+        return FALSE;
+    }
+
+    const unsigned int held = server->agent_server->pending_requests->len;
+    if (0 == held) {
+        return 0 == priv_start(server, connection);
+    }
+
+    // The successor blocks reading the greeting until we resume
+    g_info("Handoff: Successor waits for %u held requests", held);
+    server->postponed = g_object_ref(connection);
+    server->pending_listener = agent_server_add_pending_listener(
+        server->agent_server, priv_on_pending_changed, server);
+    server->postpone_timeout_id = g_timeout_add_seconds(
+        HANDOFF_TIMEOUT_SECONDS, priv_on_postpone_timeout, server);
+    return TRUE;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Public API
+////
+
+HandoffServer* handoff_server_init(const char* path,
+    StatePublisher* state_publisher, AgentServer* agent_server,
+    WebListener* lan_listener, WebListener* local_listener)
+{
+    HandoffServer* server = calloc(1, sizeof(HandoffServer));
+    if (NULL == server) {
+        return NULL;
+    }
+
+    // A stale socket from a previous run would make bind() fail
+    unlink(path);
+    GError* error = NULL;
+    GSocketAddress* address = g_unix_socket_address_new(path);
+    server->service = g_socket_service_new();
+    g_socket_listener_add_address(G_SOCKET_LISTENER(server->service),
+        address, G_SOCKET_TYPE_STREAM, G_SOCKET_PROTOCOL_DEFAULT, NULL, NULL,
+        &error);
+    g_object_unref(address);
+    if (NULL != error) {
+        g_warning("Handoff: Couldn't listen at %s: %s", path, error->message);
+        g_error_free(error);
+        g_object_unref(server->service);
+        free(server);
+        return NULL;
+    }
+
+    chmod(path, S_IRUSR | S_IWUSR);
+    server->path = g_strdup(path);
+    state_ref(state_publisher);
+    server->state_publisher = state_publisher;
+    server->agent_server = agent_server;
+    server->listeners[HANDOFF_SOCKET_WEB] = lan_listener;
+    server->listeners[HANDOFF_SOCKET_CONTROL] = local_listener;
+    g_signal_connect(server->service, "incoming",
+        G_CALLBACK(priv_on_incoming), server);
+    g_socket_service_start(server->service);
+    return server;
+}
+
+void handoff_server_set_callback(HandoffServer* server,
+    void (*completed)(void* user_data), void* user_data)
+{
+    server->completed = completed;
+    server->user_data = user_data;
+}
+
+bool handoff_server_in_progress(HandoffServer* server)
+{ return NULL != server->connection || server->complete; }
+
+void handoff_server_free(HandoffServer** server) {
+    if (NULL == *server) {
+        return;
+    }
+
+    priv_reset(*server);
+    GSocketConnection* postponed = priv_end_postponement(*server);
+    if (NULL != postponed) {
+        priv_close(postponed);
+    }
+    g_signal_handlers_disconnect_by_data((*server)->service, *server);
+    g_socket_service_stop((*server)->service);
+    g_socket_listener_close(G_SOCKET_LISTENER((*server)->service));
+    g_object_unref((*server)->service);
+    // A successor may have bound its own socket here already
+    if (!(*server)->connected) {
+        unlink((*server)->path);
+    }
+    g_free((*server)->path);
+    state_deref(&(*server)->state_publisher);
+    free(*server);
+    *server = NULL;
+}
+
+HandoffClient* handoff_client_init(const char* path,
+    ActivationSockets* sockets, enum State* state)
+{
+    sockets->web = NULL;
+    sockets->control = NULL;
+
+    const gint64 started_at = g_get_monotonic_time();
+    GError* error = NULL;
+    GSocketClient* socket_client = g_socket_client_new();
+    GSocketAddress* address = g_unix_socket_address_new(path);
+    GSocketConnection* connection = g_socket_client_connect(socket_client,
+        G_SOCKET_CONNECTABLE(address), NULL, &error);
+    g_object_unref(address);
+    g_object_unref(socket_client);
+    if (NULL == connection) {
+        g_warning("Handoff: Couldn't connect to %s: %s", path,
+            error->message);
+        g_error_free(error);
+        return NULL;
+    }
+
+    HandoffHeader header = {0};
+    gsize length = 0;
+    if (!g_input_stream_read_all(
+            g_io_stream_get_input_stream(G_IO_STREAM(connection)), &header,
+            sizeof(header), &length, NULL, &error)) {
+        goto error;
+    } else if (sizeof(header) != length
+        || memcmp(header.magic, HANDOFF_MAGIC, sizeof(header.magic))
+        || HANDOFF_VERSION != header.version
+        || STATE_CONNECTION_WAIT > header.state
+        || STATE_PAIRABLE < header.state) {
+        g_warning("Handoff: Unexpected greeting from %s", path);
+        goto fail;
+    }
+
+    GSocket** slots[HANDOFF_SOCKET_COUNT] = {
+        [HANDOFF_SOCKET_WEB] = &sockets->web,
+        [HANDOFF_SOCKET_CONTROL] = &sockets->control,
+    };
+    for (int i = 0; i < HANDOFF_SOCKET_COUNT; ++i) {
+        if (0 == (header.sockets & (1u << i))) {
+            continue;
+        }
+
+        const int fd = g_unix_connection_receive_fd(
+            G_UNIX_CONNECTION(connection), NULL, &error);
+        if (-1 == fd) {
+            goto error;
+        }
+        *slots[i] = g_socket_new_from_fd(fd, &error);
+        if (NULL == *slots[i]) {
+            close(fd);
+            goto error;
+        }
+    }
+
+    HandoffClient* client = malloc(sizeof(HandoffClient));
+    if (NULL == client) {
+        goto fail;
+    }
+    client->connection = connection;
+    client->started_at = started_at;
+    *state = header.state;
+    g_info("Handoff: Taking over from the agent at %s in %s", path,
+        state_to_string(header.state));
+    return client;
+
+ error:
+    g_warning("Handoff: Couldn't take over from %s: %s", path,
+        error->message);
+    g_error_free(error);
+ fail:
+    activation_sockets_clear(sockets);
+    g_object_unref(connection);
+    return NULL;
+}
+
+void handoff_client_complete(HandoffClient** client) {
+    if (NULL == *client) {
+        return;
+    }
+
+    GError* error = NULL;
+    if (!g_output_stream_write_all(
+            g_io_stream_get_output_stream(G_IO_STREAM((*client)->connection)),
+            &HANDOFF_READY, 1, NULL, NULL, &error)) {
+        g_warning("Handoff: Couldn't tell the old agent to exit: %s",
+            error->message);
+        g_error_free(error);
+    } else {
+        g_info("Handoff: Took over in %.1f ms",
+            (g_get_monotonic_time() - (*client)->started_at) / 1000.0);
+    }
+    handoff_client_free(client);
+}
+
+void handoff_client_free(HandoffClient** client) {
+    if (NULL == *client) {
+        return;
+    }
+
+    g_io_stream_close(G_IO_STREAM((*client)->connection), NULL, NULL);
+    g_object_unref((*client)->connection);
+    free(*client);
+    *client = NULL;
+}
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,83 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            handoff.h
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Hand the running agent over to a new process
+//
+// CREATED:         10/18/2026
+//
+// LAST EDITED:     10/18/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+#ifndef HANDOFF_H
+#define HANDOFF_H
+
+#include <stdbool.h>
+
+#include <state.h>
+
+typedef struct ActivationSockets ActivationSockets;
+typedef struct AgentServer AgentServer;
+typedef struct WebListener WebListener;
+
+// Graceful upgrades. The running agent waits on a Unix socket for its
+// successor, and passes it the current state and the listening sockets
+// (SCM_RIGHTS), which both processes then accept on. The successor registers
+// as the default agent, takes over the bus name and says it's ready. Only
+// then does the old agent stop listening, drain its requests and exit, so
+// that there's always someone to answer bluetoothd and the web clients. Only
+// root or the agent's own user may take over.
+//
+// Agent requests we hold for pairing mode can only be answered by us, since
+// bluetoothd called us, and they'd be canceled on exit. So a successor that
+// connects while any are held waits, before it's sent anything, until
+// they've been answered or timed out, and is turned away if that takes
+// longer than the handoff timeout. A request bluetoothd sends us after the
+// sockets are passed, but before the successor is the default agent, is
+// still canceled.
+typedef struct HandoffServer HandoffServer;
+
+// Returns NULL if the socket can't be bound
+HandoffServer* handoff_server_init(const char* path,
+    StatePublisher* state_publisher, AgentServer* agent_server,
+    WebListener* lan_listener, WebListener* local_listener);
+// Invoked once the successor is ready
+void handoff_server_set_callback(HandoffServer* server,
+    void (*completed)(void* user_data), void* user_data);
+// True from the time a successor connects, unless it gives up. Losing the
+// bus name is expected then.
+bool handoff_server_in_progress(HandoffServer* server);
+// The socket path is left to a successor that connected
+void handoff_server_free(HandoffServer** server);
+
+typedef struct HandoffClient HandoffClient;
+
+// Connects to the agent listening at path, filling sockets with the sockets
+// it passes and state with its current state. Returns NULL if there's no
+// agent to take over from.
+HandoffClient* handoff_client_init(const char* path,
+    ActivationSockets* sockets, enum State* state);
+// Tells the old agent to exit. Call once the bus name is ours.
+void handoff_client_complete(HandoffClient** client);
+// Without completing, the old agent carries on as if nothing happened
+void handoff_client_free(HandoffClient** client);
+
+#endif // HANDOFF_H
+
+///////////////////////////////////////////////////////////////////////////////
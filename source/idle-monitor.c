@@ -0,0 +1,165 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            idle-monitor.c
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Implementation of the idle monitor
+//
+// CREATED:         10/18/2026
+//
+// LAST EDITED:     10/18/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include <glib.h>
+
+#include <agent-server.h>
+#include <bluez-client.h>
+#include <bluez.h>
+#include <idle-monitor.h>
+#include <state.h>
+
+typedef struct IdleMonitor {
+    StatePublisher* state_publisher;
+    AgentServer* agent_server;
+    BluezClient* bluez_client;
+    StateObserverHandle state_observer;
+    gint64 timeout_us;
+    gint64 last_activity;
+    guint timeout_id;
+} IdleMonitor;
+
+///////////////////////////////////////////////////////////////////////////////
+// Private API
+////
+
+static void priv_find_untrusted(Device1* device, void* user_data) {
+    if (device1_get_paired(device) && !device1_get_trusted(device)) {
+        *(bool*)user_data = true;
+    }
+}
+
+// A bonded device that isn't trusted needs the agent to authorize its
+// services every time it reconnects, so the agent has to stay up for it.
+static bool priv_is_quiet(IdleMonitor* monitor) {
+    if (0 != monitor->agent_server->pending_requests->len) {
+        return false;
+    }
+
+    bool untrusted = false;
+    switch (state_get(monitor->state_publisher)) {
+    case STATE_CONNECTION_WAIT:
+        bluez_client_foreach_device(monitor->bluez_client,
+            priv_find_untrusted, &untrusted);
+        return !untrusted;
+    case STATE_CONNECTED: return true;
+    default: return false;
+    }
+}
+
+static gboolean priv_on_timeout(gpointer user_data);
+
+static void priv_arm(IdleMonitor* monitor, gint64 delay_us) {
+    // Round up, so that we never wake up just before the deadline
+    const guint delay_s = (guint)((delay_us + G_TIME_SPAN_SECOND - 1)
+        / G_TIME_SPAN_SECOND);
+    monitor->timeout_id = g_timeout_add_seconds(delay_s, priv_on_timeout,
+        monitor);
+}
+
+// Rather than rescheduling the timer on every poke, the timer only fires
+// once per timeout period and re-arms itself for whatever remains.
+static gboolean priv_on_timeout(gpointer user_data) {
+    IdleMonitor* monitor = (IdleMonitor*)user_data;
+    monitor->timeout_id = 0;
+
+    const gint64 idle = g_get_monotonic_time() - monitor->last_activity;
+    if (idle < monitor->timeout_us) {
+        priv_arm(monitor, monitor->timeout_us - idle);
+    } else if (!priv_is_quiet(monitor)) {
+        priv_arm(monitor, monitor->timeout_us);
+    } else {
+        g_info("IdleMonitor: Idle for %u seconds, shutting down",
+            (unsigned int)(idle / G_TIME_SPAN_SECOND));
+        state_set(monitor->state_publisher, STATE_SHUTDOWN);
+    }
+    return G_SOURCE_REMOVE;
+}
+
+static void priv_on_entry(enum State state, void* user_data)
+{ idle_monitor_poke((IdleMonitor*)user_data); }
+
+///////////////////////////////////////////////////////////////////////////////
+// Public API
+////
+
+IdleMonitor* idle_monitor_init(StatePublisher* state_publisher,
+    AgentServer* agent_server, BluezClient* bluez_client,
+    unsigned int timeout_seconds)
+{
+    IdleMonitor* monitor = malloc(sizeof(IdleMonitor));
+    if (NULL == monitor) {
+        return NULL;
+    }
+
+    state_ref(state_publisher);
+    monitor->state_publisher = state_publisher;
+    monitor->agent_server = agent_server;
+    monitor->bluez_client = bluez_client;
+    monitor->state_observer = state_add_observer(state_publisher, NULL,
+        priv_on_entry, monitor);
+    monitor->timeout_us = (gint64)timeout_seconds * G_TIME_SPAN_SECOND;
+    monitor->last_activity = g_get_monotonic_time();
+    priv_arm(monitor, monitor->timeout_us);
+    return monitor;
+}
+
+void idle_monitor_poke(IdleMonitor* monitor) {
+    monitor->last_activity = g_get_monotonic_time();
+}
+
+void idle_monitor_set_timeout(IdleMonitor* monitor,
+    unsigned int timeout_seconds)
+{
+    monitor->timeout_us = (gint64)timeout_seconds * G_TIME_SPAN_SECOND;
+    if (0 != monitor->timeout_id) {
+        g_source_remove(monitor->timeout_id);
+    }
+
+    const gint64 idle = g_get_monotonic_time() - monitor->last_activity;
+    priv_arm(monitor, MAX(0, monitor->timeout_us - idle));
+}
+
+void idle_monitor_free(IdleMonitor** monitor) {
+    if (NULL == *monitor) {
+        return;
+    }
+
+    if (0 != (*monitor)->timeout_id) {
+        g_source_remove((*monitor)->timeout_id);
+    }
+    state_remove_observer((*monitor)->state_publisher,
+        (*monitor)->state_observer);
+    state_deref(&(*monitor)->state_publisher);
+    free(*monitor);
+    *monitor = NULL;
+}
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,57 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            idle-monitor.h
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Shut the agent down after a period of inactivity
+//
+// CREATED:         10/18/2026
+//
+// LAST EDITED:     10/18/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+#ifndef IDLE_MONITOR_H
+#define IDLE_MONITOR_H
+
+typedef struct AgentServer AgentServer;
+typedef struct BluezClient BluezClient;
+typedef struct StatePublisher StatePublisher;
+
+// Moves the state machine to STATE_SHUTDOWN once no activity has been seen
+// for the timeout, provided the agent is in a quiet state: not pairable, with
+// no agent requests pending, and with no bonded device that isn't trusted.
+// State transitions count as activity.
+//
+// Once the agent has exited, nothing answers bluetoothd until the next web
+// request starts it again: services of untrusted devices are rejected, and
+// the adapter is no longer discoverable. The agent therefore stays up while
+// such a device may reconnect; trusted devices connect without it.
+typedef struct IdleMonitor IdleMonitor;
+
+IdleMonitor* idle_monitor_init(StatePublisher* state_publisher,
+    AgentServer* agent_server, BluezClient* bluez_client,
+    unsigned int timeout_seconds);
+void idle_monitor_poke(IdleMonitor* monitor);
+// Activity seen so far counts towards the new timeout
+void idle_monitor_set_timeout(IdleMonitor* monitor,
+    unsigned int timeout_seconds);
+void idle_monitor_free(IdleMonitor** monitor);
+
+#endif // IDLE_MONITOR_H
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,472 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            link-monitor.c
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Link quality statistics for connected devices
+//
+// CREATED:         10/18/2026
+//
+// LAST EDITED:     10/18/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+
+#include <bluez.h>
+#include <bluez-client.h>
+#include <link-monitor.h>
+#include <memory-stats.h>
+#include <mgmt-client.h>
+
+// Sample quickly while a link looks like it's about to drop, so that the
+// dip is visible; otherwise a slow sample rate is plenty. The kernel caches
+// connection information for between one and three seconds, so polling
+// faster than that only returns the same reading again.
+static const guint FAST_INTERVAL_MS = 3000;
+static const guint SLOW_INTERVAL_MS = 10000;
+static const int16_t MARGINAL_RSSI = -80;
+static const double MARGINAL_SPREAD = 10.0;
+
+typedef struct LinkEntry {
+    bool in_use;
+    LinkStats stats;
+    int16_t ring[LINK_MONITOR_SAMPLES];
+    unsigned int head;
+    Device1* device; // <- Referenced while connected
+    unsigned int generation;
+    gint64 last_active;
+    gint64 sampled_at;
+
+    // Without a management socket, samples come from bluetoothd
+    gulong properties_handler;
+    // A public address could be BR/EDR or LE. BR/EDR is tried first.
+    enum MgmtAddressType address_type;
+    bool request_pending;
+} LinkEntry;
+
+typedef struct LinkListener {
+    unsigned int id;
+    void (*changed)(void* user_data);
+    void* user_data;
+} LinkListener;
+
+typedef struct LinkMonitor {
+    BluezClient* bluez_client;
+    MgmtClient* mgmt_client; // <- NULL without CAP_NET_ADMIN
+    unsigned int devices_listener;
+    GArray* listeners;
+    unsigned int next_listener_id;
+
+    // Storage is fixed, so memory doesn't grow with the number of devices
+    // ever seen.
+    LinkEntry entries[LINK_MONITOR_MAXIMUM_DEVICES];
+    unsigned int num_connected;
+    unsigned int generation;
+    bool connections_changed;
+
+    guint timer_id;
+    guint interval_ms;
+    unsigned int outstanding; // <- Requests the kernel hasn't answered
+} LinkMonitor;
+
+///////////////////////////////////////////////////////////////////////////////
+// Private API
+////
+
+static void priv_notify(LinkMonitor* monitor) {
+    for (guint i = 0; i < monitor->listeners->len; ++i) {
+        LinkListener* listener = &g_array_index(monitor->listeners,
+            LinkListener, i);
+        listener->changed(listener->user_data);
+    }
+}
+
+static LinkEntry* priv_find(LinkMonitor* monitor, const char* address) {
+    for (int i = 0; i < LINK_MONITOR_MAXIMUM_DEVICES; ++i) {
+        LinkEntry* entry = &monitor->entries[i];
+        if (entry->in_use
+            && !g_ascii_strcasecmp(entry->stats.address, address)) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+// Take a free slot, or else the one that has been disconnected longest
+static LinkEntry* priv_allocate(LinkMonitor* monitor, const char* address) {
+    LinkEntry* victim = NULL;
+    for (int i = 0; i < LINK_MONITOR_MAXIMUM_DEVICES; ++i) {
+        LinkEntry* entry = &monitor->entries[i];
+        if (!entry->in_use) {
+            victim = entry;
+            break;
+        } else if (!entry->stats.connected && (NULL == victim
+                || entry->last_active < victim->last_active)) {
+            victim = entry;
+        }
+    }
+
+    if (NULL == victim) {
+        return NULL;
+    }
+
+    memset(victim, 0, sizeof(LinkEntry));
+    victim->in_use = true;
+    g_strlcpy(victim->stats.address, address, sizeof(victim->stats.address));
+    return victim;
+}
+
+static void priv_record(LinkEntry* entry, int16_t rssi, int16_t tx_power) {
+    entry->stats.tx_power = tx_power;
+    entry->last_active = entry->sampled_at = g_get_monotonic_time();
+    entry->ring[entry->head] = rssi;
+    entry->head = (entry->head + 1) % LINK_MONITOR_SAMPLES;
+    if (entry->stats.num_samples < LINK_MONITOR_SAMPLES) {
+        ++entry->stats.num_samples;
+    }
+
+    // With 64 samples, sorting a copy is cheaper than maintaining a
+    // histogram across the whole RSSI range.
+    const unsigned int count = entry->stats.num_samples;
+    int16_t sorted[LINK_MONITOR_SAMPLES];
+    int32_t sum = 0;
+    for (unsigned int i = 0; i < count; ++i) {
+        int16_t value = entry->ring[i];
+        unsigned int j = i;
+        for (; j > 0 && sorted[j - 1] > value; --j) {
+            sorted[j] = sorted[j - 1];
+        }
+        sorted[j] = value;
+        sum += value;
+    }
+
+    entry->stats.rssi_last = rssi;
+    entry->stats.rssi_min = sorted[0];
+    entry->stats.rssi_p5 = sorted[(count * 5 + 99) / 100 - 1];
+    entry->stats.rssi_average = (double)sum / count;
+}
+
+// The low tail, rather than the single worst reading, so one bad sample
+// doesn't keep the link marginal for the life of the ring.
+static bool priv_is_marginal(const LinkEntry* entry) {
+    return 0 < entry->stats.num_samples
+        && (entry->stats.rssi_last < MARGINAL_RSSI
+            || entry->stats.rssi_average - entry->stats.rssi_p5
+            > MARGINAL_SPREAD);
+}
+
+static gboolean priv_on_timer(gpointer user_data);
+
+static void priv_arm(LinkMonitor* monitor, guint interval_ms) {
+    if (0 != monitor->timer_id && interval_ms == monitor->interval_ms) {
+        return;
+    }
+
+    if (0 != monitor->timer_id) {
+        g_source_remove(monitor->timer_id);
+    }
+    monitor->interval_ms = interval_ms;
+    monitor->timer_id = g_timeout_add(interval_ms, priv_on_timer, monitor);
+}
+
+static void priv_disarm(LinkMonitor* monitor) {
+    if (0 != monitor->timer_id) {
+        g_source_remove(monitor->timer_id);
+        monitor->timer_id = 0;
+    }
+}
+
+// Only links with a reading from the last couple of rounds count, so a
+// link the controller can't read doesn't hold the fast rate forever.
+static void priv_finish_round(LinkMonitor* monitor) {
+    const gint64 stale_before = g_get_monotonic_time()
+        - 2 * (gint64)monitor->interval_ms * 1000;
+    bool marginal = false;
+    for (int i = 0; i < LINK_MONITOR_MAXIMUM_DEVICES; ++i) {
+        LinkEntry* entry = &monitor->entries[i];
+        if (entry->in_use && entry->stats.connected
+            && entry->sampled_at >= stale_before) {
+            marginal = marginal || priv_is_marginal(entry);
+        }
+    }
+    priv_notify(monitor);
+
+    if (0 != monitor->timer_id) {
+        priv_arm(monitor, marginal ? FAST_INTERVAL_MS : SLOW_INTERVAL_MS);
+    }
+}
+
+static void priv_on_connection_info(const char* address,
+    enum MgmtAddressType type, int status, const MgmtConnectionInfo* info,
+    void* user_data)
+{
+    LinkMonitor* monitor = (LinkMonitor*)user_data;
+    LinkEntry* entry = priv_find(monitor, address);
+    if (NULL != entry) {
+        entry->request_pending = false;
+    }
+
+    if (NULL == entry || !entry->stats.connected) {
+        // Disconnected or evicted while the request was outstanding
+    } else if (MGMT_STATUS_SUCCESS == status
+        && MGMT_VALUE_UNKNOWN != info->rssi) {
+        priv_record(entry, info->rssi,
+            MGMT_VALUE_UNKNOWN != info->tx_power ? info->tx_power : 0);
+    } else if (MGMT_STATUS_NOT_CONNECTED == status
+        && MGMT_ADDRESS_BREDR == type) {
+        entry->address_type = MGMT_ADDRESS_LE_PUBLIC;
+    } else if (MGMT_STATUS_SUCCESS != status) {
+        g_debug("LinkMonitor: No connection information for %s: status "
+            "%d", address, status);
+    }
+
+    if (0 == --monitor->outstanding) {
+        priv_finish_round(monitor);
+    }
+}
+
+static void priv_request(LinkMonitor* monitor, LinkEntry* entry) {
+    if (entry->request_pending) {
+        return; // <- The controller hasn't answered the last one yet
+    }
+
+    if (0 == mgmt_client_get_connection_info(monitor->mgmt_client,
+            entry->stats.address, entry->address_type,
+            priv_on_connection_info, monitor)) {
+        entry->request_pending = true;
+        ++monitor->outstanding;
+    }
+}
+
+static gboolean priv_on_timer(gpointer user_data) {
+    LinkMonitor* monitor = (LinkMonitor*)user_data;
+    for (int i = 0; i < LINK_MONITOR_MAXIMUM_DEVICES; ++i) {
+        LinkEntry* entry = &monitor->entries[i];
+        if (entry->in_use && entry->stats.connected) {
+            priv_request(monitor, entry);
+        }
+    }
+
+    if (0 == monitor->outstanding) {
+        priv_finish_round(monitor);
+    }
+    return G_SOURCE_CONTINUE;
+}
+
+// bluetoothd only updates RSSI from inquiry and advertising reports, so
+// this records a sample only when it actually reports a new one.
+static void priv_on_properties_changed(GDBusProxy* proxy,
+    GVariant* changed, const gchar* const* invalidated, gpointer user_data)
+{
+    LinkMonitor* monitor = (LinkMonitor*)user_data;
+    gint16 rssi = 0;
+    if (!g_variant_lookup(changed, "RSSI", "n", &rssi)) {
+        return;
+    }
+
+    for (int i = 0; i < LINK_MONITOR_MAXIMUM_DEVICES; ++i) {
+        LinkEntry* entry = &monitor->entries[i];
+        if (entry->in_use && (GDBusProxy*)entry->device == proxy) {
+            priv_record(entry, rssi, device1_get_tx_power(entry->device));
+            priv_notify(monitor);
+            return;
+        }
+    }
+}
+
+static void priv_connect(LinkMonitor* monitor, LinkEntry* entry,
+    Device1* device)
+{
+    g_info("LinkMonitor: %s connected", entry->stats.address);
+    entry->device = g_object_ref(device);
+    entry->stats.connected = true;
+    entry->stats.connected_since = g_get_real_time();
+    ++entry->stats.connects;
+    ++monitor->num_connected;
+    monitor->connections_changed = true;
+    if (NULL == monitor->mgmt_client) {
+        entry->properties_handler = g_signal_connect(device,
+            "g-properties-changed", G_CALLBACK(priv_on_properties_changed),
+            monitor);
+        return;
+    }
+
+    entry->address_type = !g_strcmp0("random",
+        device1_get_address_type(device))
+        ? MGMT_ADDRESS_LE_RANDOM : MGMT_ADDRESS_BREDR;
+    priv_arm(monitor, 0 != monitor->timer_id
+        ? monitor->interval_ms : SLOW_INTERVAL_MS);
+    priv_request(monitor, entry);
+}
+
+static void priv_disconnect(LinkMonitor* monitor, LinkEntry* entry) {
+    g_info("LinkMonitor: %s disconnected", entry->stats.address);
+    if (0 != entry->properties_handler) {
+        g_signal_handler_disconnect(entry->device, entry->properties_handler);
+        entry->properties_handler = 0;
+    }
+    g_clear_object(&entry->device);
+    entry->stats.connected = false;
+    ++entry->stats.disconnects;
+    entry->last_active = g_get_monotonic_time();
+    monitor->connections_changed = true;
+    if (0 == --monitor->num_connected) {
+        priv_disarm(monitor);
+    }
+}
+
+static void priv_scan_device(Device1* device, void* user_data) {
+    LinkMonitor* monitor = (LinkMonitor*)user_data;
+    const char* address = device1_get_address(device);
+    if (NULL == address) {
+        return;
+    }
+
+    LinkEntry* entry = priv_find(monitor, address);
+    const bool connected = device1_get_connected(device);
+    if (connected && NULL == entry) {
+        entry = priv_allocate(monitor, address);
+    }
+    if (NULL == entry) {
+        return;
+    }
+
+    entry->generation = monitor->generation;
+    if (connected && !entry->stats.connected) {
+        priv_connect(monitor, entry, device);
+    } else if (!connected && entry->stats.connected) {
+        priv_disconnect(monitor, entry);
+    }
+}
+
+// Device notifications are batched by BluezClient, so this rescan doesn't
+// run per advertisement.
+static void priv_on_devices_changed(void* user_data) {
+    LinkMonitor* monitor = (LinkMonitor*)user_data;
+    monitor->connections_changed = false;
+    ++monitor->generation;
+    bluez_client_foreach_device(monitor->bluez_client, priv_scan_device,
+        monitor);
+
+    // Devices removed from the adapter while connected
+    for (int i = 0; i < LINK_MONITOR_MAXIMUM_DEVICES; ++i) {
+        LinkEntry* entry = &monitor->entries[i];
+        if (entry->in_use && entry->stats.connected
+            && entry->generation != monitor->generation) {
+            priv_disconnect(monitor, entry);
+        }
+    }
+
+    if (monitor->connections_changed) {
+        priv_notify(monitor);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Public API
+////
+
+LinkMonitor* link_monitor_init(BluezClient* bluez_client,
+    const char* adapter)
+{
+    LinkMonitor* monitor = calloc(1, sizeof(LinkMonitor));
+    if (NULL == monitor) {
+        return NULL;
+    }
+
+    memory_stats_allocated(MEMORY_DOMAIN_DBUS, sizeof(LinkMonitor));
+    monitor->bluez_client = bluez_client;
+    monitor->mgmt_client = mgmt_client_init(adapter);
+    if (NULL == monitor->mgmt_client) {
+        g_warning("LinkMonitor: No management socket for %s, so RSSI is "
+            "only sampled when bluetoothd reports it", adapter);
+    }
+    monitor->listeners = g_array_new(FALSE, FALSE, sizeof(LinkListener));
+    monitor->next_listener_id = 1;
+    monitor->devices_listener = bluez_client_add_devices_listener(
+        bluez_client, priv_on_devices_changed, monitor);
+    priv_on_devices_changed(monitor);
+    return monitor;
+}
+
+void link_monitor_free(LinkMonitor** monitor) {
+    if (NULL == *monitor) {
+        return;
+    }
+
+    priv_disarm(*monitor);
+    bluez_client_remove_devices_listener((*monitor)->bluez_client,
+        (*monitor)->devices_listener);
+    for (int i = 0; i < LINK_MONITOR_MAXIMUM_DEVICES; ++i) {
+        LinkEntry* entry = &(*monitor)->entries[i];
+        if (0 != entry->properties_handler) {
+            g_signal_handler_disconnect(entry->device,
+                entry->properties_handler);
+        }
+        g_clear_object(&entry->device);
+    }
+    // Outstanding requests are dropped along with the client
+    mgmt_client_free(&(*monitor)->mgmt_client);
+    g_array_unref((*monitor)->listeners);
+    memory_stats_released(MEMORY_DOMAIN_DBUS, sizeof(LinkMonitor));
+    free(*monitor);
+    *monitor = NULL;
+}
+
+unsigned int link_monitor_add_listener(LinkMonitor* monitor,
+    void (*changed)(void* user_data), void* user_data)
+{
+    LinkListener listener = {
+        .id = monitor->next_listener_id++,
+        .changed = changed,
+        .user_data = user_data,
+    };
+    g_array_append_val(monitor->listeners, listener);
+    return listener.id;
+}
+
+void link_monitor_remove_listener(LinkMonitor* monitor, unsigned int id) {
+    for (guint i = 0; i < monitor->listeners->len; ++i) {
+        if (id == g_array_index(monitor->listeners, LinkListener, i).id) {
+            g_array_remove_index(monitor->listeners, i);
+            return;
+        }
+    }
+}
+
+void link_monitor_foreach(LinkMonitor* monitor,
+    void (*callback)(const LinkStats* stats, void* user_data),
+    void* user_data)
+{
+    for (int i = 0; i < LINK_MONITOR_MAXIMUM_DEVICES; ++i) {
+        if (monitor->entries[i].in_use) {
+            callback(&monitor->entries[i].stats, user_data);
+        }
+    }
+}
+
+const LinkStats* link_monitor_get(LinkMonitor* monitor, const char* address) {
+    LinkEntry* entry = priv_find(monitor, address);
+    return NULL != entry ? &entry->stats : NULL;
+}
+
+///////////////////////////////////////////////////////////////////////////////
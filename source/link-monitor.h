@@ -0,0 +1,83 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            link-monitor.h
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Link quality statistics for connected devices
+//
+// CREATED:         10/18/2026
+//
+// LAST EDITED:     10/18/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+#ifndef LINK_MONITOR_H
+#define LINK_MONITOR_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct BluezClient BluezClient;
+
+enum {
+    LINK_MONITOR_SAMPLES = 64,
+    LINK_MONITOR_MAXIMUM_DEVICES = 32,
+};
+
+// Aggregates are recomputed as each sample is taken, so readers never
+// walk the ring. RSSI and TX power are in dBm.
+typedef struct LinkStats {
+    char address[18];
+    bool connected;
+    int64_t connected_since;  // <- Wall clock, microseconds; 0 if never
+    unsigned int connects;
+    unsigned int disconnects;
+
+    unsigned int num_samples; // <- At most LINK_MONITOR_SAMPLES
+    int16_t rssi_last;
+    int16_t rssi_min;
+    int16_t rssi_p5;          // <- The weak end of the distribution
+    double rssi_average;
+    int16_t tx_power;         // <- 0 if the controller doesn't know it
+} LinkStats;
+
+// Reads the RSSI of every connected link from the kernel on one timer, which
+// runs faster while any link with a recent reading looks marginal and stops
+// altogether when nothing is connected. Without CAP_NET_ADMIN, there's no
+// timer: a sample is recorded only when bluetoothd reports a new RSSI,
+// which it may never do for a connected device. Devices that disconnect
+// keep their statistics until evicted to make room for another device.
+typedef struct LinkMonitor LinkMonitor;
+
+LinkMonitor* link_monitor_init(BluezClient* bluez_client,
+    const char* adapter);
+void link_monitor_free(LinkMonitor** monitor);
+
+// Invoked after every sampling round and connection event
+unsigned int link_monitor_add_listener(LinkMonitor* monitor,
+    void (*changed)(void* user_data), void* user_data);
+void link_monitor_remove_listener(LinkMonitor* monitor, unsigned int id);
+
+void link_monitor_foreach(LinkMonitor* monitor,
+    void (*callback)(const LinkStats* stats, void* user_data),
+    void* user_data);
+// Returns NULL if the device isn't tracked
+const LinkStats* link_monitor_get(LinkMonitor* monitor, const char* address);
+
+#endif // LINK_MONITOR_H
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,594 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            logger.c
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Buffered, rate-limited log writer
+//
+// CREATED:         10/18/2026
+//
+// LAST EDITED:     10/18/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+#define _GNU_SOURCE // <- sendmmsg()
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <glib.h>
+
+#include <logger.h>
+
+enum {
+    LOG_RING_SLOTS = 256,
+    LOG_MESSAGE_SIZE = 512,
+    LOG_SUBSYSTEM_SIZE = 24,
+    LOG_MAXIMUM_SUBSYSTEMS = 32,
+    // Datagrams handed to the journal per system call
+    LOG_JOURNAL_BATCH = 64,
+};
+
+static const char* JOURNAL_SOCKET = "/run/systemd/journal/socket";
+
+typedef struct LogSubsystem {
+    char name[LOG_SUBSYSTEM_SIZE];
+    gint ready;               // <- Set once the name has been written
+    gint verbosity;           // <- GLogLevelFlags, zero to follow the default
+
+    // Rate limiting state, owned by whoever holds the drain lock
+    double tokens;
+    gint64 updated;
+    unsigned int suppressed;
+} LogSubsystem;
+
+// Slots are claimed and published with a sequence number per slot, so that
+// producers on any thread never take a lock (Vyukov's bounded queue).
+typedef struct LogSlot {
+    gint sequence;
+    GLogLevelFlags level;
+    int subsystem;            // <- Index into the subsystems, or -1
+    char message[LOG_MESSAGE_SIZE];
+} LogSlot;
+
+typedef struct LogRecord {
+    GLogLevelFlags level;
+    char message[LOG_MESSAGE_SIZE];
+} LogRecord;
+
+typedef struct Logger {
+    LogSlot slots[LOG_RING_SLOTS];
+    gint enqueue_position;
+    gint dequeue_position;
+    gint dropped;
+    gint running;
+
+    LogSubsystem subsystems[LOG_MAXIMUM_SUBSYSTEMS];
+    LogSubsystem unattributed;
+    gint num_subsystems;
+    gint default_verbosity;
+    gint initial_verbosity;
+
+    GThread* thread;
+    GMutex wake_lock;
+    GCond wake;
+
+    // Everything below belongs to whoever holds the drain lock
+    GMutex drain_lock;
+    int journal;              // <- Connected socket, or -1 to use stderr
+    GArray* batch;            // <- LogRecord, written out once per drain
+    GString* lines;
+    LogSlot last;
+    unsigned int repeats;
+    gint64 repeats_since;
+} Logger;
+
+static Logger logger;
+
+static const gint64 FLUSH_INTERVAL = G_TIME_SPAN_SECOND / 10;
+// "Last message repeated" is written at least this often
+static const gint64 COLLAPSE_INTERVAL = 10 * G_TIME_SPAN_SECOND;
+// Per subsystem, for messages less severe than a warning
+static const double LOG_RATE = 20;
+static const double LOG_BURST = 50;
+
+///////////////////////////////////////////////////////////////////////////////
+// Private API
+////
+
+static const char* priv_priority(GLogLevelFlags level) {
+    switch (level & G_LOG_LEVEL_MASK) {
+    case G_LOG_LEVEL_ERROR: return "3";
+    case G_LOG_LEVEL_CRITICAL: return "4";
+    case G_LOG_LEVEL_WARNING: return "4";
+    case G_LOG_LEVEL_MESSAGE: return "5";
+    case G_LOG_LEVEL_INFO: return "6";
+    default: return "7";
+    }
+}
+
+static gint priv_parse_level(const char* level) {
+    static const struct { const char* name; GLogLevelFlags level; } levels[] = {
+        { "warning", G_LOG_LEVEL_WARNING },
+        { "message", G_LOG_LEVEL_MESSAGE },
+        { "info", G_LOG_LEVEL_INFO },
+        { "debug", G_LOG_LEVEL_DEBUG },
+    };
+    for (size_t i = 0; i < G_N_ELEMENTS(levels); ++i) {
+        if (NULL != level && !strcmp(level, levels[i].name)) {
+            return levels[i].level;
+        }
+    }
+    return 0;
+}
+
+static LogSubsystem* priv_get_subsystem(int index) {
+    return 0 > index ? &logger.unattributed : &logger.subsystems[index];
+}
+
+static int priv_find_subsystem(const char* name, size_t length, bool create)
+{
+    const gint count = MIN(g_atomic_int_get(&logger.num_subsystems),
+        LOG_MAXIMUM_SUBSYSTEMS);
+    for (gint i = 0; i < count; ++i) {
+        LogSubsystem* subsystem = &logger.subsystems[i];
+        if (g_atomic_int_get(&subsystem->ready)
+            && !strncmp(subsystem->name, name, length)
+            && '\0' == subsystem->name[length]) {
+            return i;
+        }
+    }
+
+    // Two threads may race to add the same name. The duplicate is harmless,
+    // since verbosity is set on every entry with a matching name.
+    if (!create || count >= LOG_MAXIMUM_SUBSYSTEMS) {
+        return -1;
+    }
+    const gint index = g_atomic_int_add(&logger.num_subsystems, 1);
+    if (index >= LOG_MAXIMUM_SUBSYSTEMS) {
+        return -1;
+    }
+
+    LogSubsystem* subsystem = &logger.subsystems[index];
+    memcpy(subsystem->name, name, length);
+    subsystem->name[length] = '\0';
+    subsystem->tokens = LOG_BURST;
+    subsystem->updated = g_get_monotonic_time();
+    g_atomic_int_set(&subsystem->ready, 1);
+    return index;
+}
+
+// "WebServer: Listening" belongs to WebServer, and messages from libraries
+// belong to their log domain.
+static int priv_attribute(const char* domain, const char* message) {
+    if (NULL != domain) {
+        return priv_find_subsystem(domain,
+            MIN(strlen(domain), LOG_SUBSYSTEM_SIZE - 1), true);
+    }
+
+    const char* colon = strchr(message, ':');
+    if (NULL == colon || ' ' != colon[1] || colon == message
+        || colon - message >= LOG_SUBSYSTEM_SIZE) {
+        return -1;
+    }
+    for (const char* c = message; c < colon; ++c) {
+        if (!g_ascii_isalnum(*c)) {
+            return -1;
+        }
+    }
+    return priv_find_subsystem(message, colon - message, true);
+}
+
+static GLogLevelFlags priv_verbosity(int index) {
+    gint verbosity = 0 > index ? 0
+        : g_atomic_int_get(&logger.subsystems[index].verbosity);
+    if (0 == verbosity) {
+        verbosity = g_atomic_int_get(&logger.default_verbosity);
+    }
+    return verbosity;
+}
+
+static bool priv_enqueue(GLogLevelFlags level, int subsystem,
+    const char* message, gssize length)
+{
+    LogSlot* slot = NULL;
+    guint position = g_atomic_int_get(&logger.enqueue_position);
+    for (;;) {
+        slot = &logger.slots[position % LOG_RING_SLOTS];
+        const gint difference = (gint)((guint)g_atomic_int_get(
+                &slot->sequence) - position);
+        if (0 == difference) {
+            if (g_atomic_int_compare_and_exchange(&logger.enqueue_position,
+                    position, position + 1)) {
+                break;
+            }
+        } else if (0 > difference) {
+            return false;
+        }
+        position = g_atomic_int_get(&logger.enqueue_position);
+    }
+
+    if (0 > length || (gsize)length >= sizeof(slot->message)) {
+        g_strlcpy(slot->message, message, sizeof(slot->message));
+    } else {
+        memcpy(slot->message, message, length);
+        slot->message[length] = '\0';
+    }
+    slot->level = level;
+    slot->subsystem = subsystem;
+    g_atomic_int_set(&slot->sequence, position + 1);
+
+    // Don't wait for the timer if the ring is filling up
+    const guint queued = position
+        - (guint)g_atomic_int_get(&logger.dequeue_position);
+    if (queued == LOG_RING_SLOTS / 2) {
+        g_cond_signal(&logger.wake);
+    }
+    return true;
+}
+
+static bool priv_dequeue(LogSlot* entry) {
+    const guint position = g_atomic_int_get(&logger.dequeue_position);
+    LogSlot* slot = &logger.slots[position % LOG_RING_SLOTS];
+    const gint difference = (gint)((guint)g_atomic_int_get(&slot->sequence)
+        - (position + 1));
+    if (0 > difference) {
+        return false;
+    }
+
+    entry->level = slot->level;
+    entry->subsystem = slot->subsystem;
+    memcpy(entry->message, slot->message, sizeof(entry->message));
+    g_atomic_int_set(&logger.dequeue_position, position + 1);
+    g_atomic_int_set(&slot->sequence, position + LOG_RING_SLOTS);
+    return true;
+}
+
+static int priv_open_journal() {
+    const int fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (0 > fd) {
+        return -1;
+    }
+
+    struct sockaddr_un address = { .sun_family = AF_UNIX };
+    g_strlcpy(address.sun_path, JOURNAL_SOCKET, sizeof(address.sun_path));
+    if (0 != connect(fd, (struct sockaddr*)&address, sizeof(address))) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static void priv_output(GLogLevelFlags level, const char* message) {
+    g_array_set_size(logger.batch, logger.batch->len + 1);
+    LogRecord* record = &g_array_index(logger.batch, LogRecord,
+        logger.batch->len - 1);
+    record->level = level;
+    g_strlcpy(record->message, message, sizeof(record->message));
+}
+
+static void priv_write_lines(guint first) {
+    for (guint i = first; i < logger.batch->len; ++i) {
+        const LogRecord* record = &g_array_index(logger.batch, LogRecord, i);
+        const GLogField fields[] = {
+            { "MESSAGE", record->message, -1 },
+            { "PRIORITY", priv_priority(record->level), -1 },
+        };
+        char* line = g_log_writer_format_fields(record->level, fields,
+            G_N_ELEMENTS(fields), FALSE);
+        g_string_append(logger.lines, line);
+        g_string_append_c(logger.lines, '\n');
+        g_free(line);
+    }
+
+    size_t written = 0;
+    while (written < logger.lines->len) {
+        const ssize_t result = write(STDERR_FILENO,
+            logger.lines->str + written, logger.lines->len - written);
+        if (0 > result && EINTR != errno) {
+            break;
+        }
+        written += 0 > result ? 0 : result;
+    }
+    g_string_truncate(logger.lines, 0);
+}
+
+// Each entry is one datagram in the journal's native protocol, with the
+// message in the binary form so that newlines survive. sendmmsg() hands
+// the whole drain to the journal in as few system calls as possible,
+// where g_log_writer_journald() would take one per message.
+static guint priv_write_journal() {
+    static const char PRIORITY[] = "PRIORITY=";
+    static const char MESSAGE[] = "\nMESSAGE\n";
+    static const char NEWLINE[] = "\n";
+
+    guint sent = 0;
+    while (sent < logger.batch->len) {
+        struct mmsghdr messages[LOG_JOURNAL_BATCH];
+        struct iovec iov[LOG_JOURNAL_BATCH][6];
+        guint64 lengths[LOG_JOURNAL_BATCH];
+        const guint count = MIN(LOG_JOURNAL_BATCH, logger.batch->len - sent);
+        for (guint i = 0; i < count; ++i) {
+            LogRecord* record = &g_array_index(logger.batch, LogRecord,
+                sent + i);
+            const size_t length = strlen(record->message);
+            lengths[i] = GUINT64_TO_LE(length);
+            const struct iovec fields[] = {
+                { (void*)PRIORITY, sizeof(PRIORITY) - 1 },
+                { (void*)priv_priority(record->level), 1 },
+                { (void*)MESSAGE, sizeof(MESSAGE) - 1 },
+                { &lengths[i], sizeof(lengths[i]) },
+                { record->message, length },
+                { (void*)NEWLINE, sizeof(NEWLINE) - 1 },
+            };
+            memcpy(iov[i], fields, sizeof(fields));
+            messages[i] = (struct mmsghdr){
+                .msg_hdr = { .msg_iov = iov[i], .msg_iovlen = 6 },
+            };
+        }
+
+        const int result = sendmmsg(logger.journal, messages, count, 0);
+        if (0 > result && EINTR == errno) {
+            continue;
+        } else if (0 >= result) {
+            break;
+        }
+        sent += result;
+    }
+    return sent;
+}
+
+// Whatever the journal doesn't take goes to stderr
+static void priv_write_batch() {
+    const guint sent = 0 <= logger.journal ? priv_write_journal() : 0;
+    priv_write_lines(sent);
+    g_array_set_size(logger.batch, 0);
+}
+
+static void priv_flush_repeats(bool force) {
+    if (0 == logger.repeats || (!force && g_get_monotonic_time()
+            - logger.repeats_since < COLLAPSE_INTERVAL)) {
+        return;
+    }
+
+    char message[64];
+    snprintf(message, sizeof(message), "Last message repeated %u times",
+        logger.repeats);
+    priv_output(logger.last.level, message);
+    logger.repeats = 0;
+}
+
+static bool priv_rate_limit(LogSubsystem* subsystem, GLogLevelFlags level) {
+    if (G_LOG_LEVEL_WARNING >= level) {
+        return true;
+    }
+
+    const gint64 now = g_get_monotonic_time();
+    subsystem->tokens = MIN(LOG_BURST, subsystem->tokens
+        + (double)(now - subsystem->updated) / G_TIME_SPAN_SECOND * LOG_RATE);
+    subsystem->updated = now;
+    if (1.0 > subsystem->tokens) {
+        ++subsystem->suppressed;
+        return false;
+    }
+
+    subsystem->tokens -= 1.0;
+    if (0 != subsystem->suppressed) {
+        char message[96];
+        snprintf(message, sizeof(message), "%s: %u messages suppressed",
+            '\0' != subsystem->name[0] ? subsystem->name : "Logger",
+            subsystem->suppressed);
+        priv_output(G_LOG_LEVEL_WARNING, message);
+        subsystem->suppressed = 0;
+    }
+    return true;
+}
+
+static void priv_emit(const LogSlot* entry) {
+    if (entry->level == logger.last.level
+        && entry->subsystem == logger.last.subsystem
+        && !strcmp(entry->message, logger.last.message)) {
+        if (0 == logger.repeats++) {
+            logger.repeats_since = g_get_monotonic_time();
+        }
+        return;
+    }
+
+    priv_flush_repeats(true);
+    if (!priv_rate_limit(priv_get_subsystem(entry->subsystem),
+            entry->level)) {
+        return;
+    }
+    priv_output(entry->level, entry->message);
+    memcpy(&logger.last, entry, sizeof(logger.last));
+}
+
+static void priv_drain() {
+    g_mutex_lock(&logger.drain_lock);
+    LogSlot entry;
+    while (priv_dequeue(&entry)) {
+        priv_emit(&entry);
+    }
+
+    const gint dropped = g_atomic_int_get(&logger.dropped);
+    if (0 != dropped) {
+        g_atomic_int_add(&logger.dropped, -dropped);
+        char message[64];
+        snprintf(message, sizeof(message),
+            "Logger: Dropped %d messages, the buffer was full", dropped);
+        priv_output(G_LOG_LEVEL_WARNING, message);
+    }
+
+    priv_flush_repeats(false);
+    priv_write_batch();
+    g_mutex_unlock(&logger.drain_lock);
+}
+
+static gpointer priv_flush_thread(gpointer user_data) {
+    g_mutex_lock(&logger.wake_lock);
+    while (g_atomic_int_get(&logger.running)) {
+        g_cond_wait_until(&logger.wake, &logger.wake_lock,
+            g_get_monotonic_time() + FLUSH_INTERVAL);
+        g_mutex_unlock(&logger.wake_lock);
+        priv_drain();
+        g_mutex_lock(&logger.wake_lock);
+    }
+    g_mutex_unlock(&logger.wake_lock);
+    return NULL;
+}
+
+static GLogWriterOutput priv_write(GLogLevelFlags log_level,
+    const GLogField* fields, gsize n_fields, gpointer user_data)
+{
+    const GLogLevelFlags level = log_level & G_LOG_LEVEL_MASK;
+    if (!g_atomic_int_get(&logger.running) || (log_level & G_LOG_FLAG_FATAL)
+        || G_LOG_LEVEL_CRITICAL >= level) {
+        // Whatever is queued goes out first, to keep the order
+        if (NULL != logger.batch) {
+            priv_drain();
+        }
+        return g_log_writer_default(log_level, fields, n_fields, user_data);
+    }
+
+    const char* message = NULL;
+    gssize length = -1;
+    const char* domain = NULL;
+    for (gsize i = 0; i < n_fields; ++i) {
+        if (!strcmp(fields[i].key, "MESSAGE")) {
+            message = fields[i].value;
+            length = fields[i].length;
+        } else if (!strcmp(fields[i].key, "GLIB_DOMAIN")) {
+            domain = fields[i].value;
+        }
+    }
+    if (NULL == message) {
+        return G_LOG_WRITER_UNHANDLED;
+    }
+
+    const int subsystem = priv_attribute(domain, message);
+    if (level > priv_verbosity(subsystem)) {
+        return G_LOG_WRITER_HANDLED;
+    }
+    if (!priv_enqueue(level, subsystem, message, length)) {
+        g_atomic_int_inc(&logger.dropped);
+    }
+    return G_LOG_WRITER_HANDLED;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Public API
+////
+
+void logger_init(void) {
+    static bool writer_installed = false;
+    if (g_atomic_int_get(&logger.running)) {
+        return;
+    }
+
+    for (gint i = 0; i < LOG_RING_SLOTS; ++i) {
+        logger.slots[i].sequence = i;
+    }
+    logger.enqueue_position = 0;
+    logger.dequeue_position = 0;
+    logger.unattributed.tokens = LOG_BURST;
+    logger.unattributed.updated = g_get_monotonic_time();
+    logger.initial_verbosity = NULL != getenv("G_MESSAGES_DEBUG")
+        ? G_LOG_LEVEL_DEBUG : G_LOG_LEVEL_MESSAGE;
+    logger.default_verbosity = logger.initial_verbosity;
+    logger.last.subsystem = -1;
+    logger.journal = g_log_writer_is_journald(fileno(stderr))
+        ? priv_open_journal() : -1;
+    logger.batch = g_array_new(FALSE, FALSE, sizeof(LogRecord));
+    logger.lines = g_string_new(NULL);
+    g_mutex_init(&logger.wake_lock);
+    g_mutex_init(&logger.drain_lock);
+    g_cond_init(&logger.wake);
+
+    g_atomic_int_set(&logger.running, 1);
+    logger.thread = g_thread_new("logger", priv_flush_thread, NULL);
+    // GLib only allows the writer to be set once
+    if (!writer_installed) {
+        g_log_set_writer_func(priv_write, NULL, NULL);
+        writer_installed = true;
+    }
+}
+
+void logger_shutdown(void) {
+    if (!g_atomic_int_get(&logger.running)) {
+        return;
+    }
+
+    g_mutex_lock(&logger.wake_lock);
+    g_atomic_int_set(&logger.running, 0);
+    g_cond_signal(&logger.wake);
+    g_mutex_unlock(&logger.wake_lock);
+    g_thread_join(logger.thread);
+    logger.thread = NULL;
+
+    priv_drain();
+    g_mutex_lock(&logger.drain_lock);
+    priv_flush_repeats(true);
+    priv_write_batch();
+    // Later messages go out synchronously, and stderr will do for those
+    if (0 <= logger.journal) {
+        close(logger.journal);
+        logger.journal = -1;
+    }
+    g_mutex_unlock(&logger.drain_lock);
+}
+
+int logger_set_verbosity(const char* subsystem, const char* level) {
+    const gint verbosity = priv_parse_level(level);
+    if (0 == verbosity) {
+        return 1;
+    } else if (NULL == subsystem) {
+        g_atomic_int_set(&logger.default_verbosity, verbosity);
+        return 0;
+    }
+
+    const size_t length = MIN(strlen(subsystem), LOG_SUBSYSTEM_SIZE - 1);
+    priv_find_subsystem(subsystem, length, true);
+    const gint count = MIN(g_atomic_int_get(&logger.num_subsystems),
+        LOG_MAXIMUM_SUBSYSTEMS);
+    for (gint i = 0; i < count; ++i) {
+        LogSubsystem* entry = &logger.subsystems[i];
+        if (g_atomic_int_get(&entry->ready)
+            && !strncmp(entry->name, subsystem, length)
+            && '\0' == entry->name[length]) {
+            g_atomic_int_set(&entry->verbosity, verbosity);
+        }
+    }
+    return 0;
+}
+
+void logger_reset_verbosity(void) {
+    g_atomic_int_set(&logger.default_verbosity, logger.initial_verbosity);
+    const gint count = MIN(g_atomic_int_get(&logger.num_subsystems),
+        LOG_MAXIMUM_SUBSYSTEMS);
+    for (gint i = 0; i < count; ++i) {
+        g_atomic_int_set(&logger.subsystems[i].verbosity, 0);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
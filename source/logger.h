@@ -0,0 +1,56 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            logger.h
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Buffered, rate-limited log writer
+//
+// CREATED:         10/18/2026
+//
+// LAST EDITED:     10/18/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+#ifndef LOGGER_H
+#define LOGGER_H
+
+// Replaces the GLib log writer, so that g_info() and friends only format the
+// message into a ring buffer, which a background thread writes out to the
+// journal (or stderr) in batches. The journal gets a batch as datagrams in
+// its native protocol, up to 64 of them per sendmmsg() call, and anything
+// it refuses is written to stderr. Messages are attributed to a subsystem by
+// their "Subsystem: " prefix, or by their GLib log domain. On the way out,
+// repeated messages are collapsed and each subsystem's chatter is rate
+// limited. Warnings are never rate limited, and critical or fatal messages
+// are written synchronously, after whatever is queued.
+//
+// If the ring fills up, new messages are dropped and counted.
+void logger_init(void);
+// Flushes everything queued and reverts to the default GLib writer
+void logger_shutdown(void);
+
+// Level is one of "warning", "message", "info" or "debug". A NULL subsystem
+// sets the default. Returns non-zero if the level is unknown. May be called
+// from any thread.
+int logger_set_verbosity(const char* subsystem, const char* level);
+// Revert every subsystem to the default, and the default to "message" (or
+// "debug" if G_MESSAGES_DEBUG is set).
+void logger_reset_verbosity(void);
+
+#endif // LOGGER_H
+
+///////////////////////////////////////////////////////////////////////////////
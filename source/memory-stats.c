@@ -0,0 +1,129 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            memory-stats.c
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Per-subsystem allocation accounting
+//
+// CREATED:         10/18/2026
+//
+// LAST EDITED:     10/18/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+#include <stdio.h>
+#include <unistd.h>
+
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+#include <glib.h>
+
+#include <memory-stats.h>
+
+typedef struct MemoryCounters {
+    size_t allocations;
+    size_t releases;
+    size_t live_bytes;
+    size_t peak_bytes;
+} MemoryCounters;
+
+static const char* const DOMAIN_NAMES[MEMORY_DOMAIN_COUNT] = {
+    [MEMORY_DOMAIN_WEB] = "web",
+    [MEMORY_DOMAIN_DBUS] = "dbus",
+    [MEMORY_DOMAIN_STATE] = "state",
+};
+
+// Everything that allocates runs on the main loop, so these aren't atomic
+static MemoryCounters counters[MEMORY_DOMAIN_COUNT];
+
+///////////////////////////////////////////////////////////////////////////////
+// Private API
+////
+
+static size_t priv_get_rss() {
+    FILE* statm = fopen("/proc/self/statm", "r");
+    if (NULL == statm) {
+        return 0;
+    }
+
+    unsigned long size = 0;
+    unsigned long resident = 0;
+    const int matched = fscanf(statm, "%lu %lu", &size, &resident);
+    fclose(statm);
+    return 2 == matched ? resident * (size_t)sysconf(_SC_PAGESIZE) : 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Public API
+////
+
+void memory_stats_allocated(enum MemoryDomain domain, size_t bytes) {
+    MemoryCounters* counter = &counters[domain];
+    ++counter->allocations;
+    counter->live_bytes += bytes;
+    if (counter->live_bytes > counter->peak_bytes) {
+        counter->peak_bytes = counter->live_bytes;
+    }
+}
+
+void memory_stats_released(enum MemoryDomain domain, size_t bytes) {
+    MemoryCounters* counter = &counters[domain];
+    ++counter->releases;
+    counter->live_bytes -= MIN(bytes, counter->live_bytes);
+}
+
+void memory_stats_resized(enum MemoryDomain domain, size_t old_bytes,
+    size_t new_bytes)
+{
+    MemoryCounters* counter = &counters[domain];
+    counter->live_bytes -= MIN(old_bytes, counter->live_bytes);
+    counter->live_bytes += new_bytes;
+    if (counter->live_bytes > counter->peak_bytes) {
+        counter->peak_bytes = counter->live_bytes;
+    }
+}
+
+void memory_stats_append_json(GString* buffer) {
+    g_string_append(buffer, "{\"domains\":{");
+    for (int i = 0; i < MEMORY_DOMAIN_COUNT; ++i) {
+        g_string_append_printf(buffer, "%s\"%s\":{\"allocations\":%zu,"
+            "\"releases\":%zu,\"live_bytes\":%zu,\"peak_bytes\":%zu}",
+            0 == i ? "" : ",", DOMAIN_NAMES[i], counters[i].allocations,
+            counters[i].releases, counters[i].live_bytes,
+            counters[i].peak_bytes);
+    }
+    g_string_append(buffer, "}");
+
+#if defined(__GLIBC__) && __GLIBC_PREREQ(2, 33)
+    struct mallinfo2 info = mallinfo2();
+#elif defined(__GLIBC__)
+    // Older glibc only has the int fields, which wrap past 2 GiB
+    struct mallinfo info = mallinfo();
+#endif
+#ifdef __GLIBC__
+    g_string_append_printf(buffer, ",\"heap\":{\"arena_bytes\":%zu,"
+        "\"in_use_bytes\":%zu,\"free_bytes\":%zu,\"mmap_bytes\":%zu}",
+        (size_t)info.arena, (size_t)info.uordblks, (size_t)info.fordblks,
+        (size_t)info.hblkhd);
+#endif
+
+    g_string_append_printf(buffer, ",\"rss_bytes\":%zu}", priv_get_rss());
+}
+
+///////////////////////////////////////////////////////////////////////////////
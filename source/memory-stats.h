@@ -0,0 +1,56 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            memory-stats.h
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Per-subsystem allocation accounting
+//
+// CREATED:         10/18/2026
+//
+// LAST EDITED:     10/18/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+#ifndef MEMORY_STATS_H
+#define MEMORY_STATS_H
+
+#include <stddef.h>
+
+typedef struct _GString GString;
+
+// Subsystems account for the long-lived or per-request allocations they own,
+// so that slow growth can be attributed. These are process-wide counters.
+enum MemoryDomain {
+    MEMORY_DOMAIN_WEB,
+    MEMORY_DOMAIN_DBUS,
+    MEMORY_DOMAIN_STATE,
+    MEMORY_DOMAIN_COUNT,
+};
+
+void memory_stats_allocated(enum MemoryDomain domain, size_t bytes);
+void memory_stats_released(enum MemoryDomain domain, size_t bytes);
+// A block that was resized in place, or moved by realloc()
+void memory_stats_resized(enum MemoryDomain domain, size_t old_bytes,
+    size_t new_bytes);
+
+// Appends a JSON object with the per-domain counters, the heap statistics
+// from the allocator and the resident set size.
+void memory_stats_append_json(GString* buffer);
+
+#endif // MEMORY_STATS_H
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,268 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            mgmt-client.c
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Client for the kernel's Bluetooth management interface
+//
+// CREATED:         10/18/2026
+//
+// LAST EDITED:     10/18/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <glib-unix.h>
+#include <glib.h>
+
+#include <mgmt-client.h>
+
+// From the kernel's include/net/bluetooth/{bluetooth,hci,mgmt}.h. The
+// protocol is little-endian, as are the controllers we run on.
+#ifndef AF_BLUETOOTH
+#define AF_BLUETOOTH 31
+#endif
+static const int BTPROTO_HCI = 1;
+static const uint16_t HCI_DEV_NONE = 0xffff;
+static const uint16_t HCI_CHANNEL_CONTROL = 3;
+
+static const uint16_t MGMT_OP_GET_CONN_INFO = 0x0031;
+static const uint16_t MGMT_EV_CMD_COMPLETE = 0x0001;
+static const uint16_t MGMT_EV_CMD_STATUS = 0x0002;
+
+typedef struct SockaddrHci {
+    sa_family_t family;
+    uint16_t dev;
+    uint16_t channel;
+} SockaddrHci;
+
+typedef struct __attribute__((packed)) MgmtHeader {
+    uint16_t opcode; // <- The event code, for events
+    uint16_t index;
+    uint16_t length;
+} MgmtHeader;
+
+typedef struct __attribute__((packed)) MgmtAddress {
+    uint8_t bdaddr[6]; // <- Least significant byte first
+    uint8_t type;
+} MgmtAddress;
+
+typedef struct __attribute__((packed)) MgmtCommandComplete {
+    uint16_t opcode;
+    uint8_t status;
+} MgmtCommandComplete;
+
+typedef struct __attribute__((packed)) MgmtConnInfoReply {
+    MgmtAddress address;
+    int8_t rssi;
+    int8_t tx_power;
+    int8_t max_tx_power;
+} MgmtConnInfoReply;
+
+typedef struct MgmtRequest {
+    char address[18];
+    enum MgmtAddressType type;
+    MgmtConnectionInfoCallback* callback;
+    void* user_data;
+} MgmtRequest;
+
+typedef struct MgmtClient {
+    int fd;
+    uint16_t index;
+    guint watch_id;
+    // The kernel answers the commands on a socket in the order they were
+    // sent, so replies are matched to the oldest outstanding request.
+    GQueue* requests;
+} MgmtClient;
+
+///////////////////////////////////////////////////////////////////////////////
+// Private API
+////
+
+static bool priv_parse_address(const char* address, uint8_t bdaddr[6]) {
+    unsigned int bytes[6];
+    if (6 != sscanf(address, "%2x:%2x:%2x:%2x:%2x:%2x", &bytes[5], &bytes[4],
+            &bytes[3], &bytes[2], &bytes[1], &bytes[0])) {
+        return false;
+    }
+    for (int i = 0; i < 6; ++i) {
+        bdaddr[i] = (uint8_t)bytes[i];
+    }
+    return true;
+}
+
+static void priv_complete(MgmtClient* client, uint8_t status,
+    const uint8_t* parameters, size_t length)
+{
+    MgmtRequest* request = g_queue_pop_head(client->requests);
+    if (NULL == request) {
+        return;
+    }
+
+    MgmtConnectionInfo info = {0};
+    MgmtConnInfoReply reply;
+    if (MGMT_STATUS_SUCCESS == status && sizeof(reply) <= length) {
+        memcpy(&reply, parameters, sizeof(reply));
+        info.rssi = reply.rssi;
+        info.tx_power = reply.tx_power;
+        info.max_tx_power = reply.max_tx_power;
+    } else if (MGMT_STATUS_SUCCESS == status) {
+        status = 0xff; // <- Truncated, which the kernel never sends
+    }
+
+    request->callback(request->address, request->type, status,
+        MGMT_STATUS_SUCCESS == status ? &info : NULL, request->user_data);
+    g_free(request);
+}
+
+static void priv_handle_event(MgmtClient* client, const uint8_t* data,
+    size_t length)
+{
+    MgmtHeader header;
+    MgmtCommandComplete complete;
+    if (sizeof(header) + sizeof(complete) > length) {
+        return;
+    }
+
+    memcpy(&header, data, sizeof(header));
+    memcpy(&complete, data + sizeof(header), sizeof(complete));
+    if ((MGMT_EV_CMD_COMPLETE != header.opcode
+            && MGMT_EV_CMD_STATUS != header.opcode)
+        || MGMT_OP_GET_CONN_INFO != complete.opcode) {
+        return; // <- Other events are broadcast to every control socket
+    }
+
+    const size_t offset = sizeof(header) + sizeof(complete);
+    priv_complete(client, complete.status, data + offset, length - offset);
+}
+
+static gboolean priv_on_readable(gint fd, GIOCondition condition,
+    gpointer user_data)
+{
+    MgmtClient* client = (MgmtClient*)user_data;
+    uint8_t buffer[512];
+    for (;;) {
+        const ssize_t length = read(fd, buffer, sizeof(buffer));
+        if (0 < length) {
+            priv_handle_event(client, buffer, (size_t)length);
+        } else if (0 > length && EINTR == errno) {
+            continue;
+        } else if (0 > length && EAGAIN == errno) {
+            return G_SOURCE_CONTINUE;
+        } else {
+            g_warning("MgmtClient: Management socket closed");
+            client->watch_id = 0;
+            return G_SOURCE_REMOVE;
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Public API
+////
+
+MgmtClient* mgmt_client_init(const char* adapter) {
+    unsigned int index = 0;
+    char trailing = '\0';
+    if (1 != sscanf(adapter, "hci%u%c", &index, &trailing)
+        || HCI_DEV_NONE <= index) {
+        return NULL;
+    }
+
+    const int fd = socket(AF_BLUETOOTH,
+        SOCK_RAW | SOCK_CLOEXEC | SOCK_NONBLOCK, BTPROTO_HCI);
+    if (0 > fd) {
+        return NULL;
+    }
+
+    SockaddrHci address = { .family = AF_BLUETOOTH, .dev = HCI_DEV_NONE,
+        .channel = HCI_CHANNEL_CONTROL };
+    if (0 != bind(fd, (struct sockaddr*)&address, sizeof(address))) {
+        close(fd);
+        return NULL;
+    }
+
+    MgmtClient* client = malloc(sizeof(MgmtClient));
+    if (NULL == client) {
+        close(fd);
+        return NULL;
+    }
+
+    client->fd = fd;
+    client->index = (uint16_t)index;
+    client->requests = g_queue_new();
+    client->watch_id = g_unix_fd_add(fd, G_IO_IN, priv_on_readable, client);
+    return client;
+}
+
+int mgmt_client_get_connection_info(MgmtClient* client, const char* address,
+    enum MgmtAddressType type, MgmtConnectionInfoCallback* callback,
+    void* user_data)
+{
+    struct __attribute__((packed)) {
+        MgmtHeader header;
+        MgmtAddress address;
+    } command = {
+        .header = { .opcode = MGMT_OP_GET_CONN_INFO, .index = client->index,
+            .length = sizeof(MgmtAddress) },
+        .address = { .type = (uint8_t)type },
+    };
+    if (0 == client->watch_id
+        || !priv_parse_address(address, command.address.bdaddr)) {
+        return 1;
+    }
+
+    ssize_t written = -1;
+    do {
+        written = write(client->fd, &command, sizeof(command));
+    } while (0 > written && EINTR == errno);
+    if (sizeof(command) != written) {
+        g_warning("MgmtClient: Couldn't send command: %s", g_strerror(errno));
+        return 1;
+    }
+
+    MgmtRequest* request = g_new(MgmtRequest, 1);
+    g_strlcpy(request->address, address, sizeof(request->address));
+    request->type = type;
+    request->callback = callback;
+    request->user_data = user_data;
+    g_queue_push_tail(client->requests, request);
+    return 0;
+}
+
+void mgmt_client_free(MgmtClient** client) {
+    if (NULL == *client) {
+        return;
+    }
+
+    if (0 != (*client)->watch_id) {
+        g_source_remove((*client)->watch_id);
+    }
+    g_queue_free_full((*client)->requests, g_free);
+    close((*client)->fd);
+    free(*client);
+    *client = NULL;
+}
+
+///////////////////////////////////////////////////////////////////////////////
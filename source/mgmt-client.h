@@ -0,0 +1,76 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            mgmt-client.h
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Client for the kernel's Bluetooth management interface
+//
+// CREATED:         10/18/2026
+//
+// LAST EDITED:     10/18/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+#ifndef MGMT_CLIENT_H
+#define MGMT_CLIENT_H
+
+#include <stdint.h>
+
+// bluetoothd only reports RSSI from inquiry and advertisements, which stop
+// once a device is connected. The kernel's management interface reads the
+// RSSI of the connection itself from the controller, so that's where link
+// quality comes from. Opening the socket needs CAP_NET_ADMIN.
+typedef struct MgmtClient MgmtClient;
+
+enum MgmtAddressType {
+    MGMT_ADDRESS_BREDR = 0,
+    MGMT_ADDRESS_LE_PUBLIC = 1,
+    MGMT_ADDRESS_LE_RANDOM = 2,
+};
+
+enum {
+    MGMT_STATUS_SUCCESS = 0x00,
+    MGMT_STATUS_NOT_CONNECTED = 0x02,
+};
+
+// The kernel reports 127 for a value the controller couldn't read
+enum { MGMT_VALUE_UNKNOWN = 127 };
+
+typedef struct MgmtConnectionInfo {
+    int8_t rssi;
+    int8_t tx_power;
+    int8_t max_tx_power;
+} MgmtConnectionInfo;
+
+// Called with a MGMT_STATUS_*, and info only on MGMT_STATUS_SUCCESS
+typedef void MgmtConnectionInfoCallback(const char* address,
+    enum MgmtAddressType type, int status, const MgmtConnectionInfo* info,
+    void* user_data);
+
+// Returns NULL if the management socket can't be opened, or the adapter
+// name isn't of the form hciN.
+MgmtClient* mgmt_client_init(const char* adapter);
+// Returns non-zero if the request couldn't be sent. Requests that are
+// outstanding when the client is freed are never answered.
+int mgmt_client_get_connection_info(MgmtClient* client, const char* address,
+    enum MgmtAddressType type, MgmtConnectionInfoCallback* callback,
+    void* user_data);
+void mgmt_client_free(MgmtClient** client);
+
+#endif // MGMT_CLIENT_H
+
+///////////////////////////////////////////////////////////////////////////////
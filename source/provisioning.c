@@ -0,0 +1,592 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            provisioning.c
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Pairing sessions for bulk provisioning against a manifest
+//
+// CREATED:         10/18/2026
+//
+// LAST EDITED:     10/18/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+
+#include <agent-server.h>
+#include <bluez.h>
+#include <bluez-client.h>
+#include <memory-stats.h>
+#include <provisioning.h>
+#include <snapshot.h>
+#include <state.h>
+
+enum { ADDRESS_LENGTH = 17 };
+
+typedef struct ProvisioningSession {
+    char address[ADDRESS_LENGTH + 1];
+    enum ProvisioningPhase phase;
+    const char* failure; // <- Why the session failed, NULL otherwise
+    gint64 entered_at[PROVISIONING_PHASE_COUNT]; // <- Monotonic, 0 if never
+} ProvisioningSession;
+
+typedef struct ProvisioningListener {
+    unsigned int id;
+    void (*changed)(void* user_data);
+    void* user_data;
+} ProvisioningListener;
+
+typedef struct Provisioning {
+    StatePublisher* state_publisher;
+    BluezClient* bluez_client;
+    AgentServer* agent_server;
+    unsigned int devices_listener;
+    GArray* listeners;
+    unsigned int next_listener_id;
+
+    // The batch. Sessions are kept in manifest order, and indexed by
+    // upper-case address. NULL when not provisioning.
+    GPtrArray* sessions;
+    GHashTable* index;
+    gint64 started_at;
+    unsigned int open; // <- Sessions that have neither paired nor failed
+    guint sweep_id;
+} Provisioning;
+
+// Latency is reported for each of these steps
+static const struct {
+    const char* name;
+    enum ProvisioningPhase from;
+    enum ProvisioningPhase to;
+} STEPS[] = {
+    { "discovery", PROVISIONING_WAITING, PROVISIONING_DISCOVERED },
+    { "authorization", PROVISIONING_DISCOVERED, PROVISIONING_AUTHORIZING },
+    { "pairing", PROVISIONING_AUTHORIZING, PROVISIONING_PAIRED },
+    { "connection", PROVISIONING_PAIRED, PROVISIONING_CONNECTED },
+};
+
+static const char* PHASE_NAMES[PROVISIONING_PHASE_COUNT] = {
+    [PROVISIONING_WAITING] = "waiting",
+    [PROVISIONING_DISCOVERED] = "discovered",
+    [PROVISIONING_AUTHORIZING] = "authorizing",
+    [PROVISIONING_PAIRED] = "paired",
+    [PROVISIONING_CONNECTED] = "connected",
+    [PROVISIONING_FAILED] = "failed",
+};
+
+// bluetoothd itself gives up on a pairing well before this
+static const gint64 PAIRING_TIMEOUT_USECONDS = 60 * G_USEC_PER_SEC;
+static const guint SWEEP_INTERVAL_SECONDS = 5;
+
+///////////////////////////////////////////////////////////////////////////////
+// Private API
+////
+
+static void priv_notify(Provisioning* provisioning) {
+    for (guint i = 0; i < provisioning->listeners->len; ++i) {
+        ProvisioningListener* listener = &g_array_index(
+            provisioning->listeners, ProvisioningListener, i);
+        listener->changed(listener->user_data);
+    }
+}
+
+static void priv_session_free(gpointer data) {
+    memory_stats_released(MEMORY_DOMAIN_STATE, sizeof(ProvisioningSession));
+    g_free(data);
+}
+
+static bool priv_is_open(const ProvisioningSession* session)
+{ return PROVISIONING_PAIRED > session->phase; }
+
+static void priv_enter(Provisioning* provisioning,
+    ProvisioningSession* session, enum ProvisioningPhase phase, gint64 now)
+{
+    const bool was_open = priv_is_open(session);
+    session->phase = phase;
+    if (0 == session->entered_at[phase]) {
+        session->entered_at[phase] = now;
+    }
+
+    if (was_open && !priv_is_open(session)) {
+        --provisioning->open;
+    } else if (!was_open && priv_is_open(session)) {
+        ++provisioning->open;
+    }
+}
+
+// Devices are named dev_XX_XX_XX_XX_XX_XX under the adapter
+static bool priv_path_to_address(const char* path,
+    char address[ADDRESS_LENGTH + 1])
+{
+    const char* name = strrchr(path, '/');
+    if (NULL == name || strncmp(name, "/dev_", 5)
+        || ADDRESS_LENGTH != strlen(name + 5)) {
+        return false;
+    }
+
+    for (int i = 0; i < ADDRESS_LENGTH; ++i) {
+        const char c = name[5 + i];
+        address[i] = '_' == c ? ':' : g_ascii_toupper(c);
+    }
+    address[ADDRESS_LENGTH] = '\0';
+    return true;
+}
+
+static bool priv_is_address(const char* address) {
+    if (ADDRESS_LENGTH != strlen(address)) {
+        return false;
+    }
+    for (int i = 0; i < ADDRESS_LENGTH; ++i) {
+        if (2 == i % 3 ? ':' != address[i] : !g_ascii_isxdigit(address[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static int priv_read_manifest(const char* path, GPtrArray* sessions,
+    GHashTable* index)
+{
+    gchar* contents = NULL;
+    GError* error = NULL;
+    if (!g_file_get_contents(path, &contents, NULL, &error)) {
+        g_warning("Provisioning: Couldn't read %s: %s", path,
+            error->message);
+        g_error_free(error);
+        return 1;
+    }
+
+    gchar** lines = g_strsplit(contents, "\n", -1);
+    g_free(contents);
+    int result = 0;
+    for (int i = 0; NULL != lines[i]; ++i) {
+        char* line = g_strstrip(lines[i]);
+        if ('\0' == *line || '#' == *line) {
+            continue;
+        } else if (!priv_is_address(line)) {
+            g_warning("Provisioning: %s:%d: Invalid address", path, i + 1);
+            result = 1;
+            break;
+        }
+
+        ProvisioningSession* session = g_new0(ProvisioningSession, 1);
+        memory_stats_allocated(MEMORY_DOMAIN_STATE,
+            sizeof(ProvisioningSession));
+        for (int j = 0; j < ADDRESS_LENGTH; ++j) {
+            session->address[j] = g_ascii_toupper(line[j]);
+        }
+        if (g_hash_table_contains(index, session->address)) {
+            g_warning("Provisioning: %s:%d: Ignoring duplicate %s", path,
+                i + 1, session->address);
+            priv_session_free(session);
+            continue;
+        }
+        g_ptr_array_add(sessions, session);
+        g_hash_table_insert(index, session->address, session);
+    }
+
+    g_strfreev(lines);
+    return result;
+}
+
+// Discovery is left to the state machine while the agent is pairable
+static void priv_stop_discovery(Provisioning* provisioning) {
+    if (STATE_PAIRABLE != state_get(provisioning->state_publisher)) {
+        bluez_client_stop_discovery(provisioning->bluez_client);
+    }
+}
+
+static unsigned int priv_count_paired(Provisioning* provisioning,
+    gint64* last_paired_at)
+{
+    unsigned int paired = 0;
+    *last_paired_at = provisioning->started_at;
+    for (guint i = 0; i < provisioning->sessions->len; ++i) {
+        ProvisioningSession* session = g_ptr_array_index(
+            provisioning->sessions, i);
+        const gint64 paired_at = session->entered_at[PROVISIONING_PAIRED];
+        if (0 != paired_at) {
+            ++paired;
+            *last_paired_at = MAX(*last_paired_at, paired_at);
+        }
+    }
+    return paired;
+}
+
+static double priv_per_minute(Provisioning* provisioning,
+    unsigned int paired, gint64 last_paired_at)
+{
+    const gint64 elapsed = last_paired_at - provisioning->started_at;
+    return 0 < elapsed ? paired * 60.0 * G_USEC_PER_SEC / elapsed : 0;
+}
+
+// Mean and maximum in microseconds, over the sessions that went through both
+// phases of the step. Returns the number of such sessions.
+static unsigned int priv_step_latency(Provisioning* provisioning,
+    size_t step, gint64* mean, gint64* maximum)
+{
+    unsigned int count = 0;
+    gint64 total = 0;
+    *maximum = 0;
+    for (guint i = 0; i < provisioning->sessions->len; ++i) {
+        ProvisioningSession* session = g_ptr_array_index(
+            provisioning->sessions, i);
+        const gint64 from = session->entered_at[STEPS[step].from];
+        const gint64 to = session->entered_at[STEPS[step].to];
+        if (0 != from && 0 != to) {
+            ++count;
+            total += to - from;
+            *maximum = MAX(*maximum, to - from);
+        }
+    }
+    *mean = 0 != count ? total / count : 0;
+    return count;
+}
+
+static void priv_finish(Provisioning* provisioning) {
+    if (0 != provisioning->sweep_id) {
+        g_source_remove(provisioning->sweep_id);
+        provisioning->sweep_id = 0;
+    }
+    priv_stop_discovery(provisioning);
+
+    gint64 last_paired_at = 0;
+    const unsigned int paired = priv_count_paired(provisioning,
+        &last_paired_at);
+    g_info("Provisioning: %u of %u devices paired in %.1f s (%.1f per "
+        "minute)", paired, provisioning->sessions->len,
+        (last_paired_at - provisioning->started_at) / (double)G_USEC_PER_SEC,
+        priv_per_minute(provisioning, paired, last_paired_at));
+    for (size_t i = 0; i < G_N_ELEMENTS(STEPS); ++i) {
+        gint64 mean = 0, maximum = 0;
+        if (0 != priv_step_latency(provisioning, i, &mean, &maximum)) {
+            g_info("Provisioning: %s took %.1f ms on average, %.1f ms at "
+                "most", STEPS[i].name, mean / 1000.0, maximum / 1000.0);
+        }
+    }
+}
+
+static void priv_on_devices_changed(void* user_data) {
+    Provisioning* provisioning = (Provisioning*)user_data;
+    if (NULL == provisioning->sessions) {
+        return;
+    }
+
+    const unsigned int was_open = provisioning->open;
+    const gint64 now = g_get_monotonic_time();
+    bool changed = false;
+    for (guint i = 0; i < provisioning->sessions->len; ++i) {
+        ProvisioningSession* session = g_ptr_array_index(
+            provisioning->sessions, i);
+        Device1* device = NULL;
+        if (PROVISIONING_CONNECTED == session->phase
+            || NULL == (device = bluez_client_get_device(
+                    provisioning->bluez_client, session->address))) {
+            continue;
+        }
+
+        enum ProvisioningPhase phase = PROVISIONING_DISCOVERED;
+        if (device1_get_paired(device)) {
+            phase = device1_get_connected(device) ? PROVISIONING_CONNECTED
+                : PROVISIONING_PAIRED;
+        }
+
+        // A pairing that finishes after the session timed out still counts
+        if (PROVISIONING_FAILED == session->phase
+            && PROVISIONING_PAIRED <= phase) {
+            session->failure = NULL;
+            session->entered_at[PROVISIONING_FAILED] = 0;
+            priv_enter(provisioning, session, phase, now);
+            changed = true;
+        } else if (PROVISIONING_FAILED != session->phase
+            && session->phase < phase) {
+            priv_enter(provisioning, session, phase, now);
+            changed = true;
+        }
+    }
+
+    if (changed) {
+        priv_notify(provisioning);
+    }
+    if (0 != was_open && 0 == provisioning->open) {
+        priv_finish(provisioning);
+    }
+}
+
+static gboolean priv_on_sweep(gpointer user_data) {
+    Provisioning* provisioning = (Provisioning*)user_data;
+    const gint64 now = g_get_monotonic_time();
+    bool changed = false;
+    for (guint i = 0; i < provisioning->sessions->len; ++i) {
+        ProvisioningSession* session = g_ptr_array_index(
+            provisioning->sessions, i);
+        if (PROVISIONING_AUTHORIZING == session->phase
+            && PAIRING_TIMEOUT_USECONDS < now
+            - session->entered_at[PROVISIONING_AUTHORIZING]) {
+            g_info("Provisioning: Pairing %s timed out", session->address);
+            session->failure = "Pairing timed out";
+            priv_enter(provisioning, session, PROVISIONING_FAILED, now);
+            changed = true;
+        }
+    }
+
+    if (changed) {
+        priv_notify(provisioning);
+    }
+    if (0 == provisioning->open) {
+        provisioning->sweep_id = 0;
+        priv_finish(provisioning);
+        return G_SOURCE_REMOVE;
+    }
+    return G_SOURCE_CONTINUE;
+}
+
+static bool priv_authorize(const object_path* device, const char* method,
+    void* user_data)
+{
+    Provisioning* provisioning = (Provisioning*)user_data;
+    char address[ADDRESS_LENGTH + 1];
+    ProvisioningSession* session = NULL;
+    if (NULL == provisioning->index
+        || !priv_path_to_address(device, address)
+        || NULL == (session = g_hash_table_lookup(provisioning->index,
+                address))) {
+        return false;
+    }
+
+    // Once the batch is done, and for devices that have already paired,
+    // requests go through the usual admission and pairing mode.
+    if (0 == provisioning->open || PROVISIONING_PAIRED == session->phase
+        || PROVISIONING_CONNECTED == session->phase) {
+        return false;
+    }
+
+    const gint64 now = g_get_monotonic_time();
+    if (PROVISIONING_FAILED == session->phase) {
+        // The device is trying again, so the session starts over
+        session->failure = NULL;
+        session->entered_at[PROVISIONING_FAILED] = 0;
+        session->entered_at[PROVISIONING_AUTHORIZING] = 0;
+        if (0 == provisioning->sweep_id) {
+            provisioning->sweep_id = g_timeout_add_seconds(
+                SWEEP_INTERVAL_SECONDS, priv_on_sweep, provisioning);
+        }
+    } else if (PROVISIONING_AUTHORIZING == session->phase) {
+        return true;
+    }
+
+    priv_enter(provisioning, session, PROVISIONING_AUTHORIZING, now);
+    priv_notify(provisioning);
+    return true;
+}
+
+static void priv_clear(Provisioning* provisioning) {
+    if (NULL == provisioning->sessions) {
+        return;
+    }
+
+    if (0 != provisioning->open) {
+        priv_stop_discovery(provisioning);
+    }
+    if (0 != provisioning->sweep_id) {
+        g_source_remove(provisioning->sweep_id);
+        provisioning->sweep_id = 0;
+    }
+    g_clear_pointer(&provisioning->index, g_hash_table_unref);
+    g_clear_pointer(&provisioning->sessions, g_ptr_array_unref);
+    provisioning->open = 0;
+}
+
+static void priv_append_time(GString* buffer, const char* name,
+    gint64 time, gint64 started_at)
+{
+    if (0 == time) {
+        g_string_append_printf(buffer, ",\"%s\":null", name);
+    } else {
+        g_string_append_printf(buffer, ",\"%s\":%.1f", name,
+            (time - started_at) / 1000.0);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Public API
+////
+
+Provisioning* provisioning_init(StatePublisher* state_publisher,
+    BluezClient* bluez_client, AgentServer* agent_server)
+{
+    Provisioning* provisioning = calloc(1, sizeof(Provisioning));
+    if (NULL == provisioning) {
+        return NULL;
+    }
+
+    state_ref(state_publisher);
+    provisioning->state_publisher = state_publisher;
+    provisioning->bluez_client = bluez_client;
+    provisioning->agent_server = agent_server;
+    provisioning->listeners = g_array_new(FALSE, FALSE,
+        sizeof(ProvisioningListener));
+    provisioning->next_listener_id = 1;
+    provisioning->devices_listener = bluez_client_add_devices_listener(
+        bluez_client, priv_on_devices_changed, provisioning);
+    agent_server_set_authorizer(agent_server, priv_authorize, provisioning);
+    return provisioning;
+}
+
+int provisioning_load_manifest(Provisioning* provisioning, const char* path)
+{
+    if (NULL == path) {
+        if (NULL != provisioning->sessions) {
+            g_info("Provisioning: Stopped");
+            priv_clear(provisioning);
+            priv_notify(provisioning);
+        }
+        return 0;
+    }
+
+    GPtrArray* sessions = g_ptr_array_new_with_free_func(priv_session_free);
+    GHashTable* index = g_hash_table_new(g_str_hash, g_str_equal);
+    if (0 != priv_read_manifest(path, sessions, index)) {
+        g_hash_table_unref(index);
+        g_ptr_array_unref(sessions);
+        return 1;
+    }
+
+    priv_clear(provisioning);
+    provisioning->sessions = sessions;
+    provisioning->index = index;
+    provisioning->started_at = g_get_monotonic_time();
+    provisioning->open = sessions->len;
+    for (guint i = 0; i < sessions->len; ++i) {
+        ProvisioningSession* session = g_ptr_array_index(sessions, i);
+        session->entered_at[PROVISIONING_WAITING] = provisioning->started_at;
+    }
+    g_info("Provisioning: Batch of %u devices from %s", sessions->len, path);
+
+    if (0 != sessions->len) {
+        bluez_client_start_discovery(provisioning->bluez_client);
+        provisioning->sweep_id = g_timeout_add_seconds(SWEEP_INTERVAL_SECONDS,
+            priv_on_sweep, provisioning);
+    }
+
+    // Some of the devices may be known already
+    priv_on_devices_changed(provisioning);
+    priv_notify(provisioning);
+    return 0;
+}
+
+bool provisioning_is_active(Provisioning* provisioning)
+{ return NULL != provisioning->sessions; }
+
+void provisioning_append_json(Provisioning* provisioning, GString* buffer) {
+    if (NULL == provisioning->sessions) {
+        g_string_append(buffer, "{\"active\":false}");
+        return;
+    }
+
+    gint64 last_paired_at = 0;
+    const unsigned int paired = priv_count_paired(provisioning,
+        &last_paired_at);
+    unsigned int failed = 0;
+    for (guint i = 0; i < provisioning->sessions->len; ++i) {
+        ProvisioningSession* session = g_ptr_array_index(
+            provisioning->sessions, i);
+        failed += PROVISIONING_FAILED == session->phase;
+    }
+
+    g_string_append_printf(buffer, "{\"active\":true,\"devices\":%u"
+        ",\"paired\":%u,\"failed\":%u,\"paired_per_minute\":%.2f"
+        ",\"latency_ms\":{", provisioning->sessions->len, paired, failed,
+        priv_per_minute(provisioning, paired, last_paired_at));
+    for (size_t i = 0; i < G_N_ELEMENTS(STEPS); ++i) {
+        gint64 mean = 0, maximum = 0;
+        const unsigned int count = priv_step_latency(provisioning, i, &mean,
+            &maximum);
+        g_string_append_printf(buffer, "%s\"%s\":{\"count\":%u"
+            ",\"mean\":%.1f,\"max\":%.1f}", 0 != i ? "," : "", STEPS[i].name,
+            count, mean / 1000.0, maximum / 1000.0);
+    }
+
+    g_string_append(buffer, "},\"sessions\":[");
+    for (guint i = 0; i < provisioning->sessions->len; ++i) {
+        ProvisioningSession* session = g_ptr_array_index(
+            provisioning->sessions, i);
+        g_string_append(buffer, 0 != i ? ",{\"address\":" : "{\"address\":");
+        snapshot_append_json_string(buffer, session->address);
+        g_string_append(buffer, ",\"phase\":");
+        snapshot_append_json_string(buffer, PHASE_NAMES[session->phase]);
+        if (NULL != session->failure) {
+            g_string_append(buffer, ",\"failure\":");
+            snapshot_append_json_string(buffer, session->failure);
+        } else {
+            g_string_append(buffer, ",\"failure\":null");
+        }
+        for (int phase = PROVISIONING_DISCOVERED;
+             phase < PROVISIONING_PHASE_COUNT; ++phase) {
+            char name[32];
+            g_snprintf(name, sizeof(name), "%s_ms", PHASE_NAMES[phase]);
+            priv_append_time(buffer, name, session->entered_at[phase],
+                provisioning->started_at);
+        }
+        g_string_append_c(buffer, '}');
+    }
+    g_string_append(buffer, "]}");
+}
+
+unsigned int provisioning_add_listener(Provisioning* provisioning,
+    void (*changed)(void* user_data), void* user_data)
+{
+    ProvisioningListener listener = {
+        .id = provisioning->next_listener_id++,
+        .changed = changed,
+        .user_data = user_data,
+    };
+    g_array_append_val(provisioning->listeners, listener);
+    return listener.id;
+}
+
+void provisioning_remove_listener(Provisioning* provisioning,
+    unsigned int id)
+{
+    for (guint i = 0; i < provisioning->listeners->len; ++i) {
+        if (id == g_array_index(provisioning->listeners,
+                ProvisioningListener, i).id) {
+            g_array_remove_index(provisioning->listeners, i);
+            return;
+        }
+    }
+}
+
+void provisioning_free(Provisioning** provisioning) {
+    if (NULL == *provisioning) {
+        return;
+    }
+
+    agent_server_set_authorizer((*provisioning)->agent_server, NULL, NULL);
+    bluez_client_remove_devices_listener((*provisioning)->bluez_client,
+        (*provisioning)->devices_listener);
+    priv_clear(*provisioning);
+    g_array_unref((*provisioning)->listeners);
+    state_deref(&(*provisioning)->state_publisher);
+    free(*provisioning);
+    *provisioning = NULL;
+}
+
+///////////////////////////////////////////////////////////////////////////////
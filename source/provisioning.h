@@ -0,0 +1,82 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            provisioning.h
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Pairing sessions for bulk provisioning against a manifest
+//
+// CREATED:         10/18/2026
+//
+// LAST EDITED:     10/18/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+#ifndef PROVISIONING_H
+#define PROVISIONING_H
+
+#include <stdbool.h>
+
+typedef struct AgentServer AgentServer;
+typedef struct BluezClient BluezClient;
+typedef struct StatePublisher StatePublisher;
+typedef struct _GString GString;
+
+// Phases of a pairing session, in the order they're normally entered
+enum ProvisioningPhase {
+    PROVISIONING_WAITING,     // <- Listed in the manifest, not seen yet
+    PROVISIONING_DISCOVERED,  // <- Known to bluetoothd
+    PROVISIONING_AUTHORIZING, // <- The agent approved a request
+    PROVISIONING_PAIRED,
+    PROVISIONING_CONNECTED,
+    PROVISIONING_FAILED,
+    PROVISIONING_PHASE_COUNT, // <- Not a phase, must be last
+};
+
+// Provisioning mode pairs a batch of devices at once, independently of the
+// agent's state. The batch is a manifest file with one device address per
+// line (blank lines and lines starting with '#' are ignored). While the batch
+// is open, agent requests from listed devices that haven't paired yet (or are
+// retrying after a failure) are approved straight away, while other requests
+// are handled as usual. Each listed device has a session of its own, which
+// records when each phase was entered, and fails if pairing doesn't finish
+// in time after the request was approved. Discovery runs until every device
+// in the batch has paired or failed, and the throughput is logged then.
+typedef struct Provisioning Provisioning;
+
+Provisioning* provisioning_init(StatePublisher* state_publisher,
+    BluezClient* bluez_client, AgentServer* agent_server);
+// Starts a new batch from the manifest at path, or ends provisioning mode if
+// path is NULL. Returns non-zero, keeping the current batch, if the manifest
+// can't be read or lists an invalid address.
+int provisioning_load_manifest(Provisioning* provisioning, const char* path);
+bool provisioning_is_active(Provisioning* provisioning);
+// Appends the sessions, devices paired per minute and the mean and maximum
+// latency of each phase, as JSON. Session times are in milliseconds since the
+// batch started, and only change along with the sessions.
+void provisioning_append_json(Provisioning* provisioning, GString* buffer);
+
+// Invoked whenever a session changes phase, or the batch is replaced.
+// Returns a listener id, which is never zero.
+unsigned int provisioning_add_listener(Provisioning* provisioning,
+    void (*changed)(void* user_data), void* user_data);
+void provisioning_remove_listener(Provisioning* provisioning,
+    unsigned int id);
+void provisioning_free(Provisioning** provisioning);
+
+#endif // PROVISIONING_H
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,169 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            rate-limiter.c
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Token bucket rate limiting, keyed by client
+//
+// CREATED:         10/18/2026
+//
+// LAST EDITED:     10/18/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+#include <stdlib.h>
+
+#include <glib.h>
+
+#include <memory-stats.h>
+#include <rate-limiter.h>
+
+typedef struct RateBucket {
+    double tokens;
+    gint64 updated; // <- Monotonic, microseconds
+    enum MemoryDomain domain;
+} RateBucket;
+
+typedef struct RateLimiter {
+    enum MemoryDomain domain;
+    double rate;
+    double burst;
+    unsigned int maximum_keys;
+    GHashTable* buckets;
+} RateLimiter;
+
+///////////////////////////////////////////////////////////////////////////////
+// Private API
+////
+
+static void priv_refill(RateLimiter* limiter, RateBucket* bucket, gint64 now)
+{
+    const double elapsed = (double)(now - bucket->updated)
+        / G_TIME_SPAN_SECOND;
+    bucket->tokens = MIN(limiter->burst, bucket->tokens
+        + elapsed * limiter->rate);
+    bucket->updated = now;
+}
+
+static void priv_bucket_free(gpointer data) {
+    memory_stats_released(((RateBucket*)data)->domain, sizeof(RateBucket));
+    g_free(data);
+}
+
+// A full bucket holds no more information than a missing one
+static gboolean priv_is_full(gpointer key, gpointer value, gpointer user_data)
+{
+    RateLimiter* limiter = (RateLimiter*)user_data;
+    RateBucket* bucket = (RateBucket*)value;
+    priv_refill(limiter, bucket, g_get_monotonic_time());
+    return bucket->tokens >= limiter->burst;
+}
+
+static void priv_make_room(RateLimiter* limiter) {
+    g_hash_table_foreach_remove(limiter->buckets, priv_is_full, limiter);
+    if (g_hash_table_size(limiter->buckets) < limiter->maximum_keys) {
+        return;
+    }
+
+    GHashTableIter iter;
+    gpointer key = NULL;
+    gpointer value = NULL;
+    gpointer oldest_key = NULL;
+    gint64 oldest = G_MAXINT64;
+    g_hash_table_iter_init(&iter, limiter->buckets);
+    while (g_hash_table_iter_next(&iter, &key, &value)) {
+        if (((RateBucket*)value)->updated < oldest) {
+            oldest = ((RateBucket*)value)->updated;
+            oldest_key = key;
+        }
+    }
+    g_hash_table_remove(limiter->buckets, oldest_key);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Public API
+////
+
+RateLimiter* rate_limiter_init(enum MemoryDomain domain, double rate,
+    double burst, unsigned int maximum_keys)
+{
+    RateLimiter* limiter = malloc(sizeof(RateLimiter));
+    if (NULL == limiter) {
+        return NULL;
+    }
+
+    limiter->domain = domain;
+    limiter->rate = rate;
+    limiter->burst = MAX(1.0, burst);
+    limiter->maximum_keys = MAX(1, maximum_keys);
+    limiter->buckets = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+        priv_bucket_free);
+    return limiter;
+}
+
+void rate_limiter_set_rate(RateLimiter* limiter, double rate, double burst) {
+    limiter->rate = rate;
+    limiter->burst = MAX(1.0, burst);
+}
+
+bool rate_limiter_allow(RateLimiter* limiter, const char* key,
+    unsigned int* retry_after)
+{
+    const gint64 now = g_get_monotonic_time();
+    RateBucket* bucket = g_hash_table_lookup(limiter->buckets, key);
+    if (NULL == bucket) {
+        if (g_hash_table_size(limiter->buckets) >= limiter->maximum_keys) {
+            priv_make_room(limiter);
+        }
+
+        bucket = g_new(RateBucket, 1);
+        memory_stats_allocated(limiter->domain, sizeof(RateBucket));
+        bucket->domain = limiter->domain;
+        bucket->tokens = limiter->burst;
+        bucket->updated = now;
+        g_hash_table_insert(limiter->buckets, g_strdup(key), bucket);
+    } else {
+        priv_refill(limiter, bucket, now);
+    }
+
+    if (bucket->tokens >= 1.0) {
+        bucket->tokens -= 1.0;
+        return true;
+    }
+
+    if (NULL != retry_after) {
+        const double wait = 0 < limiter->rate
+            ? (1.0 - bucket->tokens) / limiter->rate : 60.0;
+        *retry_after = (unsigned int)wait;
+        if (*retry_after < wait) {
+            ++*retry_after;
+        }
+    }
+    return false;
+}
+
+void rate_limiter_free(RateLimiter** limiter) {
+    if (NULL == *limiter) {
+        return;
+    }
+
+    g_hash_table_unref((*limiter)->buckets);
+    free(*limiter);
+    *limiter = NULL;
+}
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,53 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            rate-limiter.h
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Token bucket rate limiting, keyed by client
+//
+// CREATED:         10/18/2026
+//
+// LAST EDITED:     10/18/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+#ifndef RATE_LIMITER_H
+#define RATE_LIMITER_H
+
+#include <stdbool.h>
+
+#include <memory-stats.h>
+
+// One token bucket per key (a client address, a device path). Buckets refill
+// at rate tokens per second up to burst, and each allowed event takes one.
+// The number of buckets is bounded: when the table is full, buckets that have
+// refilled completely are dropped, and failing that the least recently used.
+typedef struct RateLimiter RateLimiter;
+
+RateLimiter* rate_limiter_init(enum MemoryDomain domain, double rate,
+    double burst, unsigned int maximum_keys);
+void rate_limiter_set_rate(RateLimiter* limiter, double rate, double burst);
+// Returns true, and takes a token, if the event is allowed. Otherwise, if
+// retry_after is non-NULL, it receives the seconds until a token is
+// available.
+bool rate_limiter_allow(RateLimiter* limiter, const char* key,
+    unsigned int* retry_after);
+void rate_limiter_free(RateLimiter** limiter);
+
+#endif // RATE_LIMITER_H
+
+///////////////////////////////////////////////////////////////////////////////
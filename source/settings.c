@@ -0,0 +1,469 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            settings.c
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Runtime configuration, loaded from a key file
+//
+// CREATED:         10/18/2026
+//
+// LAST EDITED:     10/18/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+
+#include <config.h>
+#include <settings.h>
+
+static const char* const AGENT_CAPABILITIES[] = {
+    "DisplayOnly",
+    "DisplayYesNo",
+    "KeyboardOnly",
+    "NoInputNoOutput",
+    "KeyboardDisplay",
+};
+
+static const char* const DISCOVERY_TRANSPORTS[] = { "auto", "bredr", "le" };
+
+static const char* const LOG_LEVELS[] = {
+    "warning",
+    "message",
+    "info",
+    "debug",
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Private API
+////
+
+static bool priv_str_equal(const char* first, const char* second) {
+    if (NULL == first || NULL == second) {
+        return first == second;
+    }
+    return 0 == strcmp(first, second);
+}
+
+static int priv_get_string(GKeyFile* key_file, const char* group,
+    const char* key, char** value)
+{
+    if (!g_key_file_has_key(key_file, group, key, NULL)) {
+        return 0;
+    }
+
+    GError* error = NULL;
+    char* string = g_key_file_get_string(key_file, group, key, &error);
+    if (NULL != error) {
+        g_warning("Settings: [%s] %s: %s", group, key, error->message);
+        g_error_free(error);
+        return 1;
+    }
+
+    g_strstrip(string);
+    g_free(*value);
+    if ('\0' == *string) {
+        g_free(string);
+        string = NULL;
+    }
+    *value = string;
+    return 0;
+}
+
+static bool priv_strv_equal(char** first, char** second) {
+    if (NULL == first || NULL == second) {
+        return first == second;
+    }
+
+    for (; NULL != *first && NULL != *second; ++first, ++second) {
+        if (strcmp(*first, *second)) {
+            return false;
+        }
+    }
+    return *first == *second;
+}
+
+static bool priv_is_one_of(const char* value, const char* const* options,
+    size_t num_options)
+{
+    for (size_t i = 0; i < num_options; ++i) {
+        if (priv_str_equal(value, options[i])) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static int priv_get_string_list(GKeyFile* key_file, const char* group,
+    const char* key, char*** value)
+{
+    if (!g_key_file_has_key(key_file, group, key, NULL)) {
+        return 0;
+    }
+
+    GError* error = NULL;
+    char** list = g_key_file_get_string_list(key_file, group, key, NULL,
+        &error);
+    if (NULL != error) {
+        g_warning("Settings: [%s] %s: %s", group, key, error->message);
+        g_error_free(error);
+        return 1;
+    }
+
+    g_strfreev(*value);
+    *value = NULL;
+    if (NULL != list && NULL != list[0]) {
+        *value = list;
+    } else {
+        g_strfreev(list);
+    }
+    return 0;
+}
+
+// Every key in the group, as "key=value"
+static int priv_get_group(GKeyFile* key_file, const char* group,
+    char*** value)
+{
+    if (!g_key_file_has_group(key_file, group)) {
+        return 0;
+    }
+
+    gsize num_keys = 0;
+    char** keys = g_key_file_get_keys(key_file, group, &num_keys, NULL);
+    char** entries = g_new0(char*, num_keys + 1);
+    for (gsize i = 0; i < num_keys; ++i) {
+        char* entry_value = g_key_file_get_value(key_file, group, keys[i],
+            NULL);
+        entries[i] = g_strdup_printf("%s=%s", keys[i],
+            g_strstrip(entry_value));
+        g_free(entry_value);
+    }
+    g_strfreev(keys);
+
+    g_strfreev(*value);
+    *value = entries;
+    return 0;
+}
+
+static int priv_get_int(GKeyFile* key_file, const char* group,
+    const char* key, int minimum, int maximum, int* value)
+{
+    if (!g_key_file_has_key(key_file, group, key, NULL)) {
+        return 0;
+    }
+
+    GError* error = NULL;
+    gint integer = g_key_file_get_integer(key_file, group, key, &error);
+    if (NULL != error) {
+        g_warning("Settings: [%s] %s: %s", group, key, error->message);
+        g_error_free(error);
+        return 1;
+    }
+
+    if (integer < minimum || integer > maximum) {
+        g_warning("Settings: [%s] %s: %d is out of range [%d, %d]", group,
+            key, integer, minimum, maximum);
+        return 1;
+    }
+
+    *value = integer;
+    return 0;
+}
+
+static int priv_get_uint(GKeyFile* key_file, const char* group,
+    const char* key, unsigned int minimum, unsigned int maximum,
+    unsigned int* value)
+{
+    if (!g_key_file_has_key(key_file, group, key, NULL)) {
+        return 0;
+    }
+
+    GError* error = NULL;
+    gint integer = g_key_file_get_integer(key_file, group, key, &error);
+    if (NULL != error) {
+        g_warning("Settings: [%s] %s: %s", group, key, error->message);
+        g_error_free(error);
+        return 1;
+    }
+
+    if (integer < 0 || (unsigned int)integer < minimum
+        || (unsigned int)integer > maximum) {
+        g_warning("Settings: [%s] %s: %d is out of range [%u, %u]", group,
+            key, integer, minimum, maximum);
+        return 1;
+    }
+
+    *value = (unsigned int)integer;
+    return 0;
+}
+
+static int priv_get_bool(GKeyFile* key_file, const char* group,
+    const char* key, bool* value)
+{
+    if (!g_key_file_has_key(key_file, group, key, NULL)) {
+        return 0;
+    }
+
+    GError* error = NULL;
+    gboolean boolean = g_key_file_get_boolean(key_file, group, key, &error);
+    if (NULL != error) {
+        g_warning("Settings: [%s] %s: %s", group, key, error->message);
+        g_error_free(error);
+        return 1;
+    }
+
+    *value = boolean;
+    return 0;
+}
+
+static int priv_validate(const Settings* settings) {
+    // bluetoothd would reject an unknown capability only when we re-register,
+    // which is too late to keep the previous one.
+    if (!priv_is_one_of(settings->capability, AGENT_CAPABILITIES,
+            G_N_ELEMENTS(AGENT_CAPABILITIES))) {
+        g_warning("Settings: Unknown agent capability %s",
+            NULL != settings->capability ? settings->capability : "(none)");
+        return 1;
+    }
+
+    if (NULL != settings->discovery_transport
+        && !priv_is_one_of(settings->discovery_transport,
+            DISCOVERY_TRANSPORTS, G_N_ELEMENTS(DISCOVERY_TRANSPORTS))) {
+        g_warning("Settings: Unknown discovery transport %s",
+            settings->discovery_transport);
+        return 1;
+    }
+
+    if (NULL == settings->adapter || NULL == settings->webroot
+        || NULL == settings->control_socket) {
+        g_warning("Settings: Adapter, Webroot and Socket can't be empty");
+        return 1;
+    }
+
+    for (char** entry = settings->log_verbosity;
+         NULL != entry && NULL != *entry; ++entry) {
+        const char* level = strchr(*entry, '=');
+        if (NULL == level || !priv_is_one_of(level + 1, LOG_LEVELS,
+                G_N_ELEMENTS(LOG_LEVELS))) {
+            g_warning("Settings: Unknown log level in [Logging] %s", *entry);
+            return 1;
+        }
+    }
+
+    if ((NULL == settings->web_certificate)
+        != (NULL == settings->web_private_key)) {
+        g_warning("Settings: Certificate and PrivateKey go together");
+        return 1;
+    }
+    return 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Public API
+////
+
+Settings* settings_init() {
+    Settings* settings = malloc(sizeof(Settings));
+    if (NULL == settings) {
+        return NULL;
+    }
+
+    settings->adapter = g_strdup("hci0");
+    settings->capability = g_strdup(CONFIG_AGENT_CAPABILITY);
+    settings->idle_exit_minutes = 0;
+    settings->webroot = g_strdup(CONFIG_WEBROOT_PATH);
+    settings->web_address = NULL;
+    settings->web_port = CONFIG_WEB_SERVER_PORT;
+    settings->lan_read_only = false;
+    settings->web_request_rate = 10;
+    settings->web_request_burst = 30;
+    settings->web_max_concurrent = 32;
+    settings->web_certificate = NULL;
+    settings->web_private_key = NULL;
+    settings->control_socket = g_strdup(CONFIG_CONTROL_SOCKET_PATH);
+    settings->discovery_transport = g_strdup("auto");
+    settings->discovery_rssi_floor = -90;
+    settings->discovery_uuids = NULL;
+    settings->provisioning_manifest = NULL;
+    settings->log_verbosity = NULL;
+    return settings;
+}
+
+Settings* settings_copy(const Settings* settings) {
+    Settings* copy = malloc(sizeof(Settings));
+    if (NULL == copy) {
+        return NULL;
+    }
+
+    *copy = *settings;
+    copy->adapter = g_strdup(settings->adapter);
+    copy->capability = g_strdup(settings->capability);
+    copy->webroot = g_strdup(settings->webroot);
+    copy->web_address = g_strdup(settings->web_address);
+    copy->web_certificate = g_strdup(settings->web_certificate);
+    copy->web_private_key = g_strdup(settings->web_private_key);
+    copy->control_socket = g_strdup(settings->control_socket);
+    copy->discovery_transport = g_strdup(settings->discovery_transport);
+    copy->discovery_uuids = g_strdupv(settings->discovery_uuids);
+    copy->provisioning_manifest = g_strdup(settings->provisioning_manifest);
+    copy->log_verbosity = g_strdupv(settings->log_verbosity);
+    return copy;
+}
+
+int settings_load(Settings* settings, const char* path) {
+    GKeyFile* key_file = g_key_file_new();
+    GError* error = NULL;
+    if (!g_key_file_load_from_file(key_file, path, G_KEY_FILE_NONE, &error)) {
+        const bool missing = g_error_matches(error, G_FILE_ERROR,
+            G_FILE_ERROR_NOENT);
+        if (!missing) {
+            g_warning("Settings: Couldn't load %s: %s", path, error->message);
+        }
+        g_error_free(error);
+        g_key_file_free(key_file);
+        return missing ? 0 : 1;
+    }
+
+    // Parse into a copy, so that a bad file leaves everything as it was
+    Settings* loaded = settings_copy(settings);
+    int result = 0;
+    result |= priv_get_string(key_file, "Agent", "Adapter", &loaded->adapter);
+    result |= priv_get_string(key_file, "Agent", "Capability",
+        &loaded->capability);
+    result |= priv_get_uint(key_file, "Agent", "IdleExitMinutes", 0,
+        24 * 60, &loaded->idle_exit_minutes);
+    result |= priv_get_string(key_file, "Web", "Address",
+        &loaded->web_address);
+    result |= priv_get_uint(key_file, "Web", "Port", 1, 65535,
+        &loaded->web_port);
+    result |= priv_get_bool(key_file, "Web", "ReadOnlyLan",
+        &loaded->lan_read_only);
+    result |= priv_get_uint(key_file, "Web", "RequestRate", 0, 10000,
+        &loaded->web_request_rate);
+    result |= priv_get_uint(key_file, "Web", "RequestBurst", 1, 10000,
+        &loaded->web_request_burst);
+    result |= priv_get_uint(key_file, "Web", "MaxConcurrent", 0, 10000,
+        &loaded->web_max_concurrent);
+    result |= priv_get_string(key_file, "Web", "Certificate",
+        &loaded->web_certificate);
+    result |= priv_get_string(key_file, "Web", "PrivateKey",
+        &loaded->web_private_key);
+    result |= priv_get_string(key_file, "Web", "Webroot", &loaded->webroot);
+    result |= priv_get_string(key_file, "Control", "Socket",
+        &loaded->control_socket);
+    result |= priv_get_string(key_file, "Discovery", "Transport",
+        &loaded->discovery_transport);
+    result |= priv_get_int(key_file, "Discovery", "RSSIFloor", -127, 0,
+        &loaded->discovery_rssi_floor);
+    result |= priv_get_string_list(key_file, "Discovery", "UUIDs",
+        &loaded->discovery_uuids);
+    result |= priv_get_string(key_file, "Provisioning", "Manifest",
+        &loaded->provisioning_manifest);
+    result |= priv_get_group(key_file, "Logging", &loaded->log_verbosity);
+    g_key_file_free(key_file);
+    if (0 == result) {
+        result = priv_validate(loaded);
+    }
+
+    if (0 != result) {
+        settings_free(&loaded);
+        return result;
+    }
+
+    // Swap the contents, and free the old values along with the copy
+    Settings previous = *settings;
+    *settings = *loaded;
+    *loaded = previous;
+    settings_free(&loaded);
+    return 0;
+}
+
+unsigned int settings_diff(const Settings* previous, const Settings* next) {
+    unsigned int changes = 0;
+    if (!priv_str_equal(previous->adapter, next->adapter)) {
+        changes |= SETTINGS_CHANGED_ADAPTER;
+    }
+    if (!priv_str_equal(previous->capability, next->capability)) {
+        changes |= SETTINGS_CHANGED_CAPABILITY;
+    }
+    if (previous->idle_exit_minutes != next->idle_exit_minutes) {
+        changes |= SETTINGS_CHANGED_IDLE_EXIT;
+    }
+    if (!priv_str_equal(previous->webroot, next->webroot)) {
+        changes |= SETTINGS_CHANGED_WEBROOT;
+    }
+    if (!priv_str_equal(previous->web_address, next->web_address)
+        || previous->web_port != next->web_port) {
+        changes |= SETTINGS_CHANGED_WEB_LISTEN;
+    }
+    if (previous->lan_read_only != next->lan_read_only) {
+        changes |= SETTINGS_CHANGED_LAN_ACCESS;
+    }
+    if (previous->web_request_rate != next->web_request_rate
+        || previous->web_request_burst != next->web_request_burst
+        || previous->web_max_concurrent != next->web_max_concurrent) {
+        changes |= SETTINGS_CHANGED_WEB_LIMITS;
+    }
+    if (!priv_str_equal(previous->web_certificate, next->web_certificate)
+        || !priv_str_equal(previous->web_private_key,
+            next->web_private_key)) {
+        changes |= SETTINGS_CHANGED_TLS;
+    }
+    if (!priv_str_equal(previous->control_socket, next->control_socket)) {
+        changes |= SETTINGS_CHANGED_CONTROL_SOCKET;
+    }
+    if (!priv_str_equal(previous->discovery_transport,
+            next->discovery_transport)
+        || previous->discovery_rssi_floor != next->discovery_rssi_floor
+        || !priv_strv_equal(previous->discovery_uuids,
+            next->discovery_uuids)) {
+        changes |= SETTINGS_CHANGED_DISCOVERY;
+    }
+    if (!priv_str_equal(previous->provisioning_manifest,
+            next->provisioning_manifest)) {
+        changes |= SETTINGS_CHANGED_PROVISIONING;
+    }
+    if (!priv_strv_equal(previous->log_verbosity, next->log_verbosity)) {
+        changes |= SETTINGS_CHANGED_LOGGING;
+    }
+    return changes;
+}
+
+void settings_free(Settings** settings) {
+    if (NULL == *settings) {
+        return;
+    }
+
+    g_free((*settings)->adapter);
+    g_free((*settings)->capability);
+    g_free((*settings)->webroot);
+    g_free((*settings)->web_address);
+    g_free((*settings)->web_certificate);
+    g_free((*settings)->web_private_key);
+    g_free((*settings)->control_socket);
+    g_free((*settings)->discovery_transport);
+    g_strfreev((*settings)->discovery_uuids);
+    g_free((*settings)->provisioning_manifest);
+    g_strfreev((*settings)->log_verbosity);
+    free(*settings);
+    *settings = NULL;
+}
+
+///////////////////////////////////////////////////////////////////////////////
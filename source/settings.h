@@ -0,0 +1,117 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            settings.h
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Runtime configuration, loaded from a key file
+//
+// CREATED:         10/18/2026
+//
+// LAST EDITED:     10/18/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+#ifndef SETTINGS_H
+#define SETTINGS_H
+
+#include <stdbool.h>
+
+// Settings start from the compiled-in defaults and are overlaid by the key
+// file. Every key is optional:
+//
+//   [Agent]
+//   Adapter=hci0
+//   Capability=NoInputNoOutput
+//   IdleExitMinutes=0
+//
+//   [Web]
+//   Address=0.0.0.0      (empty or unset: all interfaces)
+//   Port=8888
+//   ReadOnlyLan=false
+//   RequestRate=10       (requests per second per client, 0 for no limit)
+//   RequestBurst=30
+//   MaxConcurrent=32     (0 for no limit)
+//   Certificate=         (PEM; serves HTTPS when set, along with PrivateKey)
+//   PrivateKey=
+//   Webroot=/usr/share/bluez-iot-agent
+//
+//   [Control]
+//   Socket=/run/bluez-iot-agent.sock
+//
+//   [Discovery]
+//   Transport=auto       (auto, bredr or le)
+//   RSSIFloor=-90        (dBm, 0 for no floor)
+//   UUIDs=               (semicolon-separated service UUIDs)
+//
+//   [Provisioning]
+//   Manifest=            (device addresses to pair in bulk, see
+//                         provisioning.h; a new path starts a new batch)
+//
+//   [Logging]
+//   Default=message      (warning, message, info or debug)
+//   WebServer=info       (any other key sets the verbosity of a subsystem)
+typedef struct Settings {
+    char* adapter;
+    char* capability;
+    unsigned int idle_exit_minutes;
+    char* webroot;
+    char* web_address;
+    unsigned int web_port;
+    bool lan_read_only;
+    unsigned int web_request_rate;
+    unsigned int web_request_burst;
+    unsigned int web_max_concurrent;
+    char* web_certificate;
+    char* web_private_key;
+    char* control_socket;
+    char* discovery_transport;
+    int discovery_rssi_floor;
+    char** discovery_uuids;
+    char* provisioning_manifest;
+    char** log_verbosity;     // <- "Subsystem=level", or "Default=level"
+} Settings;
+
+// Bits returned by settings_diff(), one per group of settings that is applied
+// together.
+enum SettingsChange {
+    SETTINGS_CHANGED_ADAPTER = 1 << 0,
+    SETTINGS_CHANGED_CAPABILITY = 1 << 1,
+    SETTINGS_CHANGED_IDLE_EXIT = 1 << 2,
+    SETTINGS_CHANGED_WEBROOT = 1 << 3,
+    SETTINGS_CHANGED_WEB_LISTEN = 1 << 4,
+    SETTINGS_CHANGED_LAN_ACCESS = 1 << 5,
+    SETTINGS_CHANGED_CONTROL_SOCKET = 1 << 6,
+    SETTINGS_CHANGED_DISCOVERY = 1 << 7,
+    SETTINGS_CHANGED_WEB_LIMITS = 1 << 8,
+    SETTINGS_CHANGED_TLS = 1 << 9,
+    SETTINGS_CHANGED_LOGGING = 1 << 10,
+    SETTINGS_CHANGED_PROVISIONING = 1 << 11,
+};
+
+Settings* settings_init();
+Settings* settings_copy(const Settings* settings);
+// Overlay the contents of the key file at path. A missing file is not an
+// error. Returns non-zero, leaving the settings untouched, if the file can't
+// be parsed or contains an invalid value.
+int settings_load(Settings* settings, const char* path);
+unsigned int settings_diff(const Settings* previous,
+    const Settings* next);
+void settings_free(Settings** settings);
+
+#endif // SETTINGS_H
+
+///////////////////////////////////////////////////////////////////////////////
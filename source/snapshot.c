@@ -0,0 +1,152 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            snapshot.c
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Implementation of shared snapshots
+//
+// CREATED:         10/18/2026
+//
+// LAST EDITED:     10/18/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+#include <stdlib.h>
+
+#include <glib.h>
+
+#include <buffer-pool.h>
+#include <snapshot.h>
+
+typedef struct Snapshot {
+    void (*serialize)(GString* buffer, void* user_data);
+    void* user_data;
+    enum MemoryDomain domain;
+    GBytes* bytes;
+
+    // Serializers write into the scratch buffer, which keeps its capacity
+    // between rebuilds. The result is copied into a recycled block.
+    GString* scratch;
+    BufferPool* pool;
+} Snapshot;
+
+static const size_t INITIAL_SCRATCH_SIZE = 256;
+// A scratch buffer that grew past this is given back after use
+static const size_t MAXIMUM_RETAINED_SCRATCH_SIZE = 64 * 1024;
+
+///////////////////////////////////////////////////////////////////////////////
+// Private API
+////
+
+static GString* priv_scratch_new(enum MemoryDomain domain) {
+    GString* scratch = g_string_sized_new(INITIAL_SCRATCH_SIZE);
+    memory_stats_allocated(domain, scratch->allocated_len);
+    return scratch;
+}
+
+static void priv_scratch_free(enum MemoryDomain domain, GString* scratch) {
+    memory_stats_released(domain, scratch->allocated_len);
+    g_string_free(scratch, TRUE);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Public API
+////
+
+Snapshot* snapshot_new(enum MemoryDomain domain,
+    void (*serialize)(GString* buffer, void* user_data), void* user_data)
+{
+    Snapshot* snapshot = malloc(sizeof(Snapshot));
+    if (NULL == snapshot) {
+        return NULL;
+    }
+
+    snapshot->pool = buffer_pool_new(domain);
+    if (NULL == snapshot->pool) {
+        free(snapshot);
+        return NULL;
+    }
+
+    snapshot->serialize = serialize;
+    snapshot->user_data = user_data;
+    snapshot->domain = domain;
+    snapshot->bytes = NULL;
+    snapshot->scratch = priv_scratch_new(domain);
+    return snapshot;
+}
+
+void snapshot_free(Snapshot** snapshot) {
+    if (NULL != *snapshot) {
+        snapshot_invalidate(*snapshot);
+        priv_scratch_free((*snapshot)->domain, (*snapshot)->scratch);
+        buffer_pool_free(&(*snapshot)->pool);
+        free(*snapshot);
+        *snapshot = NULL;
+    }
+}
+
+void snapshot_invalidate(Snapshot* snapshot) {
+    if (NULL != snapshot->bytes) {
+        g_bytes_unref(snapshot->bytes);
+        snapshot->bytes = NULL;
+    }
+}
+
+GBytes* snapshot_get(Snapshot* snapshot) {
+    if (NULL == snapshot->bytes) {
+        GString* scratch = snapshot->scratch;
+        const size_t capacity = scratch->allocated_len;
+        g_string_truncate(scratch, 0);
+        snapshot->serialize(scratch, snapshot->user_data);
+        if (scratch->allocated_len != capacity) {
+            memory_stats_resized(snapshot->domain, capacity,
+                scratch->allocated_len);
+        }
+
+        snapshot->bytes = buffer_pool_copy(snapshot->pool, scratch->str,
+            scratch->len);
+        if (scratch->allocated_len > MAXIMUM_RETAINED_SCRATCH_SIZE) {
+            priv_scratch_free(snapshot->domain, scratch);
+            snapshot->scratch = priv_scratch_new(snapshot->domain);
+        }
+    }
+
+    return g_bytes_ref(snapshot->bytes);
+}
+
+void snapshot_append_json_string(GString* buffer, const char* string) {
+    g_string_append_c(buffer, '"');
+    for (const char* c = string; NULL != c && '\0' != *c; ++c) {
+        switch (*c) {
+        case '"': g_string_append(buffer, "\\\""); break;
+        case '\\': g_string_append(buffer, "\\\\"); break;
+        case '\n': g_string_append(buffer, "\\n"); break;
+        case '\r': g_string_append(buffer, "\\r"); break;
+        case '\t': g_string_append(buffer, "\\t"); break;
+        default:
+            if ((unsigned char)*c < 0x20) {
+                g_string_append_printf(buffer, "\\u%04x", (unsigned char)*c);
+            } else {
+                g_string_append_c(buffer, *c);
+            }
+            break;
+        }
+    }
+    g_string_append_c(buffer, '"');
+}
+
+///////////////////////////////////////////////////////////////////////////////
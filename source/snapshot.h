@@ -0,0 +1,54 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            snapshot.h
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Lazily rebuilt, shared serializations of application data
+//
+// CREATED:         10/18/2026
+//
+// LAST EDITED:     10/18/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <memory-stats.h>
+
+typedef struct _GBytes GBytes;
+typedef struct _GString GString;
+
+// A snapshot is serialized at most once per invalidation. Readers receive a
+// reference to the same immutable buffer, which stays valid for as long as
+// they hold it, even if the snapshot is invalidated in the meantime.
+typedef struct Snapshot Snapshot;
+
+// Buffers are accounted to the given domain
+Snapshot* snapshot_new(enum MemoryDomain domain,
+    void (*serialize)(GString* buffer, void* user_data), void* user_data);
+void snapshot_free(Snapshot** snapshot);
+void snapshot_invalidate(Snapshot* snapshot);
+// Returns a new reference, release with g_bytes_unref()
+GBytes* snapshot_get(Snapshot* snapshot);
+
+// Helpers for serializers
+void snapshot_append_json_string(GString* buffer, const char* string);
+
+#endif // SNAPSHOT_H
+
+///////////////////////////////////////////////////////////////////////////////
@@ -7,7 +7,7 @@
 //
 // CREATED:         11/27/2021
 //
-// LAST EDITED:     11/27/2021
+// LAST EDITED:     10/18/2026
 //
 // Copyright 2021, Ethan D. Twardy
 //
@@ -25,29 +25,215 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 ////
 
+#include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include <memory-stats.h>
 #include <state.h>
 
+// Observers live in a growable array of slots and are referenced by index,
+// so that the array may be reallocated while a dispatch is in progress. Each
+// live observer is linked into the dispatch list of every state in its mask,
+// which keeps removal O(1) and lets a transition walk only the observers
+// interested in it.
+static const int32_t NO_SLOT = -1;
+
 typedef struct StateObserver {
     void* user_data;
     void (*onExit)(enum State, void* user_data);
     void (*onEntry)(enum State, void* user_data);
+    int priority;
+    unsigned int state_mask;
+    uint16_t generation;
+    bool live;
+    bool deferred; // <- Added mid-dispatch, skipped until the next one
+    int32_t prev[STATE_COUNT];
+    int32_t next[STATE_COUNT]; // <- next[0] doubles as the free list link
+    int32_t next_pending;
 } StateObserver;
 
 static const int PENDING_ENTRY = 1 << 0;
 static const int PENDING_EXIT  = 1 << 1;
 
-static const size_t MAXIMUM_OBSERVERS = 8;
+static const size_t INITIAL_OBSERVERS = 8;
+static const size_t MAXIMUM_OBSERVERS = 0xffff;
 typedef struct StatePublisher {
     int ref_count;
     enum State current_state;
+    enum State previous_state;
     int pending_change;
-    size_t num_observers;
+
     StateObserver* observers;
+    size_t capacity;
+    int32_t free_list;
+    int32_t heads[STATE_COUNT];
+
+    // Removals requested during a dispatch are unlinked once it completes
+    int dispatch_depth;
+    int32_t pending_removals;
+    size_t num_deferred;
 } StatePublisher;
 
+///////////////////////////////////////////////////////////////////////////////
+// Private API
+////
+
+static StateObserverHandle priv_make_handle(StatePublisher* publisher,
+    int32_t index)
+{
+    return ((StateObserverHandle)publisher->observers[index].generation << 16)
+        | (StateObserverHandle)(index + 1);
+}
+
+static int32_t priv_lookup_handle(StatePublisher* publisher,
+    StateObserverHandle handle)
+{
+    int32_t index = (int32_t)(handle & 0xffff) - 1;
+    if (0 > index || (size_t)index >= publisher->capacity) {
+        return NO_SLOT;
+    }
+
+    StateObserver* observer = &publisher->observers[index];
+    if (!observer->live || observer->generation != (handle >> 16)) {
+        return NO_SLOT;
+    }
+    return index;
+}
+
+static void priv_chain_free_slots(StatePublisher* publisher, size_t first) {
+    for (size_t i = publisher->capacity; i > first; --i) {
+        StateObserver* observer = &publisher->observers[i - 1];
+        memset(observer, 0, sizeof(StateObserver));
+        observer->generation = 1;
+        observer->next[0] = publisher->free_list;
+        publisher->free_list = (int32_t)(i - 1);
+    }
+}
+
+static int priv_grow(StatePublisher* publisher) {
+    if (publisher->capacity >= MAXIMUM_OBSERVERS) {
+        return 1;
+    }
+
+    size_t capacity = publisher->capacity * 2;
+    if (capacity > MAXIMUM_OBSERVERS) {
+        capacity = MAXIMUM_OBSERVERS;
+    }
+
+    StateObserver* observers = realloc(publisher->observers,
+        capacity * sizeof(StateObserver));
+    if (NULL == observers) {
+        return 1;
+    }
+
+    const size_t old_capacity = publisher->capacity;
+    memory_stats_resized(MEMORY_DOMAIN_STATE,
+        old_capacity * sizeof(StateObserver), capacity * sizeof(StateObserver));
+    publisher->observers = observers;
+    publisher->capacity = capacity;
+    priv_chain_free_slots(publisher, old_capacity);
+    return 0;
+}
+
+static void priv_link(StatePublisher* publisher, int32_t index) {
+    StateObserver* observer = &publisher->observers[index];
+    for (int state = 0; state < STATE_COUNT; ++state) {
+        if (!(observer->state_mask & STATE_MASK(state))) {
+            observer->prev[state] = NO_SLOT;
+            observer->next[state] = NO_SLOT;
+            continue;
+        }
+
+        // Insert after all observers of lower or equal priority
+        int32_t prev = NO_SLOT;
+        int32_t next = publisher->heads[state];
+        while (NO_SLOT != next
+            && publisher->observers[next].priority <= observer->priority) {
+            prev = next;
+            next = publisher->observers[next].next[state];
+        }
+
+        observer->prev[state] = prev;
+        observer->next[state] = next;
+        if (NO_SLOT == prev) {
+            publisher->heads[state] = index;
+        } else {
+            publisher->observers[prev].next[state] = index;
+        }
+        if (NO_SLOT != next) {
+            publisher->observers[next].prev[state] = index;
+        }
+    }
+}
+
+static void priv_unlink_and_free(StatePublisher* publisher, int32_t index) {
+    StateObserver* observer = &publisher->observers[index];
+    for (int state = 0; state < STATE_COUNT; ++state) {
+        if (!(observer->state_mask & STATE_MASK(state))) {
+            continue;
+        }
+
+        int32_t prev = observer->prev[state];
+        int32_t next = observer->next[state];
+        if (NO_SLOT == prev) {
+            publisher->heads[state] = next;
+        } else {
+            publisher->observers[prev].next[state] = next;
+        }
+        if (NO_SLOT != next) {
+            publisher->observers[next].prev[state] = prev;
+        }
+    }
+
+    // Bump the generation so that stale handles no longer resolve
+    uint16_t generation = observer->generation + 1;
+    memset(observer, 0, sizeof(StateObserver));
+    observer->generation = 0 == generation ? 1 : generation;
+    observer->next[0] = publisher->free_list;
+    publisher->free_list = index;
+}
+
+static void priv_finish_dispatch(StatePublisher* publisher) {
+    while (NO_SLOT != publisher->pending_removals) {
+        int32_t index = publisher->pending_removals;
+        publisher->pending_removals = publisher->observers[index].next_pending;
+        priv_unlink_and_free(publisher, index);
+    }
+
+    if (0 < publisher->num_deferred) {
+        for (size_t i = 0; i < publisher->capacity; ++i) {
+            publisher->observers[i].deferred = false;
+        }
+        publisher->num_deferred = 0;
+    }
+}
+
+static void priv_dispatch(StatePublisher* publisher, enum State state,
+    bool entry)
+{
+    ++publisher->dispatch_depth;
+    int32_t index = publisher->heads[state];
+    while (NO_SLOT != index) {
+        // Callbacks may add observers, which can move the array, so the slot
+        // must be re-fetched after each one.
+        StateObserver* observer = &publisher->observers[index];
+        if (observer->live && !observer->deferred) {
+            void (*callback)(enum State, void*) = entry
+                ? observer->onEntry : observer->onExit;
+            if (NULL != callback) {
+                callback(state, observer->user_data);
+            }
+        }
+        index = publisher->observers[index].next[state];
+    }
+
+    if (0 == --publisher->dispatch_depth) {
+        priv_finish_dispatch(publisher);
+    }
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // Public API
 ////
@@ -59,13 +245,21 @@ StatePublisher* state_init() {
     }
 
     memset(publisher, 0, sizeof(StatePublisher));
-    publisher->observers = calloc(MAXIMUM_OBSERVERS, sizeof(StateObserver));
+    publisher->observers = calloc(INITIAL_OBSERVERS, sizeof(StateObserver));
     if (NULL == publisher->observers) {
         free(publisher);
         return NULL;
     }
 
-    memset(publisher->observers, 0, sizeof(StateObserver));
+    memory_stats_allocated(MEMORY_DOMAIN_STATE, sizeof(StatePublisher)
+        + INITIAL_OBSERVERS * sizeof(StateObserver));
+    publisher->capacity = INITIAL_OBSERVERS;
+    publisher->free_list = NO_SLOT;
+    publisher->pending_removals = NO_SLOT;
+    for (int state = 0; state < STATE_COUNT; ++state) {
+        publisher->heads[state] = NO_SLOT;
+    }
+    priv_chain_free_slots(publisher, 0);
     return publisher;
 }
 
@@ -84,27 +278,75 @@ void state_deref(StatePublisher** publisher) {
         return;
     }
 
+    memory_stats_released(MEMORY_DOMAIN_STATE, sizeof(StatePublisher)
+        + (*publisher)->capacity * sizeof(StateObserver));
     free((*publisher)->observers);
     free(*publisher);
     *publisher = NULL;
 }
 
-int state_add_observer(StatePublisher* publisher,
+StateObserverHandle state_add_observer(StatePublisher* publisher,
     void (*onExit)(enum State, void* user_data),
     void (*onEntry)(enum State, void* user_data), void* user_data)
 {
-    if (publisher->num_observers >= MAXIMUM_OBSERVERS) {
-        return 1;
+    return state_add_observer_full(publisher, onExit, onEntry, user_data,
+        STATE_PRIORITY_DEFAULT, STATE_MASK_ALL);
+}
+
+StateObserverHandle state_add_observer_full(StatePublisher* publisher,
+    void (*onExit)(enum State, void* user_data),
+    void (*onEntry)(enum State, void* user_data), void* user_data,
+    int priority, unsigned int state_mask)
+{
+    if (NO_SLOT == publisher->free_list && 0 != priv_grow(publisher)) {
+        return 0;
     }
 
-    publisher->observers[publisher->num_observers].user_data = user_data;
-    publisher->observers[publisher->num_observers].onExit = onExit;
-    publisher->observers[publisher->num_observers].onEntry = onEntry;
-    ++publisher->num_observers;
-    return 0;
+    int32_t index = publisher->free_list;
+    StateObserver* observer = &publisher->observers[index];
+    publisher->free_list = observer->next[0];
+
+    observer->user_data = user_data;
+    observer->onExit = onExit;
+    observer->onEntry = onEntry;
+    observer->priority = priority;
+    observer->state_mask = state_mask & STATE_MASK_ALL;
+    observer->live = true;
+    observer->deferred = 0 < publisher->dispatch_depth;
+    observer->next_pending = NO_SLOT;
+    if (observer->deferred) {
+        ++publisher->num_deferred;
+    }
+
+    priv_link(publisher, index);
+    return priv_make_handle(publisher, index);
+}
+
+void state_remove_observer(StatePublisher* publisher,
+    StateObserverHandle handle)
+{
+    int32_t index = priv_lookup_handle(publisher, handle);
+    if (NO_SLOT == index) {
+        return;
+    }
+
+    if (0 == publisher->dispatch_depth) {
+        priv_unlink_and_free(publisher, index);
+        return;
+    }
+
+    // The dispatch loop may be holding this slot, so leave it linked until
+    // the dispatch completes.
+    StateObserver* observer = &publisher->observers[index];
+    observer->live = false;
+    observer->next_pending = publisher->pending_removals;
+    publisher->pending_removals = index;
 }
 
 void state_set(StatePublisher* publisher, enum State state) {
+    if (!(publisher->pending_change & PENDING_EXIT)) {
+        publisher->previous_state = publisher->current_state;
+    }
     publisher->current_state = state;
     publisher->pending_change = PENDING_ENTRY | PENDING_EXIT;
 }
@@ -113,16 +355,24 @@ enum State state_get(StatePublisher* publisher) {
     return publisher->current_state;
 }
 
+const char* state_to_string(enum State state) {
+    switch (state) {
+    case STATE_NONE: return "none";
+    case STATE_CONNECTION_WAIT: return "connection-wait";
+    case STATE_CONNECTED: return "connected";
+    case STATE_PAIRABLE: return "pairable";
+    case STATE_SHUTDOWN: return "shutdown";
+    default: return "unknown";
+    }
+}
+
 void state_do_exit(StatePublisher* publisher) {
     if (!(publisher->pending_change & PENDING_EXIT)) {
         return;
     }
 
     publisher->pending_change ^= PENDING_EXIT;
-    for (size_t i = 0; i < publisher->num_observers; ++i) {
-        publisher->observers[i].onExit(publisher->current_state,
-            publisher->observers[i].user_data);
-    }
+    priv_dispatch(publisher, publisher->previous_state, false);
 }
 
 void state_do_entry(StatePublisher* publisher) {
@@ -131,10 +381,7 @@ void state_do_entry(StatePublisher* publisher) {
     }
 
     publisher->pending_change ^= PENDING_ENTRY;
-    for (size_t i = 0; i < publisher->num_observers; ++i) {
-        publisher->observers[i].onEntry(publisher->current_state,
-            publisher->observers[i].user_data);
-    }
+    priv_dispatch(publisher, publisher->current_state, true);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
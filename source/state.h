@@ -7,7 +7,7 @@
 //
 // CREATED:         11/26/2021
 //
-// LAST EDITED:     11/27/2021
+// LAST EDITED:     10/18/2026
 //
 // Copyright 2021, Ethan D. Twardy
 //
@@ -34,18 +34,43 @@ enum State {
     STATE_CONNECTED,
     STATE_PAIRABLE,
     STATE_SHUTDOWN,
+    STATE_COUNT, // <- Not a state, must be last
 };
 
+// Observers may restrict which transitions they're notified of with a mask
+// of states. onEntry is filtered by the state being entered, onExit by the
+// state being exited.
+#define STATE_MASK(state) (1u << (state))
+#define STATE_MASK_ALL ((1u << STATE_COUNT) - 1)
+
+// Observers are dispatched in ascending order of priority. Observers of equal
+// priority are dispatched in the order they were added.
+#define STATE_PRIORITY_HIGH -100
+#define STATE_PRIORITY_DEFAULT 0
+#define STATE_PRIORITY_LOW 100
+
+// Zero is never a valid handle.
+typedef unsigned int StateObserverHandle;
+
 typedef struct StatePublisher StatePublisher;
 
 StatePublisher* state_init();
 void state_ref(StatePublisher* publisher);
 void state_deref(StatePublisher** publisher);
-int state_add_observer(StatePublisher* publisher,
+StateObserverHandle state_add_observer(StatePublisher* publisher,
     void (*onExit)(enum State, void* user_data),
     void (*onEntry)(enum State, void* user_data), void* user_data);
+StateObserverHandle state_add_observer_full(StatePublisher* publisher,
+    void (*onExit)(enum State, void* user_data),
+    void (*onEntry)(enum State, void* user_data), void* user_data,
+    int priority, unsigned int state_mask);
+// Safe to call from within an observer callback. Unknown or stale handles
+// are ignored.
+void state_remove_observer(StatePublisher* publisher,
+    StateObserverHandle handle);
 void state_set(StatePublisher* publisher, enum State);
 enum State state_get(StatePublisher* publisher);
+const char* state_to_string(enum State state);
 void state_do_exit(StatePublisher* publisher);
 void state_do_entry(StatePublisher* publisher);
 
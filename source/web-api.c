@@ -0,0 +1,395 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            web-api.c
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Implementation of the JSON REST control API
+//
+// CREATED:         10/18/2026
+//
+// LAST EDITED:     10/18/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <libsoup/soup.h>
+
+#include <bluez.h>
+#include <bluez-client.h>
+#include <device-list.h>
+#include <link-monitor.h>
+#include <memory-stats.h>
+#include <provisioning.h>
+#include <snapshot.h>
+#include <state.h>
+#include <web-api.h>
+#include <web-router.h>
+
+typedef struct WebApi WebApi;
+
+typedef struct WebApiAction {
+    WebApi* api;
+    const char* method;
+    const char* pattern;
+    enum BluezDeviceAction action;
+} WebApiAction;
+
+#define WEB_API_NUM_ACTIONS 7
+
+typedef struct WebApi {
+    StatePublisher* state_publisher;
+    BluezClient* bluez_client;
+    LinkMonitor* link_monitor;
+    DeviceList* device_list;
+    Provisioning* provisioning;
+    StateObserverHandle state_observer;
+    unsigned int devices_listener;
+    unsigned int link_listener;
+    unsigned int provisioning_listener;
+
+    // Serialized once per change, shared by every reader
+    Snapshot* state_snapshot;
+    Snapshot* devices_snapshot;
+    Snapshot* link_snapshot;
+    Snapshot* provisioning_snapshot;
+
+    WebApiAction actions[WEB_API_NUM_ACTIONS];
+} WebApi;
+
+static const char* JSON_CONTENT_TYPE = "application/json";
+
+///////////////////////////////////////////////////////////////////////////////
+// Private API
+////
+
+static void priv_serialize_state(GString* buffer, void* user_data) {
+    WebApi* api = (WebApi*)user_data;
+    g_string_append(buffer, "{\"state\":");
+    snapshot_append_json_string(buffer,
+        state_to_string(state_get(api->state_publisher)));
+    g_string_append_c(buffer, '}');
+}
+
+static void priv_serialize_device(Device1* device, void* user_data) {
+    GString* buffer = (GString*)user_data;
+    if ('[' != buffer->str[buffer->len - 1]) {
+        g_string_append_c(buffer, ',');
+    }
+    device_list_append_json(buffer, device);
+}
+
+static void priv_serialize_devices(GString* buffer, void* user_data) {
+    WebApi* api = (WebApi*)user_data;
+    g_string_append_c(buffer, '[');
+    bluez_client_foreach_device(api->bluez_client, priv_serialize_device,
+        buffer);
+    g_string_append_c(buffer, ']');
+}
+
+static void priv_serialize_link_stats(const LinkStats* stats,
+    GString* buffer)
+{
+    g_string_append(buffer, "{\"address\":");
+    snapshot_append_json_string(buffer, stats->address);
+    g_string_append_printf(buffer, ",\"connected\":%s"
+        ",\"connected_since\":%" G_GINT64_FORMAT
+        ",\"connects\":%u,\"disconnects\":%u,\"samples\":%u",
+        stats->connected ? "true" : "false", stats->connected_since,
+        stats->connects, stats->disconnects, stats->num_samples);
+    if (0 < stats->num_samples) {
+        g_string_append_printf(buffer, ",\"rssi\":{\"last\":%d,\"min\":%d"
+            ",\"average\":%.1f,\"p5\":%d}", stats->rssi_last,
+            stats->rssi_min, stats->rssi_average, stats->rssi_p5);
+    } else {
+        g_string_append(buffer, ",\"rssi\":null");
+    }
+    g_string_append_printf(buffer, ",\"tx_power\":%d}", stats->tx_power);
+}
+
+static void priv_append_link_stats(const LinkStats* stats, void* user_data) {
+    GString* buffer = (GString*)user_data;
+    if ('[' != buffer->str[buffer->len - 1]) {
+        g_string_append_c(buffer, ',');
+    }
+    priv_serialize_link_stats(stats, buffer);
+}
+
+static void priv_serialize_link(GString* buffer, void* user_data) {
+    WebApi* api = (WebApi*)user_data;
+    g_string_append_c(buffer, '[');
+    link_monitor_foreach(api->link_monitor, priv_append_link_stats, buffer);
+    g_string_append_c(buffer, ']');
+}
+
+static void priv_on_link_changed(void* user_data)
+{ snapshot_invalidate(((WebApi*)user_data)->link_snapshot); }
+
+static void priv_serialize_provisioning(GString* buffer, void* user_data)
+{ provisioning_append_json(((WebApi*)user_data)->provisioning, buffer); }
+
+static void priv_on_provisioning_changed(void* user_data)
+{ snapshot_invalidate(((WebApi*)user_data)->provisioning_snapshot); }
+
+static void priv_on_state_entry(enum State state, void* user_data)
+{ snapshot_invalidate(((WebApi*)user_data)->state_snapshot); }
+
+static void priv_on_devices_changed(void* user_data)
+{ snapshot_invalidate(((WebApi*)user_data)->devices_snapshot); }
+
+static void priv_respond_snapshot(SoupServerMessage* message,
+    Snapshot* snapshot)
+{
+    GBytes* bytes = snapshot_get(snapshot);
+    SoupMessageHeaders* headers = soup_server_message_get_response_headers(
+        message);
+    soup_message_headers_set_content_type(headers, JSON_CONTENT_TYPE, NULL);
+    soup_message_headers_replace(headers, "Cache-Control", "no-cache");
+    soup_message_body_append_bytes(
+        soup_server_message_get_response_body(message), bytes);
+    g_bytes_unref(bytes);
+    soup_server_message_set_status(message, SOUP_STATUS_OK, NULL);
+}
+
+static void get_state(SoupServerMessage* message, const char* argument,
+    GHashTable* query, void* user_data)
+{ priv_respond_snapshot(message, ((WebApi*)user_data)->state_snapshot); }
+
+// Without a query, the whole table is served as an array, as it always was.
+// Otherwise one page is streamed from the device list.
+static void get_devices(SoupServerMessage* message, const char* argument,
+    GHashTable* query, void* user_data)
+{
+    WebApi* api = (WebApi*)user_data;
+    if (NULL == query || (NULL == g_hash_table_lookup(query, "page")
+            && NULL == g_hash_table_lookup(query, "per_page")
+            && NULL == g_hash_table_lookup(query, "sort"))) {
+        priv_respond_snapshot(message, api->devices_snapshot);
+    } else {
+        device_list_stream_json(api->device_list, message, query);
+    }
+}
+
+// Not snapshotted: the counters change with every request
+static void get_memory_stats(SoupServerMessage* message, const char* argument,
+    GHashTable* query, void* user_data)
+{
+    GString* buffer = g_string_sized_new(512);
+    memory_stats_append_json(buffer);
+    GBytes* bytes = g_string_free_to_bytes(buffer);
+    SoupMessageHeaders* headers = soup_server_message_get_response_headers(
+        message);
+    soup_message_headers_set_content_type(headers, JSON_CONTENT_TYPE, NULL);
+    soup_message_headers_replace(headers, "Cache-Control", "no-store");
+    soup_message_body_append_bytes(
+        soup_server_message_get_response_body(message), bytes);
+    g_bytes_unref(bytes);
+    soup_server_message_set_status(message, SOUP_STATUS_OK, NULL);
+}
+
+static void get_link_quality(SoupServerMessage* message,
+    const char* argument, GHashTable* query, void* user_data)
+{ priv_respond_snapshot(message, ((WebApi*)user_data)->link_snapshot); }
+
+static void get_provisioning(SoupServerMessage* message,
+    const char* argument, GHashTable* query, void* user_data)
+{
+    priv_respond_snapshot(message,
+        ((WebApi*)user_data)->provisioning_snapshot);
+}
+
+static void get_device_link(SoupServerMessage* message, const char* argument,
+    GHashTable* query, void* user_data)
+{
+    WebApi* api = (WebApi*)user_data;
+    const LinkStats* stats = link_monitor_get(api->link_monitor, argument);
+    if (NULL == stats) {
+        soup_server_message_set_status(message, SOUP_STATUS_NOT_FOUND, NULL);
+        return;
+    }
+
+    GString* buffer = g_string_sized_new(256);
+    priv_serialize_link_stats(stats, buffer);
+    const gsize length = buffer->len;
+    soup_server_message_set_response(message, JSON_CONTENT_TYPE,
+        SOUP_MEMORY_TAKE, g_string_free(buffer, FALSE), length);
+    soup_server_message_set_status(message, SOUP_STATUS_OK, NULL);
+}
+
+static void device_action(SoupServerMessage* message, const char* argument,
+    GHashTable* query, void* user_data)
+{
+    WebApiAction* action = (WebApiAction*)user_data;
+    if (0 != bluez_client_device_action(action->api->bluez_client, argument,
+            action->action)) {
+        soup_server_message_set_status(message, SOUP_STATUS_NOT_FOUND, NULL);
+        return;
+    }
+
+    soup_server_message_set_status(message, SOUP_STATUS_ACCEPTED, NULL);
+}
+
+static void start_pairing(SoupServerMessage* message, const char* argument,
+    GHashTable* query, void* user_data)
+{
+    WebApi* api = (WebApi*)user_data;
+    if (STATE_PAIRABLE != state_get(api->state_publisher)) {
+        state_set(api->state_publisher, STATE_PAIRABLE);
+    }
+    soup_server_message_set_status(message, SOUP_STATUS_ACCEPTED, NULL);
+}
+
+static void stop_pairing(SoupServerMessage* message, const char* argument,
+    GHashTable* query, void* user_data)
+{
+    WebApi* api = (WebApi*)user_data;
+    if (STATE_PAIRABLE != state_get(api->state_publisher)) {
+        soup_server_message_set_status(message, SOUP_STATUS_CONFLICT, NULL);
+        return;
+    }
+
+    state_set(api->state_publisher, STATE_CONNECTION_WAIT);
+    soup_server_message_set_status(message, SOUP_STATUS_ACCEPTED, NULL);
+}
+
+static void start_discovery(SoupServerMessage* message, const char* argument,
+    GHashTable* query, void* user_data)
+{
+    WebApi* api = (WebApi*)user_data;
+    bluez_client_start_discovery(api->bluez_client);
+    soup_server_message_set_status(message, SOUP_STATUS_ACCEPTED, NULL);
+}
+
+static void stop_discovery(SoupServerMessage* message, const char* argument,
+    GHashTable* query, void* user_data)
+{
+    WebApi* api = (WebApi*)user_data;
+    bluez_client_stop_discovery(api->bluez_client);
+    soup_server_message_set_status(message, SOUP_STATUS_ACCEPTED, NULL);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Public API
+////
+
+WebApi* web_api_init(WebRouter* router, StatePublisher* state_publisher,
+    BluezClient* bluez_client, LinkMonitor* link_monitor,
+    DeviceList* device_list, Provisioning* provisioning)
+{
+    WebApi* api = malloc(sizeof(WebApi));
+    if (NULL == api) {
+        return NULL;
+    }
+
+    const WebApiAction actions[WEB_API_NUM_ACTIONS] = {
+        { api, SOUP_METHOD_POST, "/api/devices/" WEB_ROUTE_MAC "/trust",
+          BLUEZ_DEVICE_TRUST },
+        { api, SOUP_METHOD_DELETE, "/api/devices/" WEB_ROUTE_MAC "/trust",
+          BLUEZ_DEVICE_UNTRUST },
+        { api, SOUP_METHOD_POST, "/api/devices/" WEB_ROUTE_MAC "/block",
+          BLUEZ_DEVICE_BLOCK },
+        { api, SOUP_METHOD_DELETE, "/api/devices/" WEB_ROUTE_MAC "/block",
+          BLUEZ_DEVICE_UNBLOCK },
+        { api, SOUP_METHOD_POST, "/api/devices/" WEB_ROUTE_MAC "/connect",
+          BLUEZ_DEVICE_CONNECT },
+        { api, SOUP_METHOD_DELETE, "/api/devices/" WEB_ROUTE_MAC "/connect",
+          BLUEZ_DEVICE_DISCONNECT },
+        { api, SOUP_METHOD_POST, "/api/devices/" WEB_ROUTE_MAC "/remove",
+          BLUEZ_DEVICE_REMOVE },
+    };
+    memcpy(api->actions, actions, sizeof(actions));
+
+    api->state_snapshot = snapshot_new(MEMORY_DOMAIN_WEB,
+        priv_serialize_state, api);
+    api->devices_snapshot = snapshot_new(MEMORY_DOMAIN_WEB,
+        priv_serialize_devices, api);
+    api->link_snapshot = snapshot_new(MEMORY_DOMAIN_WEB, priv_serialize_link,
+        api);
+    api->provisioning_snapshot = snapshot_new(MEMORY_DOMAIN_WEB,
+        priv_serialize_provisioning, api);
+    if (NULL == api->state_snapshot || NULL == api->devices_snapshot
+        || NULL == api->link_snapshot || NULL == api->provisioning_snapshot) {
+        snapshot_free(&api->state_snapshot);
+        snapshot_free(&api->devices_snapshot);
+        snapshot_free(&api->link_snapshot);
+        snapshot_free(&api->provisioning_snapshot);
+        free(api);
+        return NULL;
+    }
+
+    state_ref(state_publisher);
+    api->state_publisher = state_publisher;
+    api->bluez_client = bluez_client;
+    api->device_list = device_list;
+    api->state_observer = state_add_observer(state_publisher, NULL,
+        priv_on_state_entry, api);
+    api->devices_listener = bluez_client_add_devices_listener(bluez_client,
+        priv_on_devices_changed, api);
+    api->link_monitor = link_monitor;
+    api->link_listener = link_monitor_add_listener(link_monitor,
+        priv_on_link_changed, api);
+    api->provisioning = provisioning;
+    api->provisioning_listener = provisioning_add_listener(provisioning,
+        priv_on_provisioning_changed, api);
+
+    web_router_add(router, SOUP_METHOD_GET, "/api/state", get_state, api);
+    web_router_add(router, SOUP_METHOD_GET, "/api/devices", get_devices, api);
+    for (int i = 0; i < WEB_API_NUM_ACTIONS; ++i) {
+        web_router_add(router, api->actions[i].method, api->actions[i].pattern,
+            device_action, &api->actions[i]);
+    }
+    web_router_add(router, SOUP_METHOD_POST, "/api/pairing/start",
+        start_pairing, api);
+    web_router_add(router, SOUP_METHOD_POST, "/api/pairing/stop",
+        stop_pairing, api);
+    web_router_add(router, SOUP_METHOD_GET, "/api/link-quality",
+        get_link_quality, api);
+    web_router_add(router, SOUP_METHOD_GET,
+        "/api/devices/" WEB_ROUTE_MAC "/link", get_device_link, api);
+    web_router_add(router, SOUP_METHOD_POST, "/api/discovery/start",
+        start_discovery, api);
+    web_router_add(router, SOUP_METHOD_POST, "/api/discovery/stop",
+        stop_discovery, api);
+    web_router_add(router, SOUP_METHOD_GET, "/api/provisioning",
+        get_provisioning, api);
+    web_router_add(router, SOUP_METHOD_GET, "/api/debug/memory",
+        get_memory_stats, api);
+    return api;
+}
+
+void web_api_free(WebApi** api) {
+    if (NULL != *api) {
+        bluez_client_remove_devices_listener((*api)->bluez_client,
+            (*api)->devices_listener);
+        link_monitor_remove_listener((*api)->link_monitor,
+            (*api)->link_listener);
+        provisioning_remove_listener((*api)->provisioning,
+            (*api)->provisioning_listener);
+        state_remove_observer((*api)->state_publisher,
+            (*api)->state_observer);
+        state_deref(&(*api)->state_publisher);
+        snapshot_free(&(*api)->state_snapshot);
+        snapshot_free(&(*api)->devices_snapshot);
+        snapshot_free(&(*api)->link_snapshot);
+        snapshot_free(&(*api)->provisioning_snapshot);
+        free(*api);
+        *api = NULL;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
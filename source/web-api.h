@@ -0,0 +1,64 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            web-api.h
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     JSON REST control API
+//
+// CREATED:         10/18/2026
+//
+// LAST EDITED:     10/18/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+#ifndef WEB_API_H
+#define WEB_API_H
+
+typedef struct BluezClient BluezClient;
+typedef struct DeviceList DeviceList;
+typedef struct LinkMonitor LinkMonitor;
+typedef struct Provisioning Provisioning;
+typedef struct StatePublisher StatePublisher;
+typedef struct WebRouter WebRouter;
+
+// Routes:
+//   GET    /api/state
+//   GET    /api/devices                 ?page=&per_page=&sort= to stream
+//                                       one page, see device-list.h
+//   POST   /api/devices/{mac}/trust     DELETE to revoke
+//   POST   /api/devices/{mac}/block     DELETE to revoke
+//   POST   /api/devices/{mac}/connect   DELETE to disconnect
+//   POST   /api/devices/{mac}/remove
+//   GET    /api/devices/{mac}/link      Link quality for one device
+//   GET    /api/link-quality            Link quality for tracked devices
+//   POST   /api/pairing/start
+//   POST   /api/pairing/stop
+//   POST   /api/discovery/start         Also runs while pairable
+//   POST   /api/discovery/stop
+//   GET    /api/provisioning            Sessions and throughput of the
+//                                       provisioning batch
+//   GET    /api/debug/memory            Allocation counters, heap and RSS
+typedef struct WebApi WebApi;
+
+WebApi* web_api_init(WebRouter* router, StatePublisher* state_publisher,
+    BluezClient* bluez_client, LinkMonitor* link_monitor,
+    DeviceList* device_list, Provisioning* provisioning);
+void web_api_free(WebApi** api);
+
+#endif // WEB_API_H
+
+///////////////////////////////////////////////////////////////////////////////
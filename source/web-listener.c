@@ -0,0 +1,473 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            web-listener.c
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Binds the web server to a listen address
+//
+// CREATED:         10/18/2026
+//
+// LAST EDITED:     10/18/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <gio/gio.h>
+#include <gio/gunixsocketaddress.h>
+#include <libsoup/soup.h>
+
+#include <web-listener.h>
+#include <web-server.h>
+
+// Requests are short, so a server that hasn't drained by now has a client
+// that's holding on to something it shouldn't.
+static const guint RETIRE_GRACE_SECONDS = 10;
+
+enum ListenKind {
+    LISTEN_NONE,
+    LISTEN_SOCKET,
+    LISTEN_INET,
+    LISTEN_UNIX,
+};
+
+typedef struct ListenSpec {
+    enum ListenKind kind;
+    GSocket* socket;
+    char* address; // <- Host address for LISTEN_INET, path for LISTEN_UNIX
+    unsigned int port;
+    bool released; // <- Another socket is at the path now, keep it
+} ListenSpec;
+
+// A server that no longer listens, finishing the requests it had accepted
+typedef struct RetiringServer {
+    WebListener* listener;
+    SoupServer* server;
+    unsigned int in_flight;
+    guint timeout_id;
+} RetiringServer;
+
+typedef struct WebListener {
+    WebServer* web_server;
+    char* server_header;
+    void (*activity)(void* user_data);
+    void* activity_data;
+    GTlsCertificate* certificate; // <- Serves HTTPS when set
+
+    SoupServer* server;
+    unsigned int in_flight;
+    ListenSpec bound;
+
+    GPtrArray* retiring; // <- Of RetiringServer*
+} WebListener;
+
+///////////////////////////////////////////////////////////////////////////////
+// Private API
+////
+
+static void priv_spec_clear(ListenSpec* spec) {
+    if (LISTEN_UNIX == spec->kind && !spec->released) {
+        unlink(spec->address);
+    }
+    g_clear_object(&spec->socket);
+    g_clear_pointer(&spec->address, g_free);
+    spec->kind = LISTEN_NONE;
+    spec->port = 0;
+}
+
+static ListenSpec priv_spec_copy(const ListenSpec* spec) {
+    ListenSpec copy = *spec;
+    if (NULL != spec->socket) {
+        copy.socket = g_object_ref(spec->socket);
+    }
+    copy.address = g_strdup(spec->address);
+    return copy;
+}
+
+// Two TCP listeners on one port can't coexist, whatever their addresses.
+// Unix sockets never clash, because they're bound aside and renamed.
+static bool priv_spec_clashes(const ListenSpec* first,
+    const ListenSpec* second)
+{
+    return LISTEN_INET == first->kind && LISTEN_INET == second->kind
+        && first->port == second->port;
+}
+
+static RetiringServer* priv_find_retiring(WebListener* listener,
+    SoupServer* server)
+{
+    for (guint i = 0; i < listener->retiring->len; ++i) {
+        RetiringServer* retiring = g_ptr_array_index(listener->retiring, i);
+        if (server == retiring->server) {
+            return retiring;
+        }
+    }
+    return NULL;
+}
+
+static void priv_on_request_started(SoupServer* server,
+    SoupServerMessage* message, gpointer user_data)
+{
+    WebListener* listener = (WebListener*)user_data;
+    ++listener->web_server->in_flight;
+    RetiringServer* retiring = priv_find_retiring(listener, server);
+    if (NULL != retiring) {
+        // Another request on a connection that was kept alive
+        ++retiring->in_flight;
+        return;
+    }
+
+    ++listener->in_flight;
+    if (NULL != listener->activity) {
+        listener->activity(listener->activity_data);
+    }
+}
+
+static gboolean priv_on_retire_timeout(gpointer user_data) {
+    RetiringServer* retiring = (RetiringServer*)user_data;
+    retiring->timeout_id = 0;
+    if (0 != retiring->in_flight) {
+        g_warning("WebListener: Dropping %u requests on retired listener",
+            retiring->in_flight);
+    }
+    g_ptr_array_remove_fast(retiring->listener->retiring, retiring);
+    return G_SOURCE_REMOVE;
+}
+
+static void priv_on_request_done(SoupServer* server,
+    SoupServerMessage* message, gpointer user_data)
+{
+    WebListener* listener = (WebListener*)user_data;
+    --listener->web_server->in_flight;
+    RetiringServer* retiring = priv_find_retiring(listener, server);
+    if (NULL == retiring) {
+        --listener->in_flight;
+        return;
+    }
+
+    // Never disconnect a server from within one of its own signals
+    if (0 == --retiring->in_flight) {
+        if (0 != retiring->timeout_id) {
+            g_source_remove(retiring->timeout_id);
+        }
+        retiring->timeout_id = g_idle_add(priv_on_retire_timeout, retiring);
+    }
+}
+
+static SoupServer* priv_server_new(WebListener* listener) {
+    SoupServer* server = soup_server_new("tls-certificate",
+        listener->certificate, "raw-paths", FALSE, "server-header",
+        listener->server_header, NULL);
+    soup_server_add_handler(server, "/",
+        listener->web_server->handle_connection, listener->web_server, NULL);
+    g_signal_connect(server, "request-started",
+        G_CALLBACK(priv_on_request_started), listener);
+    g_signal_connect(server, "request-finished",
+        G_CALLBACK(priv_on_request_done), listener);
+    g_signal_connect(server, "request-aborted",
+        G_CALLBACK(priv_on_request_done), listener);
+    return server;
+}
+
+static void priv_server_free(WebListener* listener, SoupServer** server) {
+    if (NULL == *server) {
+        return;
+    }
+
+    g_signal_handlers_disconnect_by_data(*server, listener);
+    soup_server_disconnect(*server);
+    g_clear_object(server);
+}
+
+// Requests dropped with the server will never signal completion
+static void priv_retiring_free(gpointer data) {
+    RetiringServer* retiring = (RetiringServer*)data;
+    if (0 != retiring->timeout_id) {
+        g_source_remove(retiring->timeout_id);
+    }
+    retiring->listener->web_server->in_flight -= retiring->in_flight;
+    priv_server_free(retiring->listener, &retiring->server);
+    g_free(retiring);
+}
+
+// Closes our copy of each listening socket, so that the server accepts no
+// more connections. Another process holding the same socket isn't affected.
+static void priv_close_listeners(SoupServer* server) {
+    GSList* sockets = soup_server_get_listeners(server);
+    for (GSList* iter = sockets; NULL != iter; iter = iter->next) {
+        g_socket_close(G_SOCKET(iter->data), NULL);
+    }
+    g_slist_free(sockets);
+}
+
+// Takes over the listener's current server, which stops accepting right away
+// and is disconnected once the requests it accepted have completed.
+static void priv_retire(WebListener* listener) {
+    SoupServer* server = listener->server;
+    const unsigned int in_flight = listener->in_flight;
+    listener->server = NULL;
+    listener->in_flight = 0;
+    if (NULL == server) {
+        return;
+    }
+
+    priv_close_listeners(server);
+    if (0 == in_flight) {
+        priv_server_free(listener, &server);
+        return;
+    }
+
+    RetiringServer* retiring = g_new0(RetiringServer, 1);
+    retiring->listener = listener;
+    retiring->server = server;
+    retiring->in_flight = in_flight;
+    g_ptr_array_add(listener->retiring, retiring);
+    g_info("WebListener: Draining %u requests", in_flight);
+    retiring->timeout_id = g_timeout_add_seconds(RETIRE_GRACE_SECONDS,
+        priv_on_retire_timeout, retiring);
+}
+
+// A Unix socket is bound next to its path and renamed over it, so that
+// whatever was at the path stays there if the bind fails.
+static void priv_listen_unix(SoupServer* server, const char* path,
+    SoupServerListenOptions options, GError** error)
+{
+    char* temporary = g_strdup_printf("%s.new", path);
+    unlink(temporary);
+    GSocketAddress* address = g_unix_socket_address_new(temporary);
+    soup_server_listen(server, address, options, error);
+    g_object_unref(address);
+    if (NULL == *error) {
+        // Peer credentials are checked per request, this is defense in depth
+        chmod(temporary, S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP);
+        if (0 != rename(temporary, path)) {
+            g_set_error(error, G_IO_ERROR, g_io_error_from_errno(errno),
+                "Couldn't move socket to %s: %s", path, g_strerror(errno));
+            unlink(temporary);
+        }
+    }
+    g_free(temporary);
+}
+
+static int priv_bind(WebListener* listener, SoupServer* server,
+    const ListenSpec* spec)
+{
+    GError* error = NULL;
+    GSocketAddress* address = NULL;
+    const SoupServerListenOptions options = NULL != listener->certificate
+        ? SOUP_SERVER_LISTEN_HTTPS : 0;
+    switch (spec->kind) {
+    case LISTEN_SOCKET:
+        soup_server_listen_socket(server, spec->socket, options, &error);
+        break;
+    case LISTEN_INET:
+        if (NULL == spec->address) {
+            soup_server_listen_all(server, spec->port, options, &error);
+            break;
+        }
+
+        address = g_inet_socket_address_new_from_string(spec->address,
+            spec->port);
+        if (NULL == address) {
+            g_warning("WebListener: Invalid address %s", spec->address);
+            return 1;
+        }
+        soup_server_listen(server, address, options, &error);
+        break;
+    case LISTEN_UNIX:
+        priv_listen_unix(server, spec->address, options, &error);
+        break;
+    default:
+        return 0;
+    }
+
+    g_clear_object(&address);
+    if (NULL != error) {
+        g_warning("WebListener: Couldn't listen: %s", error->message);
+        g_error_free(error);
+        return 1;
+    }
+
+    switch (spec->kind) {
+    case LISTEN_SOCKET:
+        g_info("Web server listening on activated socket");
+        break;
+    case LISTEN_INET:
+        g_info("Web server listening at %s://%s:%u",
+            NULL != listener->certificate ? "https" : "http",
+            NULL != spec->address ? spec->address : "*", spec->port);
+        break;
+    case LISTEN_UNIX:
+        g_info("Web server listening at unix:%s", spec->address);
+        break;
+    default: break;
+    }
+    return 0;
+}
+
+// The new server is bound while the old one still listens, and the old one
+// is only retired once that worked. If the bind fails, the listener is left
+// as it was.
+static int priv_rebind(WebListener* listener, ListenSpec spec) {
+    SoupServer* server = priv_server_new(listener);
+    int result = priv_bind(listener, server, &spec);
+    if (0 != result && NULL != listener->server
+        && priv_spec_clashes(&listener->bound, &spec)) {
+        // The port is ours already, so the old server has to let go of it.
+        // Should the new server still fail, the old one takes it back.
+        priv_server_free(listener, &server);
+        server = priv_server_new(listener);
+        priv_close_listeners(listener->server);
+        result = priv_bind(listener, server, &spec);
+        if (0 != result
+            && 0 != priv_bind(listener, listener->server, &listener->bound)) {
+            g_warning("WebListener: Couldn't listen at the previous address"
+                " again");
+        }
+    }
+
+    if (0 != result) {
+        priv_server_free(listener, &server);
+        priv_spec_clear(&spec);
+        return 1;
+    }
+
+    // The socket at a Unix path was replaced, not removed
+    if (LISTEN_UNIX == listener->bound.kind && LISTEN_UNIX == spec.kind
+        && !g_strcmp0(listener->bound.address, spec.address)) {
+        listener->bound.released = true;
+    }
+    priv_retire(listener);
+    priv_spec_clear(&listener->bound);
+    listener->server = server;
+    listener->bound = spec;
+    return 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Public API
+////
+
+WebListener* web_listener_init(WebServer* web_server,
+    const char* server_header)
+{
+    WebListener* listener = calloc(1, sizeof(WebListener));
+    if (NULL == listener) {
+        return NULL;
+    }
+
+    listener->web_server = web_server;
+    listener->server_header = g_strdup(server_header);
+    listener->retiring = g_ptr_array_new_with_free_func(priv_retiring_free);
+    return listener;
+}
+
+int web_listener_listen_socket(WebListener* listener, GSocket* socket) {
+    ListenSpec spec = { .kind = LISTEN_SOCKET,
+        .socket = g_object_ref(socket) };
+    return priv_rebind(listener, spec);
+}
+
+int web_listener_listen_inet(WebListener* listener, const char* address,
+    unsigned int port)
+{
+    ListenSpec spec = { .kind = LISTEN_INET, .address = g_strdup(address),
+        .port = port };
+    return priv_rebind(listener, spec);
+}
+
+int web_listener_listen_unix(WebListener* listener, const char* path) {
+    ListenSpec spec = { .kind = LISTEN_UNIX, .address = g_strdup(path) };
+    return priv_rebind(listener, spec);
+}
+
+GSocket* web_listener_get_socket(WebListener* listener) {
+    if (NULL == listener->server) {
+        return NULL;
+    }
+
+    GSList* sockets = soup_server_get_listeners(listener->server);
+    GSocket* socket = NULL != sockets ? sockets->data : NULL;
+    g_slist_free(sockets);
+    return socket;
+}
+
+void web_listener_release(WebListener* listener) {
+    if (NULL == listener->server) {
+        return;
+    }
+
+    // Our copy of the socket is closed, the successor's stays open
+    listener->bound.released = true;
+    priv_retire(listener);
+    priv_spec_clear(&listener->bound);
+}
+
+void web_listener_set_activity_callback(WebListener* listener,
+    void (*callback)(void* user_data), void* user_data)
+{
+    listener->activity = callback;
+    listener->activity_data = user_data;
+}
+
+int web_listener_set_tls_certificate(WebListener* listener,
+    GTlsCertificate* certificate)
+{
+    const bool was_https = NULL != listener->certificate;
+    g_clear_object(&listener->certificate);
+    if (NULL != certificate) {
+        listener->certificate = g_object_ref(certificate);
+    }
+    if (NULL == listener->server) {
+        return 0;
+    }
+
+    // Connections already established keep the certificate they negotiated
+    soup_server_set_tls_certificate(listener->server, certificate);
+    if (was_https == (NULL != certificate)) {
+        return 0;
+    }
+
+    // Switching between HTTP and HTTPS needs a new listening socket
+    if (LISTEN_SOCKET == listener->bound.kind) {
+        g_warning("WebListener: Can't switch an activated socket to %s",
+            NULL != certificate ? "HTTPS" : "HTTP");
+        return 1;
+    }
+    return priv_rebind(listener, priv_spec_copy(&listener->bound));
+}
+
+void web_listener_free(WebListener** listener) {
+    if (NULL == *listener) {
+        return;
+    }
+
+    g_ptr_array_unref((*listener)->retiring);
+    priv_server_free(*listener, &(*listener)->server);
+    priv_spec_clear(&(*listener)->bound);
+    g_clear_object(&(*listener)->certificate);
+    g_free((*listener)->server_header);
+    free(*listener);
+    *listener = NULL;
+}
+
+///////////////////////////////////////////////////////////////////////////////
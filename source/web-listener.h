@@ -0,0 +1,77 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            web-listener.h
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Binds the web server to a listen address
+//
+// CREATED:         10/18/2026
+//
+// LAST EDITED:     10/18/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+#ifndef WEB_LISTENER_H
+#define WEB_LISTENER_H
+
+typedef struct WebServer WebServer;
+typedef struct _GSocket GSocket;
+typedef struct _GTlsCertificate GTlsCertificate;
+
+// A SoupServer bound to a single listen address. Binding again replaces the
+// address without cutting off requests: the new server binds first, then the
+// old one stops accepting and is only disconnected once the requests it
+// accepted complete (or a grace period expires). Rebinding to the same TCP
+// port briefly closes the old socket first.
+typedef struct WebListener WebListener;
+
+WebListener* web_listener_init(WebServer* web_server,
+    const char* server_header);
+
+// Each of these replaces whatever the listener was previously bound to, and
+// returns non-zero if the bind failed, in which case the listener keeps its
+// previous address.
+int web_listener_listen_socket(WebListener* listener, GSocket* socket);
+// A NULL address listens on all interfaces
+int web_listener_listen_inet(WebListener* listener, const char* address,
+    unsigned int port);
+// Replaces whatever is at path, and removes the socket on unbind
+int web_listener_listen_unix(WebListener* listener, const char* path);
+
+// With a certificate the listener serves HTTPS, and without one plain HTTP.
+// A new certificate is used for new handshakes right away. Switching between
+// HTTP and HTTPS rebinds, and returns non-zero if that isn't possible.
+int web_listener_set_tls_certificate(WebListener* listener,
+    GTlsCertificate* certificate);
+
+// The socket the listener accepts on, or NULL if it isn't listening. Owned by
+// the listener.
+GSocket* web_listener_get_socket(WebListener* listener);
+// Stops listening, because another process has taken over the socket. Our
+// copy of the socket is closed immediately, so new connections only go to
+// the other process, and a Unix socket's path isn't removed. Connections
+// already accepted are drained as for a rebind.
+void web_listener_release(WebListener* listener);
+
+// Invoked whenever a request is started on the listener
+void web_listener_set_activity_callback(WebListener* listener,
+    void (*callback)(void* user_data), void* user_data);
+void web_listener_free(WebListener** listener);
+
+#endif // WEB_LISTENER_H
+
+///////////////////////////////////////////////////////////////////////////////
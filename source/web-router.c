@@ -0,0 +1,226 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            web-router.c
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Implementation of the route table
+//
+// CREATED:         10/18/2026
+//
+// LAST EDITED:     10/18/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libsoup/soup.h>
+
+#include <web-router.h>
+
+enum WebMethod {
+    WEB_METHOD_GET,
+    WEB_METHOD_POST,
+    WEB_METHOD_PUT,
+    WEB_METHOD_DELETE,
+    WEB_METHOD_COUNT,
+    WEB_METHOD_UNKNOWN = WEB_METHOD_COUNT,
+};
+
+static const char* METHOD_NAMES[WEB_METHOD_COUNT] = {
+    "GET, HEAD", "POST", "PUT", "DELETE",
+};
+
+typedef struct WebRoute {
+    WebRouteHandler handlers[WEB_METHOD_COUNT];
+    void* user_data[WEB_METHOD_COUNT];
+} WebRoute;
+
+typedef struct WebRouter {
+    GHashTable* routes;
+} WebRouter;
+
+enum {
+    MAC_LENGTH = 17,
+    MAXIMUM_PATH_LENGTH = 128,
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Private API
+////
+
+static enum WebMethod priv_get_method(const char* method) {
+    // SoupServerMessage methods are interned, so pointer comparison suffices
+    if (SOUP_METHOD_GET == method || SOUP_METHOD_HEAD == method) {
+        return WEB_METHOD_GET;
+    } else if (SOUP_METHOD_POST == method) {
+        return WEB_METHOD_POST;
+    } else if (SOUP_METHOD_PUT == method) {
+        return WEB_METHOD_PUT;
+    } else if (SOUP_METHOD_DELETE == method) {
+        return WEB_METHOD_DELETE;
+    }
+    return WEB_METHOD_UNKNOWN;
+}
+
+static bool priv_is_mac(const char* segment, size_t length) {
+    if (MAC_LENGTH != length) {
+        return false;
+    }
+
+    for (size_t i = 0; i < length; ++i) {
+        if (2 == i % 3) {
+            if (':' != segment[i]) {
+                return false;
+            }
+        } else if (!g_ascii_isxdigit(segment[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Rewrite the request path into the form used as a key in the route table,
+// replacing parameter segments with their placeholder. Runs in time linear
+// in the length of the path, so lookup doesn't depend on the number of
+// routes.
+static bool priv_make_key(const char* path, char* key, char* argument) {
+    size_t key_length = 0;
+    argument[0] = '\0';
+    while ('\0' != *path) {
+        if ('/' != *path) {
+            return false;
+        }
+
+        const char* segment = path + 1;
+        size_t segment_length = strcspn(segment, "/");
+        const char* replacement = segment;
+        size_t replacement_length = segment_length;
+        if (priv_is_mac(segment, segment_length) && '\0' == argument[0]) {
+            memcpy(argument, segment, segment_length);
+            argument[segment_length] = '\0';
+            replacement = WEB_ROUTE_MAC;
+            replacement_length = strlen(WEB_ROUTE_MAC);
+        }
+
+        if (key_length + 1 + replacement_length >= MAXIMUM_PATH_LENGTH) {
+            return false;
+        }
+        key[key_length++] = '/';
+        memcpy(key + key_length, replacement, replacement_length);
+        key_length += replacement_length;
+        path = segment + segment_length;
+    }
+
+    if (0 == key_length) {
+        return false;
+    }
+    key[key_length] = '\0';
+    return true;
+}
+
+static void priv_set_allow(WebRoute* route, SoupServerMessage* message) {
+    GString* allow = g_string_new(NULL);
+    for (int i = 0; i < WEB_METHOD_COUNT; ++i) {
+        if (NULL != route->handlers[i]) {
+            if (0 < allow->len) {
+                g_string_append(allow, ", ");
+            }
+            g_string_append(allow, METHOD_NAMES[i]);
+        }
+    }
+
+    soup_message_headers_replace(
+        soup_server_message_get_response_headers(message), "Allow",
+        allow->str);
+    g_string_free(allow, TRUE);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Public API
+////
+
+WebRouter* web_router_init() {
+    WebRouter* router = malloc(sizeof(WebRouter));
+    if (NULL == router) {
+        return NULL;
+    }
+
+    router->routes = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+        g_free);
+    return router;
+}
+
+void web_router_free(WebRouter** router) {
+    if (NULL != *router) {
+        g_hash_table_unref((*router)->routes);
+        free(*router);
+        *router = NULL;
+    }
+}
+
+void web_router_add(WebRouter* router, const char* method,
+    const char* pattern, WebRouteHandler handler, void* user_data)
+{
+    enum WebMethod index = priv_get_method(method);
+    g_return_if_fail(WEB_METHOD_UNKNOWN != index);
+
+    WebRoute* route = g_hash_table_lookup(router->routes, pattern);
+    if (NULL == route) {
+        route = g_new0(WebRoute, 1);
+        g_hash_table_insert(router->routes, g_strdup(pattern), route);
+    }
+
+    route->handlers[index] = handler;
+    route->user_data[index] = user_data;
+}
+
+unsigned int web_router_dispatch(WebRouter* router,
+    SoupServerMessage* message, const char* path, GHashTable* query)
+{
+    char key[MAXIMUM_PATH_LENGTH];
+    char argument[MAC_LENGTH + 1];
+    WebRoute* route = NULL;
+    if (priv_make_key(path, key, argument)) {
+        route = g_hash_table_lookup(router->routes, key);
+    }
+
+    if (NULL == route) {
+        soup_server_message_set_status(message, SOUP_STATUS_NOT_FOUND, NULL);
+        return SOUP_STATUS_NOT_FOUND;
+    }
+
+    enum WebMethod method = priv_get_method(
+        soup_server_message_get_method(message));
+    if (WEB_METHOD_UNKNOWN == method) {
+        soup_server_message_set_status(message, SOUP_STATUS_NOT_IMPLEMENTED,
+            NULL);
+        return SOUP_STATUS_NOT_IMPLEMENTED;
+    } else if (NULL == route->handlers[method]) {
+        priv_set_allow(route, message);
+        soup_server_message_set_status(message,
+            SOUP_STATUS_METHOD_NOT_ALLOWED, NULL);
+        return SOUP_STATUS_METHOD_NOT_ALLOWED;
+    }
+
+    route->handlers[method](message, '\0' == argument[0] ? NULL : argument,
+        query, route->user_data[method]);
+    return soup_server_message_get_status(message);
+}
+
+///////////////////////////////////////////////////////////////////////////////
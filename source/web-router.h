@@ -0,0 +1,56 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            web-router.h
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Route table for the web server
+//
+// CREATED:         10/18/2026
+//
+// LAST EDITED:     10/18/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+#ifndef WEB_ROUTER_H
+#define WEB_ROUTER_H
+
+typedef struct _SoupServerMessage SoupServerMessage;
+typedef struct _GHashTable GHashTable;
+
+// Path segments which look like a Bluetooth address are matched by the
+// "{mac}" placeholder in a route, e.g. "/api/devices/{mac}/trust". The
+// matched segment is passed to the handler as the argument.
+#define WEB_ROUTE_MAC "{mac}"
+
+typedef void (*WebRouteHandler)(SoupServerMessage* message,
+    const char* argument, GHashTable* query, void* user_data);
+
+typedef struct WebRouter WebRouter;
+
+WebRouter* web_router_init();
+void web_router_free(WebRouter** router);
+// Method is one of the SOUP_METHOD_* strings. A handler registered for GET
+// also answers HEAD.
+void web_router_add(WebRouter* router, const char* method,
+    const char* pattern, WebRouteHandler handler, void* user_data);
+// Returns the status code set on the message.
+unsigned int web_router_dispatch(WebRouter* router,
+    SoupServerMessage* message, const char* path, GHashTable* query);
+
+#endif // WEB_ROUTER_H
+
+///////////////////////////////////////////////////////////////////////////////
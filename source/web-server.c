@@ -7,7 +7,7 @@
 //
 // CREATED:         11/20/2021
 //
-// LAST EDITED:     01/16/2022
+// LAST EDITED:     10/18/2026
 //
 // Copyright 2021, Ethan D. Twardy
 //
@@ -26,18 +26,33 @@
 ////
 
 #include <fcntl.h>
+#include <limits.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <sys/stat.h>
+#include <unistd.h>
 
 #include <libsoup/soup.h>
 #include <handlebars.h>
 
+#include <device-list.h>
+#include <rate-limiter.h>
+#include <snapshot.h>
 #include <state.h>
+#include <web-api.h>
+#include <web-router.h>
 #include <web-server.h>
 
 static const char* STYLESHEET_NAME = "style.css";
 static const char* TEMPLATE_NAME = "index.html.hbs";
+// Diagnostics say too much about the process to serve on the network
+static const char* LOCAL_ONLY_PREFIX = "/api/debug/";
+
+static const double DEFAULT_CLIENT_RATE = 10;
+static const double DEFAULT_CLIENT_BURST = 30;
+static const unsigned int DEFAULT_MAX_IN_FLIGHT = 32;
+static const unsigned int MAXIMUM_CLIENTS_TRACKED = 256;
+static const gint64 REJECTION_LOG_INTERVAL = 10 * G_TIME_SPAN_SECOND;
 
 ///////////////////////////////////////////////////////////////////////////////
 // Private API
@@ -67,21 +82,24 @@ static HbsResult context_handler(void* key_handler_data, const char* key,
     }
 }
 
-static void post_request(SoupServer* server, SoupServerMessage* message,
-    const char* path, GHashTable* query, gpointer user_data)
+static void post_request(SoupServerMessage* message, const char* argument,
+    GHashTable* query, void* user_data)
 {
     WebServer* web_server = (WebServer*)user_data;
-    const char* response = "Ok";
+    static const char response[] = "Ok";
     soup_server_message_set_status(message, SOUP_STATUS_OK, NULL);
-    soup_server_message_set_response(message, "text/html", SOUP_MEMORY_COPY,
-        response, strlen(response));
+    soup_server_message_set_response(message, "text/html", SOUP_MEMORY_STATIC,
+        response, sizeof(response) - 1);
+    // Repeated submissions shouldn't re-run every observer of the transition
+    if (STATE_PAIRABLE == state_get(web_server->state_publisher)) {
+        return;
+    }
+
     g_info("WebServer: GOING TO STATE_PAIRABLE");
     state_set(web_server->state_publisher, STATE_PAIRABLE);
 }
 
-static void get_request(SoupServer* server, SoupServerMessage* message,
-    const char* path, GHashTable* query, gpointer user_data)
-{
+static void priv_render_page(GString* buffer, void* user_data) {
     WebServer* web_server = (WebServer*)user_data;
     HbsHandlers handlers = {
         .key_handler = context_handler,
@@ -89,57 +107,165 @@ static void get_request(SoupServer* server, SoupServerMessage* message,
     };
     HbsString* response = hbs_template_render(web_server->handlebars,
         &handlers);
+    g_string_append_len(buffer, response->string, response->length);
+    hbs_string_free(response);
+}
+
+static void priv_on_state_entry(enum State state, void* user_data)
+{ snapshot_invalidate(((WebServer*)user_data)->page); }
 
+static void get_request(SoupServerMessage* message, const char* argument,
+    GHashTable* query, void* user_data)
+{
+    WebServer* web_server = (WebServer*)user_data;
+    GBytes* page = snapshot_get(web_server->page);
+    soup_message_headers_set_content_type(
+        soup_server_message_get_response_headers(message), "text/html", NULL);
+    soup_message_body_append_bytes(
+        soup_server_message_get_response_body(message), page);
+    g_bytes_unref(page);
     soup_server_message_set_status(message, SOUP_STATUS_OK, NULL);
-    soup_server_message_set_response(message, "text/html", SOUP_MEMORY_COPY,
-        response->string, response->length);
+}
 
-    hbs_string_free(response);
+static void get_devices_page(SoupServerMessage* message,
+    const char* argument, GHashTable* query, void* user_data)
+{
+    WebServer* web_server = (WebServer*)user_data;
+    device_list_stream_html(web_server->device_list, message, query,
+        web_server->stylesheet, web_server->stylesheet_length);
+}
+
+static bool priv_is_local(SoupServerMessage* message) {
+    GSocketAddress* address = soup_server_message_get_local_address(message);
+    return NULL != address
+        && G_SOCKET_FAMILY_UNIX == g_socket_address_get_family(address);
+}
+
+static bool priv_is_authorized_peer(SoupServerMessage* message) {
+    GSocket* socket = soup_server_message_get_socket(message);
+    GCredentials* credentials = NULL;
+    if (NULL != socket) {
+        credentials = g_socket_get_credentials(socket, NULL);
+    }
+    if (NULL == credentials) {
+        return false;
+    }
+
+    uid_t uid = g_credentials_get_unix_user(credentials, NULL);
+    g_object_unref(credentials);
+    return 0 == uid || geteuid() == uid;
+}
+
+static unsigned int priv_check_access(WebServer* web_server,
+    SoupServerMessage* message, const char* path)
+{
+    if (priv_is_local(message)) {
+        return priv_is_authorized_peer(message)
+            ? SOUP_STATUS_OK : SOUP_STATUS_FORBIDDEN;
+    } else if (g_str_has_prefix(path, LOCAL_ONLY_PREFIX)) {
+        return SOUP_STATUS_NOT_FOUND;
+    }
+
+    const char* method = soup_server_message_get_method(message);
+    if (web_server->lan_read_only && SOUP_METHOD_GET != method
+        && SOUP_METHOD_HEAD != method) {
+        return SOUP_STATUS_FORBIDDEN;
+    }
+    return SOUP_STATUS_OK;
+}
+
+// Local clients are trusted, and are never turned away
+static unsigned int priv_admit(WebServer* web_server,
+    SoupServerMessage* message, unsigned int* retry_after)
+{
+    if (priv_is_local(message)) {
+        return SOUP_STATUS_OK;
+    }
+
+    if (0 != web_server->max_in_flight
+        && web_server->in_flight > web_server->max_in_flight) {
+        *retry_after = 1;
+        return SOUP_STATUS_SERVICE_UNAVAILABLE;
+    }
+
+    const char* host = soup_server_message_get_remote_host(message);
+    if (NULL != web_server->client_limiter && NULL != host
+        && !rate_limiter_allow(web_server->client_limiter, host,
+            retry_after)) {
+        return SOUP_STATUS_TOO_MANY_REQUESTS;
+    }
+    return SOUP_STATUS_OK;
+}
+
+static void priv_reject(WebServer* web_server, SoupServerMessage* message,
+    unsigned int status, unsigned int retry_after)
+{
+    char value[16];
+    snprintf(value, sizeof(value), "%u", retry_after);
+    soup_message_headers_replace(
+        soup_server_message_get_response_headers(message), "Retry-After",
+        value);
+    soup_server_message_set_status(message, status, NULL);
+
+    const gint64 now = g_get_monotonic_time();
+    if (0 == web_server->rejected++) {
+        web_server->rejected_since = now;
+        g_warning("WebServer: Rejecting requests (%u %s)", status,
+            soup_status_get_phrase(status));
+    } else if (now - web_server->rejected_since >= REJECTION_LOG_INTERVAL) {
+        g_warning("WebServer: Rejected %u requests in the last %u seconds",
+            web_server->rejected, (unsigned int)(
+                (now - web_server->rejected_since) / G_TIME_SPAN_SECOND));
+        web_server->rejected = 0;
+    }
 }
 
 static void handle_connection(SoupServer* server, SoupServerMessage* message,
     const char* path, GHashTable* query, gpointer user_data)
 {
-    if (strcmp("/", path)) {
-        soup_server_message_set_status(message, SOUP_STATUS_NOT_FOUND, NULL);
-        g_info("WebServer: GET %s => 404 Not Found", path);
+    WebServer* web_server = (WebServer*)user_data;
+    unsigned int retry_after = 0;
+    unsigned int status = priv_admit(web_server, message, &retry_after);
+    if (SOUP_STATUS_OK != status) {
+        // Don't spend a log line per request on a client that's flooding us
+        priv_reject(web_server, message, status, retry_after);
         return;
     }
 
-    if (SOUP_METHOD_GET == soup_server_message_get_method(message)) {
-        g_info("WebServer: GET %s => 200 Ok", path);
-        get_request(server, message, path, query, user_data);
+    status = priv_check_access(web_server, message, path);
+    if (SOUP_STATUS_OK != status) {
+        soup_server_message_set_status(message, status, NULL);
     } else {
-        g_info("WebServer: POST %s => 200 Ok", path);
-        post_request(server, message, path, query, user_data);
+        status = web_router_dispatch(web_server->router, message, path,
+            query);
     }
+    g_info("WebServer: %s %s => %u %s",
+        soup_server_message_get_method(message), path, status,
+        soup_status_get_phrase(status));
 }
 
-static char* priv_read_file(WebServer* server, const char* webroot,
-    const char* filename, size_t* file_length)
+static char* priv_read_file(const char* webroot, const char* filename,
+    size_t* file_length)
 {
-    const size_t webroot_length = strlen(webroot) + 1;
-    const size_t file_path_length = webroot_length + strlen(filename) + 1;
-    char* file_path = malloc(file_path_length);
-    if (NULL == file_path) {
-        g_error("Couldn't allocate memory for path: %s", strerror(errno));
+    char file_path[PATH_MAX];
+    if (sizeof(file_path) <= (size_t)snprintf(file_path, sizeof(file_path),
+            "%s/%s", webroot, filename)) {
+        g_warning("Path too long: %s/%s", webroot, filename);
+        return NULL;
     }
 
-    strncpy(file_path, webroot, webroot_length);
-    file_path[webroot_length - 1] = '/';
-    strcpy(file_path + webroot_length, filename);
-
     int file_fd = open(file_path, O_RDONLY);
     if (0 > file_fd) {
-        g_error("Couldn't open stylesheet file at %s: %s", file_path,
+        g_warning("Couldn't open file at %s: %s", file_path,
             strerror(errno));
+        return NULL;
     }
-    free(file_path);
 
     struct stat file_stat = {0};
     if (0 != fstat(file_fd, &file_stat)) {
+        g_warning("Couldn't get size of file: %s", strerror(errno));
         close(file_fd);
-        g_error("Couldn't get size of file: %s", strerror(errno));
+        return NULL;
     }
 
     *file_length = file_stat.st_size + 1;
@@ -157,8 +283,10 @@ static char* priv_read_file(WebServer* server, const char* webroot,
         total_bytes_read += bytes_read;
     }
     if (0 > bytes_read) {
+        g_warning("Error reading file: %s", strerror(errno));
         close(file_fd);
-        g_error("Error reading file: %s", strerror(errno));
+        free(file_contents);
+        return NULL;
     }
 
     close(file_fd);
@@ -166,45 +294,133 @@ static char* priv_read_file(WebServer* server, const char* webroot,
     return file_contents;
 }
 
+// Load the stylesheet and template from the webroot, replacing the current
+// ones only if both load successfully.
+static int priv_load_webroot(WebServer* server, const char* webroot_path) {
+    size_t stylesheet_length = 0;
+    char* stylesheet = priv_read_file(webroot_path, STYLESHEET_NAME,
+        &stylesheet_length);
+    if (NULL == stylesheet) {
+        return 1;
+    }
+
+    size_t html_length = 0;
+    char* html = priv_read_file(webroot_path, TEMPLATE_NAME, &html_length);
+    if (NULL == html) {
+        free(stylesheet);
+        return 1;
+    }
+
+    HbsInputContext* input_context = hbs_input_context_from_string(html);
+    HbsTemplate* handlebars = hbs_template_load(input_context);
+    hbs_input_context_free(input_context);
+    if (NULL == handlebars) {
+        g_warning("Failed to load template from %s", webroot_path);
+        free(stylesheet);
+        return 1;
+    }
+
+    if (NULL != server->handlebars) {
+        hbs_template_free(server->handlebars);
+    }
+    free(server->stylesheet);
+    server->handlebars = handlebars;
+    server->stylesheet = stylesheet;
+    server->stylesheet_length = stylesheet_length;
+    if (NULL != server->page) {
+        snapshot_invalidate(server->page);
+    }
+    return 0;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // Public API
 ////
 
 WebServer* web_server_init(const char* webroot_path,
-    StatePublisher* state_publisher)
+    StatePublisher* state_publisher, BluezClient* bluez_client,
+    LinkMonitor* link_monitor, Provisioning* provisioning)
 {
     WebServer* server = malloc(sizeof(WebServer));
     if (NULL == server) {
         return NULL;
     }
 
-    server->stylesheet = priv_read_file(server, webroot_path, STYLESHEET_NAME,
-        &server->stylesheet_length);
-    if (NULL == server->stylesheet) {
+    server->stylesheet = NULL;
+    server->handlebars = NULL;
+    server->page = NULL;
+    if (0 != priv_load_webroot(server, webroot_path)) {
         free(server);
         return NULL;
     }
 
-    size_t html_length = 0;
-    char* html = priv_read_file(server, webroot_path, TEMPLATE_NAME,
-        &html_length);
-    HbsInputContext* input_context = hbs_input_context_from_string(html);
-    server->handlebars = hbs_template_load(input_context);
-    hbs_input_context_free(input_context);
-    if (NULL == server->handlebars) {
-        free(server->stylesheet);
-        free(server);
-        g_error("Failed to load template!");
-    }
-
     server->handle_connection = handle_connection;
+    server->lan_read_only = false;
+    server->client_limiter = NULL;
+    server->in_flight = 0;
+    server->rejected = 0;
+    server->rejected_since = 0;
+    web_server_set_limits(server, DEFAULT_CLIENT_RATE, DEFAULT_CLIENT_BURST,
+        DEFAULT_MAX_IN_FLIGHT);
     state_ref(state_publisher);
     server->state_publisher = state_publisher;
+    server->page = snapshot_new(MEMORY_DOMAIN_WEB, priv_render_page, server);
+    if (NULL == server->page) {
+        g_error("Couldn't allocate page: %s", strerror(errno));
+    }
+    server->page_observer = state_add_observer(state_publisher, NULL,
+        priv_on_state_entry, server);
+
+    server->router = web_router_init();
+    web_router_add(server->router, SOUP_METHOD_GET, "/", get_request, server);
+    web_router_add(server->router, SOUP_METHOD_POST, "/", post_request,
+        server);
+    web_router_add(server->router, SOUP_METHOD_GET, "/devices",
+        get_devices_page, server);
+    server->device_list = device_list_init(bluez_client);
+    if (NULL == server->device_list) {
+        g_error("Couldn't allocate device list: %s", strerror(errno));
+    }
+    server->api = web_api_init(server->router, state_publisher, bluez_client,
+        link_monitor, server->device_list, provisioning);
+    if (NULL == server->api) {
+        g_error("Failed to initialize REST API");
+    }
     return server;
 }
 
+int web_server_set_webroot(WebServer* server, const char* webroot_path) {
+    if (0 != priv_load_webroot(server, webroot_path)) {
+        return 1;
+    }
+
+    g_info("WebServer: Serving content from %s", webroot_path);
+    return 0;
+}
+
+void web_server_set_limits(WebServer* server, double rate, double burst,
+    unsigned int max_in_flight)
+{
+    server->max_in_flight = max_in_flight;
+    if (0 >= rate) {
+        rate_limiter_free(&server->client_limiter);
+    } else if (NULL == server->client_limiter) {
+        server->client_limiter = rate_limiter_init(MEMORY_DOMAIN_WEB, rate,
+            burst, MAXIMUM_CLIENTS_TRACKED);
+    } else {
+        rate_limiter_set_rate(server->client_limiter, rate, burst);
+    }
+}
+
 void web_server_free(WebServer** server) {
     if (NULL != *server) {
+        rate_limiter_free(&(*server)->client_limiter);
+        web_api_free(&(*server)->api);
+        device_list_free(&(*server)->device_list);
+        web_router_free(&(*server)->router);
+        state_remove_observer((*server)->state_publisher,
+            (*server)->page_observer);
+        snapshot_free(&(*server)->page);
         state_deref(&(*server)->state_publisher);
         hbs_template_free((*server)->handlebars);
         free((*server)->stylesheet);
@@ -7,7 +7,7 @@
 //
 // CREATED:         11/20/2021
 //
-// LAST EDITED:     01/16/2022
+// LAST EDITED:     10/18/2026
 //
 // Copyright 2021, Ethan D. Twardy
 //
@@ -28,8 +28,19 @@
 #ifndef WEB_SERVER_H
 #define WEB_SERVER_H
 
+#include <stdbool.h>
+
+#include <state.h>
+
+typedef struct BluezClient BluezClient;
+typedef struct DeviceList DeviceList;
 typedef struct HbsTemplate HbsTemplate;
-typedef struct StatePublisher StatePublisher;
+typedef struct LinkMonitor LinkMonitor;
+typedef struct Provisioning Provisioning;
+typedef struct RateLimiter RateLimiter;
+typedef struct Snapshot Snapshot;
+typedef struct WebApi WebApi;
+typedef struct WebRouter WebRouter;
 typedef struct _SoupServer SoupServer;
 typedef struct _SoupServerMessage SoupServerMessage;
 typedef struct _GHashTable GHashTable;
@@ -42,10 +53,39 @@ typedef struct WebServer {
     char* stylesheet;
     size_t stylesheet_length;
     HbsTemplate* handlebars;
+    // The page only depends on the state, so it's rendered once per change
+    Snapshot* page;
+    StateObserverHandle page_observer;
+    WebRouter* router;
+    WebApi* api;
+    DeviceList* device_list;
+
+    // Requests on a local (Unix socket) listener are only served to root or
+    // the agent's own user. When set, LAN listeners only serve GET and HEAD.
+    // Paths under /api/debug/ are only served locally.
+    bool lan_read_only;
+
+    // Admission control for LAN clients: requests beyond max_in_flight
+    // across all listeners are refused with 503, and each client address is
+    // limited by a token bucket, refused with 429. Rejections are summarized
+    // in the log rather than logged one by one.
+    RateLimiter* client_limiter;
+    unsigned int in_flight; // <- Maintained by WebListener
+    unsigned int max_in_flight;
+    unsigned int rejected;
+    long long rejected_since; // <- Monotonic, microseconds
 } WebServer;
 
 WebServer* web_server_init(const char* webroot_path,
-    StatePublisher* publisher);
+    StatePublisher* publisher, BluezClient* bluez_client,
+    LinkMonitor* link_monitor, Provisioning* provisioning);
+// Returns non-zero, and keeps serving the current content, if the stylesheet
+// or template in the new webroot can't be loaded.
+int web_server_set_webroot(WebServer* server, const char* webroot_path);
+// A rate of zero disables the per-client limit, and a max_in_flight of zero
+// disables the concurrency limit.
+void web_server_set_limits(WebServer* server, double rate, double burst,
+    unsigned int max_in_flight);
 void web_server_free(WebServer**);
 
 #endif // WEB_SERVER_H
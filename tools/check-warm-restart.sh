@@ -0,0 +1,115 @@
+#!/bin/sh
+###############################################################################
+# NAME:             check-warm-restart.sh
+#
+# AUTHOR:           Ethan D. Twardy <ethan.twardy@gmail.com>
+#
+# DESCRIPTION:      Check that a restart resumes only live connections
+#
+# CREATED:          10/18/2026
+#
+# LAST EDITED:      10/18/2026
+#
+# Copyright 2026, Ethan D. Twardy
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+###
+
+# Usage: check-warm-restart.sh [BUILD_DIRECTORY]
+#
+# Runs the agent against bluez-iot-agent-replay --devices on a private bus,
+# and restarts it with the checkpoint it left behind: once while the device
+# it was connected to is still connected, and once after it has gone.
+
+set -eu
+
+BUILD=$(cd "${1:-.}" && pwd)
+SOURCE=$(cd "$(dirname "$0")/.." && pwd)
+WORK=$(mktemp -d)
+BUS_PID=
+SIMULATOR=
+FAILED=0
+
+cleanup() {
+    [ -n "$SIMULATOR" ] && kill "$SIMULATOR" 2>/dev/null
+    [ -n "$BUS_PID" ] && kill "$BUS_PID" 2>/dev/null
+    rm -rf "$WORK"
+}
+trap cleanup EXIT
+
+dbus-daemon --session --fork --print-address=1 --print-pid=1 > "$WORK/bus"
+ADDRESS=$(sed -n 1p "$WORK/bus")
+BUS_PID=$(sed -n 2p "$WORK/bus")
+
+cat > "$WORK/agent.conf" <<CONF
+[Web]
+Address=127.0.0.1
+Port=18888
+Webroot=$SOURCE/templates
+
+[Control]
+Socket=$WORK/control.sock
+
+[Logging]
+Default=info
+CONF
+
+start_simulator() {
+    [ -n "$SIMULATOR" ] && kill "$SIMULATOR" && wait "$SIMULATOR" || true
+    "$BUILD/bluez-iot-agent-replay" --address "$ADDRESS" --devices 2 \
+        --connected "$1" > "$WORK/simulator.log" &
+    SIMULATOR=$!
+    sleep 1
+}
+
+# Runs the agent for a few seconds, logging to $WORK/$1
+run_agent() {
+    "$BUILD/bluez-iot-agent" --bus-address "$ADDRESS" \
+        --config "$WORK/agent.conf" --state-file "$WORK/checkpoint" \
+        > "$WORK/$1" 2>&1 &
+    agent=$!
+    sleep 3
+    kill -TERM "$agent"
+    wait "$agent" || true
+}
+
+expect() {
+    if grep -q "$2" "$WORK/$1"; then
+        echo "ok: $3"
+    else
+        echo "FAIL: $3"
+        sed 's/^/    /' "$WORK/$1"
+        FAILED=1
+    fi
+}
+
+start_simulator 1
+run_agent first.log
+expect first.log "State CONNECTED" \
+    "a connected device puts the agent in CONNECTED"
+
+run_agent restored.log
+expect restored.log "02:00:00:00:00:01 is still connected" \
+    "the checkpointed connection is checked against the live device"
+expect restored.log "Resuming in connected" "CONNECTED is resumed"
+
+start_simulator 0
+run_agent stale.log
+expect stale.log "No device is still connected" \
+    "a connection that has gone isn't resumed"
+expect stale.log "Resuming in connection-wait" "CONNECTION_WAIT is resumed"
+
+exit $FAILED
+
+###############################################################################
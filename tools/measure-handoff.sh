@@ -0,0 +1,159 @@
+#!/bin/sh
+###############################################################################
+# NAME:             measure-handoff.sh
+#
+# AUTHOR:           Ethan D. Twardy <ethan.twardy@gmail.com>
+#
+# DESCRIPTION:      Measure the service gap during a graceful upgrade
+#
+# CREATED:          10/18/2026
+#
+# LAST EDITED:      10/18/2026
+#
+# Copyright 2026, Ethan D. Twardy
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+###
+#
+# Usage: measure-handoff.sh [-b BINARY] [-s SOCKET] [-u PATH] [-n ROUNDS]
+#                           [-w SECONDS] [-- AGENT_ARGUMENTS...]
+#
+# While an agent is running, starts BINARY --take-over ROUNDS times in a row,
+# each new agent taking over from the last. Throughout, one loop fetches PATH
+# from the control socket and another pings the agent's bus name, each back
+# to back. The control socket is handed over like the network listener, and
+# unlike it isn't rate limited, so every failed probe is a gap in service.
+# For each round, prints how many probes failed and the longest time between
+# two successful probes, for HTTP and for D-Bus. Without a gap in service,
+# the longest time is about one probe, which is printed too: it's the
+# resolution of the measurement, and mostly the cost of starting curl or
+# dbus-send.
+#
+# Run this as root or the agent's user (the control socket admits no one else),
+# on the target, with the agent started by hand rather than by systemd. The
+# last agent started keeps running.
+
+set -eu
+
+BINARY=bluez-iot-agent
+SOCKET=/run/bluez-iot-agent.sock
+URL_PATH=/api/state
+ROUNDS=5
+WAIT=2
+SERVICE_NAME=org.bluez.iot-agent
+
+while getopts b:s:u:n:w: option; do
+    case "$option" in
+        b) BINARY=$OPTARG ;;
+        s) SOCKET=$OPTARG ;;
+        u) URL_PATH=$OPTARG ;;
+        n) ROUNDS=$OPTARG ;;
+        w) WAIT=$OPTARG ;;
+        *) sed -n '/^# Usage/,/^$/p' "$0" >&2; exit 2 ;;
+    esac
+done
+shift $((OPTIND - 1))
+
+WORK=$(mktemp -d)
+PROBES=
+trap 'rm -f "$WORK/run"; wait $PROBES; rm -rf "$WORK"' EXIT
+
+now() {
+    date +%s%N
+}
+
+# Appends "END_NS STATUS" for each probe until the run file goes away
+probe() {
+    output=$1
+    shift
+    while [ -e "$WORK/run" ]; do
+        if "$@" > /dev/null 2>&1; then
+            status=ok
+        else
+            status=failed
+        fi
+        echo "$(now) $status" >> "$output"
+    done
+}
+
+http() {
+    curl -sf -o /dev/null --max-time 5 --unix-socket "$SOCKET" \
+        "http://localhost$URL_PATH"
+}
+
+bus() {
+    dbus-send --system --print-reply --reply-timeout=5000 \
+        --dest="$SERVICE_NAME" / org.freedesktop.DBus.Peer.Ping
+}
+
+# Failed probes, the longest time between successes, and the median time
+# per probe, in milliseconds
+summarize() {
+    sort -n "$1" > "$1.sorted"
+    median=$(awk 'NR > 1 { print $1 - last } { last = $1 }' "$1.sorted" \
+        | sort -n | awk '{ periods[NR] = $1 } END {
+            printf "%.1f", NR ? periods[int((NR + 1) / 2)] / 1e6 : 0 }')
+    awk -v median="$median" '
+        $2 == "failed" { ++failed }
+        $2 == "ok" {
+            if (last && $1 - last > gap) { gap = $1 - last }
+            last = $1
+        }
+        END { printf "%d,%.1f,%s", failed, gap / 1e6, median }' "$1.sorted"
+}
+
+pid=$(pidof -s "$(basename "$BINARY")") || {
+    echo "No agent is running" >&2
+    exit 1
+}
+
+echo "round,http_failed,http_gap_ms,http_probe_ms,bus_failed,bus_gap_ms,\
+bus_probe_ms"
+round=1
+while [ "$round" -le "$ROUNDS" ]; do
+    : > "$WORK/run"
+    : > "$WORK/http"
+    : > "$WORK/bus"
+    probe "$WORK/http" http &
+    PROBES=$!
+    probe "$WORK/bus" bus &
+    PROBES="$PROBES $!"
+    sleep "$WAIT"
+
+    "$BINARY" --take-over "$@" &
+    successor=$!
+    # The old agent carries on if its successor isn't ready in time
+    deadline=$(($(date +%s) + 30))
+    while kill -0 "$pid" 2> /dev/null; do
+        if [ "$(date +%s)" -ge "$deadline" ]; then
+            echo "The old agent didn't exit" >&2
+            exit 1
+        fi
+        sleep 0.01
+    done
+    if ! kill -0 "$successor" 2> /dev/null; then
+        echo "The new agent exited" >&2
+        exit 1
+    fi
+
+    sleep "$WAIT"
+    rm -f "$WORK/run"
+    wait $PROBES
+    PROBES=
+    echo "$round,$(summarize "$WORK/http"),$(summarize "$WORK/bus")"
+    pid=$successor
+    round=$((round + 1))
+done
+
+###############################################################################
@@ -0,0 +1,135 @@
+#!/bin/sh
+###############################################################################
+# NAME:             provisioning-throughput.sh
+#
+# AUTHOR:           Ethan D. Twardy <ethan.twardy@gmail.com>
+#
+# DESCRIPTION:      Measure bulk provisioning against simulated devices
+#
+# CREATED:          10/18/2026
+#
+# LAST EDITED:      10/18/2026
+#
+# Copyright 2026, Ethan D. Twardy
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+###
+#
+# Usage: provisioning-throughput.sh [-n DEVICES] [-i MILLISECONDS]
+#                                   [BUILD_DIRECTORY]
+#
+# Runs the agent against bluez-iot-agent-replay --pair-every on a private
+# bus, with a manifest listing every simulated device. A device arrives every
+# MILLISECONDS and asks the agent to pair. Once every device in the batch has
+# paired or failed, prints the agent's summary from GET /api/provisioning
+# (devices paired per minute and the latency of each phase), followed by the
+# simulator's own measurements from the other side of the bus. Exits non-zero
+# if a device didn't pair.
+
+set -eu
+
+DEVICES=20
+INTERVAL=100
+
+while getopts n:i: option; do
+    case "$option" in
+        n) DEVICES=$OPTARG ;;
+        i) INTERVAL=$OPTARG ;;
+        *) sed -n '/^# Usage/,/^$/p' "$0" >&2; exit 2 ;;
+    esac
+done
+shift $((OPTIND - 1))
+
+BUILD=$(cd "${1:-.}" && pwd)
+SOURCE=$(cd "$(dirname "$0")/.." && pwd)
+WORK=$(mktemp -d)
+BUS_PID=
+SIMULATOR=
+AGENT=
+
+cleanup() {
+    [ -n "$AGENT" ] && kill "$AGENT" 2>/dev/null
+    [ -n "$SIMULATOR" ] && kill "$SIMULATOR" 2>/dev/null
+    [ -n "$BUS_PID" ] && kill "$BUS_PID" 2>/dev/null
+    rm -rf "$WORK"
+}
+trap cleanup EXIT
+
+dbus-daemon --session --fork --print-address=1 --print-pid=1 > "$WORK/bus"
+ADDRESS=$(sed -n 1p "$WORK/bus")
+BUS_PID=$(sed -n 2p "$WORK/bus")
+
+i=1
+while [ "$i" -le "$DEVICES" ]; do
+    printf '02:00:00:00:%02X:%02X\n' $((i / 256)) $((i % 256))
+    i=$((i + 1))
+done > "$WORK/manifest"
+
+cat > "$WORK/agent.conf" <<CONF
+[Web]
+Address=127.0.0.1
+Port=18889
+Webroot=$SOURCE/templates
+
+[Control]
+Socket=$WORK/control.sock
+
+[Provisioning]
+Manifest=$WORK/manifest
+CONF
+
+"$BUILD/bluez-iot-agent-replay" --address "$ADDRESS" --devices "$DEVICES" \
+    --pair-every "$INTERVAL" > "$WORK/simulator.log" &
+SIMULATOR=$!
+sleep 1
+
+"$BUILD/bluez-iot-agent" --bus-address "$ADDRESS" \
+    --config "$WORK/agent.conf" --state-file "$WORK/checkpoint" \
+    > "$WORK/agent.log" 2>&1 &
+AGENT=$!
+
+# Prints the number after "key": in the summary
+field() {
+    sed -n "s/^{\"active\":true[^[]*\"$1\":\([0-9]*\).*/\1/p" \
+        "$WORK/provisioning"
+}
+
+deadline=$(($(date +%s) + DEVICES * INTERVAL / 1000 + 30))
+while :; do
+    curl -sf --unix-socket "$WORK/control.sock" \
+        http://localhost/api/provisioning > "$WORK/provisioning" || true
+    paired=$(field paired)
+    failed=$(field failed)
+    if [ -n "$paired" ] && [ $((paired + failed)) -ge "$DEVICES" ]; then
+        break
+    elif [ "$(date +%s)" -ge "$deadline" ]; then
+        echo "Timed out; the agent's log:" >&2
+        sed 's/^/    /' "$WORK/agent.log" >&2
+        exit 1
+    fi
+    sleep 1
+done
+
+echo "Agent:"
+sed 's/,"sessions":.*/}/' "$WORK/provisioning"
+kill -INT "$SIMULATOR"
+wait "$SIMULATOR" || true
+SIMULATOR=
+echo "Simulator:"
+grep -E '^(Paired|Agent confirmation|Arrival to connected)' \
+    "$WORK/simulator.log"
+
+[ "$paired" -eq "$DEVICES" ]
+
+###############################################################################
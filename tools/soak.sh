@@ -0,0 +1,122 @@
+#!/bin/sh
+###############################################################################
+# NAME:             soak.sh
+#
+# AUTHOR:           Ethan D. Twardy <ethan.twardy@gmail.com>
+#
+# DESCRIPTION:      Load the web API and sample the agent's memory
+#
+# CREATED:          10/18/2026
+#
+# LAST EDITED:      10/18/2026
+#
+# Copyright 2026, Ethan D. Twardy
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+###
+
+# Usage: soak.sh [-s SOCKET] [-d SECONDS] [-i INTERVAL] [-c CLIENTS] [-p PID]
+#
+# Runs CLIENTS loops of GET /, /api/state and /api/devices against the agent's
+# control socket for SECONDS, and samples GET /api/debug/memory and the
+# agent's VmRSS every INTERVAL seconds. Prints the samples as CSV, followed by
+# how much each figure grew over the second half of the run, once every
+# buffer size class should be warm. A leak shows up as steady growth there.
+#
+# The debug endpoint is only served on the control socket, so run this as
+# root or as the agent's user.
+
+set -eu
+
+SOCKET=/run/bluez-iot-agent.sock
+DURATION=600
+INTERVAL=10
+CLIENTS=4
+PID=
+
+while getopts s:d:i:c:p: option; do
+    case "$option" in
+        s) SOCKET=$OPTARG ;;
+        d) DURATION=$OPTARG ;;
+        i) INTERVAL=$OPTARG ;;
+        c) CLIENTS=$OPTARG ;;
+        p) PID=$OPTARG ;;
+        *) sed -n '/^# Usage/,/^$/p' "$0" >&2; exit 2 ;;
+    esac
+done
+[ -n "$PID" ] || PID=$(pidof -s bluez-iot-agent)
+
+WORK=$(mktemp -d)
+trap 'kill $(jobs -p) 2>/dev/null; rm -rf "$WORK"' EXIT
+
+get() {
+    curl -sf --unix-socket "$SOCKET" "http://localhost$1"
+}
+
+# Prints the number after "key": in the object that follows "object":
+field() {
+    sed -n "s/.*\"$2\":{[^}]*\"$3\":\([0-9]*\).*/\1/p" "$1"
+}
+
+client() {
+    requests=0
+    while [ ! -e "$WORK/stop" ]; do
+        for path in / /api/state /api/devices; do
+            get "$path" > /dev/null || echo "GET $path failed" >&2
+            requests=$((requests + 1))
+        done
+    done
+    echo "$requests" > "$WORK/client.$1"
+}
+
+i=0
+while [ "$i" -lt "$CLIENTS" ]; do
+    client "$i" &
+    i=$((i + 1))
+done
+
+FIELDS="web_allocations web_live_bytes dbus_live_bytes state_live_bytes"
+FIELDS="$FIELDS heap_in_use_bytes vm_rss_kb"
+echo "elapsed_s $FIELDS" | tr ' ' ,
+start=$(date +%s)
+elapsed=0
+while [ "$elapsed" -le "$DURATION" ]; do
+    get /api/debug/memory > "$WORK/memory"
+    rss=$(sed -n 's/^VmRSS:[^0-9]*\([0-9]*\).*/\1/p' "/proc/$PID/status")
+    echo "$elapsed,$(field "$WORK/memory" web allocations)" \
+        "$(field "$WORK/memory" web live_bytes)" \
+        "$(field "$WORK/memory" dbus live_bytes)" \
+        "$(field "$WORK/memory" state live_bytes)" \
+        "$(field "$WORK/memory" heap in_use_bytes),$rss" \
+        | sed 's/ /,/g' | tee -a "$WORK/samples"
+    sleep "$INTERVAL"
+    elapsed=$(($(date +%s) - start))
+done
+
+touch "$WORK/stop"
+wait
+total=$(cat "$WORK"/client.* | awk '{ total += $1 } END { print total }')
+echo
+echo "$total requests in ${elapsed}s"
+awk -F, -v half="$((DURATION / 2))" -v fields="$FIELDS" '
+    $1 >= half && !seen { for (i = 2; i <= NF; ++i) first[i] = $i; seen = 1 }
+    { for (i = 2; i <= NF; ++i) last[i] = $i }
+    END {
+        n = split(fields, names, " ")
+        print "Growth over the second half:"
+        for (i = 1; i <= n; ++i)
+            printf "  %-18s %+d\n", names[i], last[i + 1] - first[i + 1]
+    }' "$WORK/samples"
+
+###############################################################################
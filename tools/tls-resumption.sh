@@ -0,0 +1,141 @@
+#!/bin/sh
+###############################################################################
+# NAME:             tls-resumption.sh
+#
+# AUTHOR:           Ethan D. Twardy <ethan.twardy@gmail.com>
+#
+# DESCRIPTION:      Compare full and resumed TLS handshakes against the web UI
+#
+# CREATED:          10/18/2026
+#
+# LAST EDITED:      10/18/2026
+#
+# Copyright 2026, Ethan D. Twardy
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+###
+#
+# Usage: tls-resumption.sh [-H HOST] [-p PORT] [-t SECONDS] [-n REQUESTS]
+#                          [-u PATH]
+#
+# Measures the agent's HTTPS listener three ways, one after the other:
+#
+#   full       a new connection and a full handshake for every request
+#   resumed    a new connection for every request, resuming the first session
+#   keepalive  one connection for every request
+#
+# The first two use `openssl s_time` for SECONDS each. The last uses a
+# single curl process fetching PATH REQUESTS times. Prints requests/sec for
+# each, and the fraction of `resumed` connections that actually resumed. If
+# that fraction is zero, the server isn't issuing session tickets. Run this
+# from a second host, so that the client's share of the CPU isn't counted
+# against the agent, and watch the agent's CPU with e.g. `pidstat -p PID 1`
+# while it runs.
+#
+# The agent limits each LAN client to a few requests per second, which this
+# exceeds immediately. Set `RequestRate=0` under `[Web]` on the agent under
+# test and reload it (SIGHUP) first, and restore it afterwards. The script
+# checks for that before measuring, and fails if any response isn't a 200.
+
+set -eu
+
+HOST=localhost
+PORT=8888
+SECONDS_PER_MODE=10
+REQUESTS=1000
+URL_PATH=/api/state
+
+while getopts H:p:t:n:u: option; do
+    case "$option" in
+        H) HOST=$OPTARG ;;
+        p) PORT=$OPTARG ;;
+        t) SECONDS_PER_MODE=$OPTARG ;;
+        n) REQUESTS=$OPTARG ;;
+        u) URL_PATH=$OPTARG ;;
+        *) sed -n '/^# Usage/,/^$/p' "$0" >&2; exit 2 ;;
+    esac
+done
+
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+# -www makes s_time send a request and read the reply, which is also when a
+# TLS 1.3 client receives the session ticket it resumes with.
+s_time() {
+    openssl s_time -connect "$HOST:$PORT" -www "$URL_PATH" \
+        -time "$SECONDS_PER_MODE" "$@" > "$WORK/s_time" 2>&1 || true
+    # "N connections in M real seconds, ..."
+    rate=$(awk '/connections in [0-9.]+ real seconds/ {
+            printf "%.1f", $1 / $4; exit }' "$WORK/s_time")
+    if [ -z "$rate" ]; then
+        echo "openssl s_time failed:" >&2
+        cat "$WORK/s_time" >&2
+        exit 1
+    fi
+    echo "$rate"
+}
+
+# s_time prints a line of one character per connection: 'r' if it resumed
+resumed_fraction() {
+    grep -E '^[*r]+$' "$WORK/s_time" | awk '{ marks = marks $0 } END {
+        total = length(marks); n = gsub(/r/, "", marks)
+        printf "%.2f", total ? n / total : 0 }'
+}
+
+now() {
+    date +%s.%N
+}
+
+# Fetches PATH $1 times over one connection, recording each status code
+fetch() {
+    i=0
+    while [ "$i" -lt "$1" ]; do
+        printf 'url = "https://%s:%s%s"\noutput = "/dev/null"\n' \
+            "$HOST" "$PORT" "$URL_PATH"
+        i=$((i + 1))
+    done > "$WORK/curl.conf"
+    curl -sk --write-out '%{http_code}\n' --config "$WORK/curl.conf" \
+        > "$WORK/codes" || true
+}
+
+# Fails unless every one of the $1 responses fetched was a 200
+check_codes() {
+    ok=$(grep -c '^200$' "$WORK/codes" || true)
+    if [ "$ok" -ne "$1" ]; then
+        echo "$(($1 - ok)) of $1 responses weren't 200:" \
+            "$(sort "$WORK/codes" | uniq -c | tr -s ' \n' ' ')" >&2
+        echo "Is RequestRate=0 set under [Web] on the agent?" >&2
+        exit 1
+    fi
+}
+
+# More than the default burst, so a rate limit shows up before measuring
+fetch 50
+check_codes 50
+
+full=$(s_time -new)
+resumed=$(s_time -reuse)
+fraction=$(resumed_fraction)
+
+start=$(now)
+fetch "$REQUESTS"
+keepalive=$(awk -v n="$REQUESTS" -v start="$start" -v end="$(now)" \
+    'BEGIN { printf "%.1f", n / (end - start) }')
+check_codes "$REQUESTS"
+
+printf 'mode,requests_per_second\n'
+printf 'full,%s\nresumed,%s\nkeepalive,%s\n' "$full" "$resumed" "$keepalive"
+printf 'resumed_fraction,%s\n' "$fraction"
+
+###############################################################################